@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <log.h>
 #include <os.h>
+#include <worker.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <asm/malloc.h>
@@ -413,3 +414,31 @@ int sandbox_load_other_fdt(void **fdtp, int *sizep)
 
 	return 0;
 }
+
+#if CONFIG_IS_ENABLED(WORKER)
+/* Secondary CPUs are emulated with host threads */
+static struct {
+	void (*func)(void *arg);
+	void *arg;
+} sandbox_worker;
+
+static void *sandbox_worker_thread(void *arg)
+{
+	sandbox_worker.func(sandbox_worker.arg);
+
+	return NULL;
+}
+
+int arch_worker_start(void (*func)(void *arg), void *arg, int max)
+{
+	sandbox_worker.func = func;
+	sandbox_worker.arg = arg;
+
+	return os_thread_run(max, sandbox_worker_thread, NULL);
+}
+
+void arch_worker_wait(void)
+{
+	os_thread_wait();
+}
+#endif
@@ -103,6 +103,15 @@ static int _raw_packet_start(struct eth_sandbox_raw_priv *priv,
 		return -errno;
 	}
 
+	/* SO_BINDTODEVICE does not filter packet sockets; bind() does */
+	device->sll_protocol = htons(ETH_P_ALL);
+	ret = bind(priv->sd, (struct sockaddr *)device, sizeof(*device));
+	if (ret < 0) {
+		printf("Failed to bind to '%s': %d %s\n", priv->host_ifname,
+		       errno, strerror(errno));
+		return -errno;
+	}
+
 	/* Make the socket non-blocking */
 	flags = fcntl(priv->sd, F_GETFL, 0);
 	ret = fcntl(priv->sd, F_SETFL, flags | O_NONBLOCK);
@@ -273,14 +282,10 @@ int sandbox_eth_raw_os_recv(void *packet, int *length,
 			    const struct eth_sandbox_raw_priv *priv)
 {
 	int retval;
-	int saddr_size;
 
 	if (priv->sd < 0 || !priv->device)
 		return -EINVAL;
-	saddr_size = sizeof(struct sockaddr);
-	retval = recvfrom(priv->sd, packet, 1536, 0,
-			  (struct sockaddr *)priv->device,
-			  (socklen_t *)&saddr_size);
+	retval = recvfrom(priv->sd, packet, 1536, 0, NULL, NULL);
 	*length = 0;
 	if (retval >= 0) {
 		*length = retval;
@@ -292,6 +297,39 @@ int sandbox_eth_raw_os_recv(void *packet, int *length,
 	return -errno;
 }
 
+/* Most packets fetched from the host by one recvmmsg() call */
+#define RAW_RECV_BATCH	32
+
+int sandbox_eth_raw_os_recv_batch(void **packets, int *lengths, int max,
+				  const struct eth_sandbox_raw_priv *priv)
+{
+	struct mmsghdr msgs[RAW_RECV_BATCH];
+	struct iovec iov[RAW_RECV_BATCH];
+	int i, retval;
+
+	if (priv->sd < 0 || !priv->device)
+		return -EINVAL;
+	if (max > RAW_RECV_BATCH)
+		max = RAW_RECV_BATCH;
+
+	memset(msgs, '\0', max * sizeof(*msgs));
+	for (i = 0; i < max; i++) {
+		iov[i].iov_base = packets[i];
+		iov[i].iov_len = 1536;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	retval = recvmmsg(priv->sd, msgs, max, 0, NULL);
+	/* The socket is non-blocking, so expect EAGAIN when there is no data */
+	if (retval < 0)
+		return errno == EAGAIN ? 0 : -errno;
+	for (i = 0; i < retval; i++)
+		lengths[i] = msgs[i].msg_len;
+
+	return retval;
+}
+
 void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv)
 {
 	free(priv->device);
@@ -1014,6 +1014,43 @@ void os_set_time_offset(long offset)
 		       ENV_TIME_OFFSET);
 }
 
+/* Host threads used to emulate secondary CPUs */
+#define OS_THREAD_MAX	64
+
+static pthread_t os_threads[OS_THREAD_MAX];
+static int os_thread_count;
+
+int os_thread_run(int count, void *(*func)(void *arg), void *arg)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int i;
+
+	if (os_thread_count)
+		return 0;
+
+	/* The calling thread has a CPU too */
+	if (count > OS_THREAD_MAX)
+		count = OS_THREAD_MAX;
+	if (cpus > 0 && count > cpus - 1)
+		count = cpus - 1;
+	for (i = 0; i < count; i++) {
+		if (pthread_create(&os_threads[i], NULL, func, arg))
+			break;
+	}
+	os_thread_count = i;
+
+	return i;
+}
+
+void os_thread_wait(void)
+{
+	int i;
+
+	for (i = 0; i < os_thread_count; i++)
+		pthread_join(os_threads[i], NULL);
+	os_thread_count = 0;
+}
+
 void os_localtime(struct rtc_time *rt)
 {
 	time_t t = time(NULL);
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the x86 SHA extensions
+ *
+ * This follows the instruction sequences in Intel's "Intel SHA Extensions"
+ * white paper. It is built in the host environment, since the intrinsics
+ * headers need the standard C headers.
+ */
+
+#include <asm/sha-ni-os.h>
+
+#ifdef __x86_64__
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SHA_NI_TARGET	__attribute__((target("sha,sse4.1,ssse3")))
+
+int sha_ni_supported(void)
+{
+	static int supported = -1;
+	unsigned int a, b, c, d;
+
+	if (supported == -1) {
+		supported = __get_cpuid(1, &a, &b, &c, &d) &&
+			    (c & bit_SSSE3) && (c & bit_SSE4_1) &&
+			    __get_cpuid_count(7, 0, &a, &b, &c, &d) &&
+			    (b & bit_SHA);
+	}
+
+	return supported;
+}
+
+/*
+ * Four rounds of SHA-1: @e holds E plus the message words, @f is set up to be
+ * the E for the next group. The message schedule for later groups is worked
+ * out alongside, as far as it is needed.
+ */
+#define SHA1_GROUP(g, e, f)						\
+	do {								\
+		if ((g) < 4)						\
+			m[(g) & 3] = _mm_shuffle_epi8(_mm_loadu_si128(	\
+				(const __m128i *)(data + 16 * (g))),	\
+				mask);					\
+		if (g)							\
+			e = _mm_sha1nexte_epu32(e, m[(g) & 3]);		\
+		else							\
+			e = _mm_add_epi32(e, m[0]);			\
+		f = abcd;						\
+		if ((g) >= 3 && (g) <= 18)				\
+			m[((g) + 1) & 3] = _mm_sha1msg2_epu32(		\
+				m[((g) + 1) & 3], m[(g) & 3]);		\
+		abcd = _mm_sha1rnds4_epu32(abcd, e, (g) / 5);		\
+		if ((g) >= 1 && (g) <= 16)				\
+			m[((g) + 3) & 3] = _mm_sha1msg1_epu32(		\
+				m[((g) + 3) & 3], m[(g) & 3]);		\
+		if ((g) >= 2 && (g) <= 17)				\
+			m[((g) + 2) & 3] = _mm_xor_si128(		\
+				m[((g) + 2) & 3], m[(g) & 3]);		\
+	} while (0)
+
+SHA_NI_TARGET
+void sha1_ni_process(unsigned int state[5], const unsigned char *data,
+		     unsigned int blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+					    0x08090a0b0c0d0e0fULL);
+	__m128i abcd, abcd_save, e0, e0_save, e1, m[4];
+
+	abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state),
+				 0x1b);
+	e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (; blocks; blocks--, data += 64) {
+		abcd_save = abcd;
+		e0_save = e0;
+
+		SHA1_GROUP(0, e0, e1);
+		SHA1_GROUP(1, e1, e0);
+		SHA1_GROUP(2, e0, e1);
+		SHA1_GROUP(3, e1, e0);
+		SHA1_GROUP(4, e0, e1);
+		SHA1_GROUP(5, e1, e0);
+		SHA1_GROUP(6, e0, e1);
+		SHA1_GROUP(7, e1, e0);
+		SHA1_GROUP(8, e0, e1);
+		SHA1_GROUP(9, e1, e0);
+		SHA1_GROUP(10, e0, e1);
+		SHA1_GROUP(11, e1, e0);
+		SHA1_GROUP(12, e0, e1);
+		SHA1_GROUP(13, e1, e0);
+		SHA1_GROUP(14, e0, e1);
+		SHA1_GROUP(15, e1, e0);
+		SHA1_GROUP(16, e0, e1);
+		SHA1_GROUP(17, e1, e0);
+		SHA1_GROUP(18, e0, e1);
+		SHA1_GROUP(19, e1, e0);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+static const unsigned int sha256_k[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/* Four rounds of SHA-256, using message words @w and constants from @i */
+#define SHA256_ROUNDS(w, i)						\
+	do {								\
+		msg = _mm_add_epi32(w, _mm_load_si128(			\
+				(const __m128i *)&sha256_k[i]));	\
+		state1 = _mm_sha256rnds2_epu32(state1, state0, msg);	\
+		msg = _mm_shuffle_epi32(msg, 0x0e);			\
+		state0 = _mm_sha256rnds2_epu32(state0, state1, msg);	\
+	} while (0)
+
+/* Replace @w0 (words i - 16 to i - 13) with words i to i + 3 */
+#define SHA256_SCHEDULE(w0, w1, w2, w3)					\
+	(w0 = _mm_sha256msg2_epu32(_mm_add_epi32(			\
+		_mm_sha256msg1_epu32(w0, w1),				\
+		_mm_alignr_epi8(w3, w2, 4)), w3))
+
+SHA_NI_TARGET
+void sha256_ni_process(unsigned int state[8], const unsigned char *data,
+		       unsigned int blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					    0x0405060700010203ULL);
+	__m128i state0, state1, msg, tmp, w0, w1, w2, w3;
+	__m128i abef_save, cdgh_save;
+	int i;
+
+	/* Rearrange the state into ABEF and CDGH, as the instructions want */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]),
+				0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]),
+				   0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	for (; blocks; blocks--, data += 64) {
+		abef_save = state0;
+		cdgh_save = state1;
+
+		w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data),
+				      mask);
+		w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)
+						      (data + 16)), mask);
+		w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)
+						      (data + 32)), mask);
+		w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)
+						      (data + 48)), mask);
+		SHA256_ROUNDS(w0, 0);
+		SHA256_ROUNDS(w1, 4);
+		SHA256_ROUNDS(w2, 8);
+		SHA256_ROUNDS(w3, 12);
+		for (i = 16; i < 64; i += 16) {
+			SHA256_SCHEDULE(w0, w1, w2, w3);
+			SHA256_ROUNDS(w0, i);
+			SHA256_SCHEDULE(w1, w2, w3, w0);
+			SHA256_ROUNDS(w1, i + 4);
+			SHA256_SCHEDULE(w2, w3, w0, w1);
+			SHA256_ROUNDS(w2, i + 8);
+			SHA256_SCHEDULE(w3, w0, w1, w2);
+			SHA256_ROUNDS(w3, i + 12);
+		}
+
+		state0 = _mm_add_epi32(state0, abef_save);
+		state1 = _mm_add_epi32(state1, cdgh_save);
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0],
+			 _mm_blend_epi16(tmp, state1, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4],
+			 _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#else /* !__x86_64__ */
+
+int sha_ni_supported(void)
+{
+	return 0;
+}
+
+void sha1_ni_process(unsigned int state[5], const unsigned char *data,
+		     unsigned int blocks)
+{
+}
+
+void sha256_ni_process(unsigned int state[8], const unsigned char *data,
+		       unsigned int blocks)
+{
+}
+
+#endif
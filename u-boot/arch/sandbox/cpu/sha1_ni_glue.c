@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * sha1_ni_glue.c - SHA-1 secure hash using the x86 SHA extensions
+ */
+
+#include <asm/sha-ni-os.h>
+#include <u-boot/sha1.h>
+
+void sha1_process(sha1_context *ctx, const unsigned char *data,
+		  unsigned int blocks)
+{
+	if (!blocks)
+		return;
+
+	if (sha_ni_supported())
+		sha1_ni_process(ctx->state, data, blocks);
+	else
+		sha1_process_sw(ctx, data, blocks);
+}
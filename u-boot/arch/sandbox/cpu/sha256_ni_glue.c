@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * sha256_ni_glue.c - SHA-256 secure hash using the x86 SHA extensions
+ */
+
+#include <asm/sha-ni-os.h>
+#include <u-boot/sha256.h>
+
+void sha256_process(sha256_context *ctx, const unsigned char *data,
+		    unsigned int blocks)
+{
+	if (!blocks)
+		return;
+
+	if (sha_ni_supported())
+		sha256_ni_process(ctx->state, data, blocks);
+	else
+		sha256_process_sw(ctx, data, blocks);
+}
@@ -23,6 +23,8 @@
  *		 a message to the server claiming the port is
  *		 unreachable
  * local_bind_udp_port: The UDP port number that we bound to
+ * rx_used: number of net_rx_packets[] handed out by the last batch and not
+ *	    freed yet
  */
 struct eth_sandbox_raw_priv {
 	int sd;
@@ -32,6 +34,7 @@ struct eth_sandbox_raw_priv {
 	int local;
 	int local_bind_sd;
 	unsigned short local_bind_udp_port;
+	int rx_used;
 };
 
 /* A struct to mimic if_nameindex but that does not depend on Linux headers */
@@ -68,6 +71,19 @@ int sandbox_eth_raw_os_send(void *packet, int length,
 			    struct eth_sandbox_raw_priv *priv);
 int sandbox_eth_raw_os_recv(void *packet, int *length,
 			    const struct eth_sandbox_raw_priv *priv);
+
+/*
+ * Receive up to max packets with a single call into the host
+ *
+ * packets - buffers of at least 1536 bytes each to receive into
+ * lengths - set to the length of each packet received
+ * max - number of buffers available
+ * priv - raw socket session
+ *
+ * returns - number of packets received, 0 if none, negative if error
+ */
+int sandbox_eth_raw_os_recv_batch(void **packets, int *lengths, int max,
+				  const struct eth_sandbox_raw_priv *priv);
 void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv);
 
 #endif /* __ETH_RAW_OS_H */
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SHA-1 and SHA-256 using the x86 SHA extensions, for sandbox
+ *
+ * These are built in the host environment (see sha-ni-os.c), so only plain C
+ * types are used here.
+ */
+
+#ifndef __SHA_NI_OS_H
+#define __SHA_NI_OS_H
+
+/**
+ * sha_ni_supported() - Check if the host CPU has the SHA extensions
+ *
+ * Return: 1 if sha1_ni_process() and sha256_ni_process() can be used, else 0
+ */
+int sha_ni_supported(void);
+
+/**
+ * sha1_ni_process() - Add blocks of data to a SHA-1 digest
+ *
+ * @state:	SHA-1 state (A to E)
+ * @data:	Data to process
+ * @blocks:	Number of 64-byte blocks in @data
+ */
+void sha1_ni_process(unsigned int state[5], const unsigned char *data,
+		     unsigned int blocks);
+
+/**
+ * sha256_ni_process() - Add blocks of data to a SHA-256 digest
+ *
+ * @state:	SHA-256 state (A to H)
+ * @data:	Data to process
+ * @blocks:	Number of 64-byte blocks in @data
+ */
+void sha256_ni_process(unsigned int state[8], const unsigned char *data,
+		       unsigned int blocks);
+
+#endif
@@ -783,6 +783,21 @@ int bootdev_setup_iter(struct bootflow_iter *iter, const char *label,
 		if (!ok)
 			return log_msg_ret("ord", -ENOMEM);
 		log_debug("setup labels %p\n", iter->labels);
+
+		/*
+		 * Start any slow hunters which may be needed later. Errors are
+		 * reported when the hunter is used, so are ignored here.
+		 */
+		if (IS_ENABLED(CONFIG_BOOTSTD_HUNT_ASYNC) &&
+		    (iter->flags & BOOTFLOWIF_HUNT)) {
+			const char *const *label = iter->labels;
+
+			if (!label)
+				bootdev_hunt_start(NULL, show);
+			for (; label && *label; label++)
+				bootdev_hunt_start(*label, show);
+		}
+
 		if (iter->labels) {
 			iter->cur_label = -1;
 			ret = bootdev_next_label(iter, &dev, &method_flags);
@@ -827,41 +842,50 @@ static int bootdev_hunt_drv(struct bootdev_hunter *info, uint seq, bool show)
 				return ret;
 		}
 		std->hunters_used |= BIT(seq);
+		std->hunters_started &= ~BIT(seq);
 	}
 
 	return 0;
 }
 
+/* Check whether a hunter matches a spec, as used by bootdev_hunt() */
+static bool bootdev_hunter_match(struct bootdev_hunter *info,
+				 const char *spec)
+{
+	const char *name = uclass_get_name(info->uclass);
+	const char *end;
+	size_t len;
+
+	if (!spec)
+		return true;
+	trailing_strtoln_end(spec, NULL, &end);
+	len = end - spec;
+
+	log_debug("looking at %.*s for %s\n",
+		  (int)max(strlen(name), len), spec, name);
+	if (!strncmp(spec, name, max(strlen(name), len)))
+		return true;
+
+	return info->uclass == UCLASS_ETH &&
+		(!strcmp("dhcp", spec) || !strcmp("pxe", spec));
+}
+
 int bootdev_hunt(const char *spec, bool show)
 {
 	struct bootdev_hunter *start;
-	const char *end;
 	int n_ent, i;
 	int result;
-	size_t len;
 
 	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
 	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
 	result = 0;
 
-	len = SIZE_MAX;
-	if (spec) {
-		trailing_strtoln_end(spec, NULL, &end);
-		len = end - spec;
-	}
-
 	for (i = 0; i < n_ent; i++) {
 		struct bootdev_hunter *info = start + i;
-		const char *name = uclass_get_name(info->uclass);
 		int ret;
 
-		log_debug("looking at %.*s for %s\n",
-			  (int)max(strlen(name), len), spec, name);
-		if (spec && strncmp(spec, name, max(strlen(name), len))) {
-			if (info->uclass != UCLASS_ETH ||
-			    (strcmp("dhcp", spec) && strcmp("pxe", spec)))
-				continue;
-		}
+		if (!bootdev_hunter_match(info, spec))
+			continue;
 		ret = bootdev_hunt_drv(info, i, show);
 		if (ret)
 			result = ret;
@@ -870,6 +894,41 @@ int bootdev_hunt(const char *spec, bool show)
 	return result;
 }
 
+int bootdev_hunt_start(const char *spec, bool show)
+{
+	struct bootdev_hunter *start;
+	struct bootstd_priv *std;
+	int n_ent, i;
+	int result;
+	int ret;
+
+	ret = bootstd_get_priv(&std);
+	if (ret)
+		return log_msg_ret("std", ret);
+
+	start = ll_entry_start(struct bootdev_hunter, bootdev_hunter);
+	n_ent = ll_entry_count(struct bootdev_hunter, bootdev_hunter);
+	result = 0;
+
+	for (i = 0; i < n_ent; i++) {
+		struct bootdev_hunter *info = start + i;
+
+		if (!info->start || !bootdev_hunter_match(info, spec) ||
+		    ((std->hunters_used | std->hunters_started) & BIT(i)))
+			continue;
+		if (show)
+			printf("Starting hunt with: %s\n",
+			       uclass_get_name(info->uclass));
+		ret = info->start(info, show);
+		log_debug("  - start result %d\n", ret);
+		if (ret && ret != -ENOENT)
+			result = ret;
+		std->hunters_started |= BIT(i);
+	}
+
+	return result;
+}
+
 int bootdev_unhunt(enum uclass_id id)
 {
 	struct bootdev_hunter *start;
@@ -887,9 +946,11 @@ int bootdev_unhunt(enum uclass_id id)
 			ret = bootstd_get_priv(&std);
 			if (ret)
 				return log_msg_ret("std", ret);
-			if (!(std->hunters_used & BIT(i)))
+			if (!((std->hunters_used | std->hunters_started) &
+			      BIT(i)))
 				return -EALREADY;
 			std->hunters_used &= ~BIT(i);
+			std->hunters_started &= ~BIT(i);
 			return 0;
 		}
 	}
@@ -111,6 +111,8 @@ static struct legacy_img_hdr *image_get_kernel(ulong img_addr, int verify)
  *     address and length, otherwise NULL
  *     pointer to image header if valid image was found, plus kernel start
  * @kernp: image header if valid image was found, otherwise NULL
+ * @load_next: true if bootm_load_os() runs next, so that it can verify the
+ *     hashes of a FIT kernel while loading it
  *
  * boot_get_kernel() tries to find a kernel image, verifies its integrity
  * and locates kernel data.
@@ -119,7 +121,8 @@ static struct legacy_img_hdr *image_get_kernel(ulong img_addr, int verify)
  * a wrong or unsupported format
  */
 static int boot_get_kernel(const char *addr_fit, struct bootm_headers *images,
-			   ulong *os_data, ulong *os_len, const void **kernp)
+			   ulong *os_data, ulong *os_len, const void **kernp,
+			   bool load_next)
 {
 #if CONFIG_IS_ENABLED(LEGACY_IMAGE_FORMAT)
 	struct legacy_img_hdr	*hdr;
@@ -195,7 +198,8 @@ static int boot_get_kernel(const char *addr_fit, struct bootm_headers *images,
 				&fit_uname_kernel, &fit_uname_config,
 				IH_ARCH_DEFAULT, IH_TYPE_KERNEL,
 				BOOTSTAGE_ID_FIT_KERNEL_START,
-				FIT_LOAD_IGNORED, os_data, os_len);
+				load_next ? FIT_LOAD_STREAM : FIT_LOAD_IGNORED,
+				os_data, os_len);
 		if (os_noffset < 0)
 			return -ENOENT;
 
@@ -310,9 +314,11 @@ static int bootm_pre_load(const char *addr_str)
  *
  * @cmd_name: Command name that started this boot, e.g. "bootm"
  * @addr_fit: Address and/or FIT specifier (first arg of bootm command)
+ * @load_next: true if the OS is loaded in the same run of states
  * Return: 0 on success, -ve on error
  */
-static int bootm_find_os(const char *cmd_name, const char *addr_fit)
+static int bootm_find_os(const char *cmd_name, const char *addr_fit,
+			 bool load_next)
 {
 	const void *os_hdr;
 #ifdef CONFIG_ANDROID_BOOT_IMAGE
@@ -324,7 +330,7 @@ static int bootm_find_os(const char *cmd_name, const char *addr_fit)
 
 	/* get kernel image header, start address and length */
 	ret = boot_get_kernel(addr_fit, &images, &images.os.image_start,
-			      &images.os.image_len, &os_hdr);
+			      &images.os.image_len, &os_hdr, load_next);
 	if (ret) {
 		if (ret == -EPROTOTYPE)
 			printf("Wrong Image Type for %s command\n", cmd_name);
@@ -651,9 +657,26 @@ static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
-	err = image_decomp(os.comp, load, os.image_start, os.type,
-			   load_buf, image_buf, image_len,
-			   CONFIG_SYS_BOOTM_LEN, &load_end);
+	if (CONFIG_IS_ENABLED(FIT_STREAM_LOAD) && images->fit_verify_os) {
+		ulong len = 0;
+
+		err = fit_image_load_stream(images->fit_hdr_os,
+					    images->fit_noffset_os, os.comp,
+					    load_buf, CONFIG_SYS_BOOTM_LEN,
+					    image_buf, image_len, &len);
+		load_end = load + len;
+		if (!err)
+			images->fit_verify_os = false;
+		if (err == -EACCES) {
+			bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+					BOOTSTAGE_SUB_HASH);
+			return 1;
+		}
+	} else {
+		err = image_decomp(os.comp, load, os.image_start, os.type,
+				   load_buf, image_buf, image_len,
+				   CONFIG_SYS_BOOTM_LEN, &load_end);
+	}
 	if (err) {
 		err = handle_decomp_error(os.comp, load_end - load,
 					  CONFIG_SYS_BOOTM_LEN, err);
@@ -988,6 +1011,9 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 
 	images->state |= states;
 
+	/* Hashes checked in parallel only hold for this run of states */
+	images->fit_verified_count = 0;
+
 	/*
 	 * Work through the states and see how far we get. We stop on
 	 * any error.
@@ -999,7 +1025,8 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 		ret = bootm_pre_load(bmi->addr_img);
 
 	if (!ret && (states & BOOTM_STATE_FINDOS))
-		ret = bootm_find_os(bmi->cmd_name, bmi->addr_img);
+		ret = bootm_find_os(bmi->cmd_name, bmi->addr_img,
+				    states & BOOTM_STATE_LOADOS);
 
 	if (!ret && (states & BOOTM_STATE_FINDOTHER)) {
 		ulong img_addr;
@@ -1061,6 +1088,17 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 		return 1;
 	}
 
+	/* Never start a FIT kernel whose hashes have not been checked */
+	if (CONFIG_IS_ENABLED(FIT_STREAM_LOAD) && images->fit_verify_os &&
+	    need_boot_fn) {
+		if (iflag)
+			enable_interrupts();
+		puts("ERROR: kernel hashes not verified, use 'bootm loados'\n");
+		bootstage_error(BOOTSTAGE_ID_FIT_KERNEL_START +
+				BOOTSTAGE_SUB_HASH);
+		return 1;
+	}
+
 	/* Call various other states that are not generally used */
 	if (!ret && (states & BOOTM_STATE_OS_CMDLINE))
 		ret = boot_fn(BOOTM_STATE_OS_CMDLINE, bmi);
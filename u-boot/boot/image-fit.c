@@ -25,15 +25,19 @@
 #include <asm/io.h>
 #include <malloc.h>
 #include <memalign.h>
+#include <time.h>
 #include <asm/global_data.h>
 #ifdef CONFIG_DM_HASH
 #include <dm.h>
 #include <u-boot/hash.h>
 #endif
+#include <watchdog.h>
+#include <worker.h>
 DECLARE_GLOBAL_DATA_PTR;
 #endif /* !USE_HOSTCC*/
 
 #include <bootm.h>
+#include <decomp.h>
 #include <image.h>
 #include <bootstage.h>
 #include <u-boot/crc.h>
@@ -1445,6 +1449,549 @@ err:
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(FIT_STREAM_LOAD) || CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+#define FIT_HASH_ONLY_MAX	4
+
+bool fit_image_hash_only(const void *fit, int image_noffset)
+{
+	const void *key_blob = gd_fdt_blob();
+	struct hash_algo *algo;
+	const char *name;
+	int noffset, count = 0;
+
+	if (IS_ENABLED(CONFIG_FIT_SIGNATURE) &&
+	    strchr(fit_get_name(fit, image_noffset, NULL), '@'))
+		return false;
+
+	if (IS_ENABLED(CONFIG_FIT_CIPHER) &&
+	    fdt_subnode_offset(fit, image_noffset, FIT_CIPHER_NODENAME) >= 0)
+		return false;
+
+	/* Signatures are checked over the whole data, so leave them alone */
+	if (FIT_IMAGE_ENABLE_VERIFY) {
+		noffset = fdt_subnode_offset(key_blob, 0, FIT_SIG_NODENAME);
+		if (noffset >= 0) {
+			fdt_for_each_subnode(noffset, key_blob, noffset) {
+				name = fdt_getprop(key_blob, noffset,
+						   FIT_KEY_REQUIRED, NULL);
+				if (name && !strcmp(name, "image"))
+					return false;
+			}
+		}
+	}
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		name = fit_get_name(fit, noffset, NULL);
+		if (FIT_IMAGE_ENABLE_VERIFY &&
+		    !strncmp(name, FIT_SIG_NODENAME, strlen(FIT_SIG_NODENAME)))
+			return false;
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &name) ||
+		    hash_progressive_lookup_algo(name, &algo) ||
+		    ++count > FIT_HASH_ONLY_MAX)
+			return false;
+	}
+
+	return true;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(FIT_STREAM_LOAD)
+
+/**
+ * struct fit_stream_hash - a hash calculated by fit_image_load_stream()
+ *
+ * @noffset:	hash node
+ * @algo:	hash algorithm
+ * @ctx:	hash context
+ */
+struct fit_stream_hash {
+	int noffset;
+	struct hash_algo *algo;
+	void *ctx;
+};
+
+/**
+ * fit_stream_check_hashes() - finish the hashes and check them
+ *
+ * @fit:	FIT blob
+ * @hashes:	hashes to check, their contexts are freed
+ * @count:	number of entries in @hashes
+ * @err_msgp:	returns the error message on failure
+ * @bad_noffsetp: returns the failing hash node on failure
+ * Return: 0 if all hashes match, -EACCES otherwise
+ */
+static int fit_stream_check_hashes(const void *fit,
+				   struct fit_stream_hash *hashes, int count,
+				   char **err_msgp, int *bad_noffsetp)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	struct fit_stream_hash *hash;
+	uint8_t *fit_value;
+	int fit_value_len;
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		hash = &hashes[i];
+		if (hash->algo->hash_finish(hash->algo, hash->ctx, value,
+					    hash->algo->digest_size)) {
+			*err_msgp = "Unsupported hash algorithm";
+		} else if (ret) {
+			continue;
+		} else if (fit_image_hash_get_value(fit, hash->noffset,
+						    &fit_value,
+						    &fit_value_len)) {
+			*err_msgp = "Can't get hash value property";
+		} else if (fit_value_len != hash->algo->digest_size) {
+			*err_msgp = "Bad hash value len";
+		} else if (memcmp(value, fit_value, fit_value_len)) {
+			*err_msgp = "Bad hash value";
+		} else {
+			printf("%s+ ", hash->algo->name);
+			continue;
+		}
+		if (!ret)
+			*bad_noffsetp = hash->noffset;
+		ret = -EACCES;
+	}
+
+	return ret;
+}
+
+int fit_image_load_stream(const void *fit, int image_noffset, int comp,
+			  void *load_buf, ulong unc_len, const void *image_buf,
+			  ulong image_len, ulong *lenp)
+{
+	struct fit_stream_hash hashes[FIT_HASH_ONLY_MAX];
+	const uint8_t *src = image_buf;
+	uint8_t *dst = load_buf;
+	int noffset, count = 0, i;
+	struct decomp_stream ds;
+	bool copy_after = false;
+	bool done = false;
+	char *err_msg = "";
+	const char *algo;
+	ulong off, n;
+	int ret;
+
+	puts("   Verifying Hash Integrity while loading ... ");
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		int ignore = 0;
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		if (count == FIT_HASH_ONLY_MAX ||
+		    fit_image_hash_get_algo(fit, noffset, &algo) ||
+		    hash_progressive_lookup_algo(algo, &hashes[count].algo) ||
+		    hashes[count].algo->hash_init(hashes[count].algo,
+						  &hashes[count].ctx)) {
+			err_msg = "Unsupported hash algorithm";
+			ret = -EACCES;
+			goto err_hashes;
+		}
+		hashes[count++].noffset = noffset;
+	}
+
+	if (comp != IH_COMP_NONE) {
+		ret = decomp_stream_init(&ds, comp);
+		if (ret) {
+			err_msg = ret == -ENOSYS ? "Unsupported compression" :
+				  "Cannot set up decompression";
+			goto err_hashes;
+		}
+		ds.next_out = dst;
+		ds.avail_out = unc_len;
+	} else if (image_len > unc_len) {
+		err_msg = "Image too large";
+		ret = -ENOSPC;
+		goto err_hashes;
+	} else if (dst > src && dst < src + image_len) {
+		/* Copying forwards would overwrite data not yet hashed */
+		copy_after = true;
+	}
+
+	/* Each chunk is still in the cache when it is copied or decompressed */
+	for (off = 0, ret = 0; off < image_len && !ret; off += n) {
+		n = min(image_len - off, (ulong)CHUNKSZ);
+		for (i = 0; i < count; i++)
+			hashes[i].algo->hash_update(hashes[i].algo,
+						    hashes[i].ctx, src + off, n,
+						    off + n == image_len);
+
+		if (comp == IH_COMP_NONE) {
+			if (!copy_after && dst != src)
+				memmove(dst + off, src + off, n);
+		} else if (!done) {
+			ds.next_in = src + off;
+			ds.avail_in = n;
+			ds.in_end = off + n == image_len;
+			ret = decomp_stream_run(&ds);
+			if (ret == 1) {
+				done = true;
+				ret = 0;
+			} else if (ret < 0) {
+				err_msg = "Bad compressed data";
+				ret = -EIO;
+			} else if (ds.avail_in) {
+				/* The output is full */
+				err_msg = "Image too large";
+				ret = -ENOSPC;
+			}
+		}
+		schedule();
+	}
+
+	if (comp == IH_COMP_NONE) {
+		if (copy_after)
+			memmove(dst, src, image_len);
+		*lenp = image_len;
+	} else {
+		if (!ret && !done) {
+			if (ds.avail_out) {
+				err_msg = "Truncated compressed data";
+				ret = -EIO;
+			} else {
+				err_msg = "Image too large";
+				ret = -ENOSPC;
+			}
+		}
+		*lenp = ds.total_out;
+		decomp_stream_end(&ds);
+	}
+
+	/* Even if loading failed, a bad hash is the more useful report */
+	if (fit_stream_check_hashes(fit, hashes, count, &err_msg, &noffset))
+		ret = -EACCES;
+	else if (!ret)
+		puts("OK\n");
+	if (ret == -EACCES) {
+		printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+		       err_msg, fit_get_name(fit, noffset, NULL),
+		       fit_get_name(fit, image_noffset, NULL));
+		puts("Bad Data Hash\n");
+	} else if (ret) {
+		goto err;
+	}
+
+	return ret;
+
+err_hashes:
+	for (i = 0; i < count; i++)
+		free(hashes[i].ctx);
+err:
+	printf("error!\n%s in '%s' image node\n", err_msg,
+	       fit_get_name(fit, image_noffset, NULL));
+	return ret;
+}
+#endif /* FIT_STREAM_LOAD */
+
+#if CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY)
+/**
+ * struct fit_par_hash - a hash calculated by a boot-time worker
+ *
+ * @image:	index of the image in the list being checked
+ * @noffset:	hash node
+ * @algo:	hash algorithm
+ * @ctx:	hash context
+ * @data:	image data
+ * @size:	size of the image data
+ */
+struct fit_par_hash {
+	int image;
+	int noffset;
+	struct hash_algo *algo;
+	void *ctx;
+	const void *data;
+	size_t size;
+};
+
+static void fit_par_hash_job(void *arg)
+{
+	struct fit_par_hash *hash = arg;
+
+	hash->algo->hash_update(hash->algo, hash->ctx, hash->data, hash->size,
+				1);
+}
+
+/**
+ * fit_images_verify_parallel() - check the hashes of several images at once
+ *
+ * Each hash of each image which is only protected by hashes is calculated by
+ * a boot-time worker. Other images, and those with a bad hash, are left for
+ * fit_image_verify() to check and report.
+ *
+ * @fit:	FIT blob
+ * @noffsets:	image nodes to check
+ * @count:	number of entries in @noffsets
+ * @verified:	returns, for each image, whether its hashes were checked OK
+ * Return: number of images checked OK, or -ENOMEM
+ */
+static int fit_images_verify_parallel(const void *fit, const int *noffsets,
+				      int count, bool *verified)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	struct fit_par_hash *hashes, *hash;
+	struct worker_job *jobs;
+	int i, first, noffset, num = 0, done = 0, cpus;
+	uint8_t *fit_value;
+	int fit_value_len;
+	const char *algo;
+	const void *data;
+	size_t size;
+	ulong start;
+
+	hashes = calloc(count * FIT_HASH_ONLY_MAX, sizeof(*hashes));
+	jobs = calloc(count * FIT_HASH_ONLY_MAX, sizeof(*jobs));
+	if (!hashes || !jobs) {
+		free(hashes);
+		free(jobs);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		verified[i] = false;
+		if (!fit_image_hash_only(fit, noffsets[i]) ||
+		    fit_image_get_data_and_size(fit, noffsets[i], &data, &size))
+			continue;
+		first = num;
+		fdt_for_each_subnode(noffset, fit, noffsets[i]) {
+			const char *name = fit_get_name(fit, noffset, NULL);
+			int ignore = 0;
+
+			if (strncmp(name, FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)))
+				continue;
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+			hash = &hashes[num];
+			if (fit_image_hash_get_algo(fit, noffset, &algo) ||
+			    hash_progressive_lookup_algo(algo, &hash->algo) ||
+			    hash->algo->hash_init(hash->algo, &hash->ctx))
+				break;
+			hash->image = i;
+			hash->noffset = noffset;
+			hash->data = data;
+			hash->size = size;
+			jobs[num].func = fit_par_hash_job;
+			jobs[num].arg = hash;
+			num++;
+		}
+		if (noffset >= 0) {
+			/* Leave this image for fit_image_verify() */
+			while (num > first)
+				free(hashes[--num].ctx);
+		} else if (num > first) {
+			verified[i] = true;
+		}
+	}
+
+	start = get_timer(0);
+	cpus = worker_run(jobs, num);
+
+	for (i = 0; i < num; i++) {
+		hash = &hashes[i];
+		if (hash->algo->hash_finish(hash->algo, hash->ctx, value,
+					    hash->algo->digest_size) ||
+		    fit_image_hash_get_value(fit, hash->noffset, &fit_value,
+					     &fit_value_len) ||
+		    fit_value_len != hash->algo->digest_size ||
+		    memcmp(value, fit_value, fit_value_len))
+			verified[hash->image] = false;
+	}
+	for (i = 0; i < count; i++)
+		done += verified[i];
+	log_debug("%d of %d images OK, %d hashes on %d CPUs in %lu ms\n",
+		  done, count, num, cpus, get_timer(start));
+	free(hashes);
+	free(jobs);
+
+	return done;
+}
+
+/*
+ * Show the hashes of an image checked by fit_images_verify_parallel(), in the
+ * same way as fit_image_verify()
+ */
+static void fit_image_show_hashes(const void *fit, int image_noffset)
+{
+	const char *algo;
+	int noffset;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		int ignore = 0;
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)) ||
+		    fit_image_hash_get_algo(fit, noffset, &algo))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		printf("%s%s+ ", algo, ignore ? "-skipped " : "");
+	}
+}
+
+/**
+ * fit_all_image_verify_parallel() - check the hashes of all images at once
+ *
+ * @fit:	FIT blob
+ * @images_noffset: images node
+ * Return: for each image, whether its hashes were checked OK, or NULL if
+ * out of memory. The caller must free this.
+ */
+static bool *fit_all_image_verify_parallel(const void *fit, int images_noffset)
+{
+	int noffset, count = 0;
+	bool *verified;
+	int *noffsets;
+
+	fdt_for_each_subnode(noffset, fit, images_noffset)
+		count++;
+	noffsets = calloc(count, sizeof(*noffsets));
+	verified = calloc(count, sizeof(*verified));
+	if (!noffsets || !verified) {
+		free(noffsets);
+		free(verified);
+		return NULL;
+	}
+
+	count = 0;
+	fdt_for_each_subnode(noffset, fit, images_noffset)
+		noffsets[count++] = noffset;
+	fit_images_verify_parallel(fit, noffsets, count, verified);
+	free(noffsets);
+
+	return verified;
+}
+
+/**
+ * fit_conf_verify_parallel() - check the images used by a configuration
+ *
+ * The images checked OK are recorded in @images, so that fit_image_load()
+ * does not check them again.
+ *
+ * @images:	bootm state
+ * @fit:	FIT blob
+ * @cfg_noffset: configuration node
+ * @skip_kernel: leave the kernel for bootm_load_os() to check while loading it
+ */
+static void fit_conf_verify_parallel(struct bootm_headers *images,
+				     const void *fit, int cfg_noffset,
+				     bool skip_kernel)
+{
+	static const char *const props[] = {
+		FIT_KERNEL_PROP, FIT_FDT_PROP, FIT_RAMDISK_PROP,
+		FIT_LOADABLE_PROP, FIT_SETUP_PROP, FIT_FPGA_PROP,
+		FIT_FIRMWARE_PROP,
+	};
+	int noffsets[FIT_VERIFIED_MAX];
+	bool verified[FIT_VERIFIED_MAX];
+	int i, j, k, noffset, count = 0;
+	const char *name;
+
+	images->fit_hdr_verified = fit;
+	images->fit_verified_count = 0;
+	for (i = skip_kernel ? 1 : 0; i < ARRAY_SIZE(props); i++) {
+		for (j = 0; count < FIT_VERIFIED_MAX; j++) {
+			name = fdt_stringlist_get(fit, cfg_noffset, props[i], j,
+						  NULL);
+			if (!name)
+				break;
+			noffset = fit_image_get_node(fit, name);
+			if (noffset < 0)
+				continue;
+			for (k = 0; k < count && noffsets[k] != noffset; k++)
+				;
+			if (k == count)
+				noffsets[count++] = noffset;
+		}
+	}
+
+	if (fit_images_verify_parallel(fit, noffsets, count, verified) <= 0)
+		return;
+	for (i = 0; i < count; i++) {
+		if (verified[i])
+			images->fit_noffset_verified[images->fit_verified_count++] =
+				noffsets[i];
+	}
+}
+
+/* Check if fit_conf_verify_parallel() has already checked an image */
+static bool fit_image_verified(struct bootm_headers *images, const void *fit,
+			       int noffset)
+{
+	int i;
+
+	if (images->fit_hdr_verified != fit)
+		return false;
+	for (i = 0; i < images->fit_verified_count; i++) {
+		if (images->fit_noffset_verified[i] == noffset)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Forget the images checked by fit_conf_verify_parallel() whose data has been
+ * written over by loading another image, so that they are checked again
+ */
+static void fit_image_verified_drop(struct bootm_headers *images,
+				    const void *fit, ulong start, ulong len)
+{
+	const void *data;
+	int i, count = 0;
+	size_t size;
+	ulong addr;
+
+	if (images->fit_hdr_verified != fit)
+		return;
+	for (i = 0; i < images->fit_verified_count; i++) {
+		if (fit_image_get_data_and_size(fit,
+						images->fit_noffset_verified[i],
+						&data, &size))
+			continue;
+		addr = map_to_sysmem(data);
+		if (start < addr + size && start + len > addr)
+			continue;
+		images->fit_noffset_verified[count++] =
+			images->fit_noffset_verified[i];
+	}
+	images->fit_verified_count = count;
+}
+#else
+static void fit_conf_verify_parallel(struct bootm_headers *images,
+				     const void *fit, int cfg_noffset,
+				     bool skip_kernel)
+{
+}
+
+static bool fit_image_verified(struct bootm_headers *images, const void *fit,
+			       int noffset)
+{
+	return false;
+}
+
+static void fit_image_show_hashes(const void *fit, int image_noffset)
+{
+}
+
+static void fit_image_verified_drop(struct bootm_headers *images,
+				    const void *fit, ulong start, ulong len)
+{
+}
+
+static bool *fit_all_image_verify_parallel(const void *fit, int images_noffset)
+{
+	return NULL;
+}
+#endif /* FIT_PARALLEL_VERIFY */
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -1458,10 +2005,12 @@ err:
  */
 int fit_all_image_verify(const void *fit)
 {
+	bool *verified = NULL;
 	int images_noffset;
 	int noffset;
 	int ndepth;
 	int count;
+	int ret = 1;
 
 	/* Find images parent node offset */
 	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
@@ -1471,6 +2020,8 @@ int fit_all_image_verify(const void *fit)
 		return 0;
 	}
 
+	verified = fit_all_image_verify_parallel(fit, images_noffset);
+
 	/* Process all image subnodes, check hashes for each */
 	printf("## Checking hash(es) for FIT Image at %08lx ...\n",
 	       (ulong)fit);
@@ -1485,14 +2036,20 @@ int fit_all_image_verify(const void *fit)
 			 */
 			printf("   Hash(es) for Image %u (%s): ", count,
 			       fit_get_name(fit, noffset, NULL));
-			count++;
 
-			if (!fit_image_verify(fit, noffset))
-				return 0;
+			if (verified && verified[count]) {
+				fit_image_show_hashes(fit, noffset);
+			} else if (!fit_image_verify(fit, noffset)) {
+				ret = 0;
+				break;
+			}
+			count++;
 			printf("\n");
 		}
 	}
-	return 1;
+	free(verified);
+
+	return ret;
 }
 
 static int fit_image_uncipher(const void *fit, int image_noffset,
@@ -1967,18 +2524,24 @@ int fit_get_data_conf_prop(const void *fit, const char *prop_name,
 	return fit_get_data_tail(fit, noffset, data, size);
 }
 
+static int fit_image_check_hashes(const void *fit, int rd_noffset)
+{
+	puts("   Verifying Hash Integrity ... ");
+	if (!fit_image_verify(fit, rd_noffset)) {
+		puts("Bad Data Hash\n");
+		return -EACCES;
+	}
+	puts("OK\n");
+
+	return 0;
+}
+
 static int fit_image_select(const void *fit, int rd_noffset, int verify)
 {
 	fit_image_print(fit, rd_noffset, "   ");
 
-	if (verify) {
-		puts("   Verifying Hash Integrity ... ");
-		if (!fit_image_verify(fit, rd_noffset)) {
-			puts("Bad Data Hash\n");
-			return -EACCES;
-		}
-		puts("OK\n");
-	}
+	if (verify)
+		return fit_image_check_hashes(fit, rd_noffset);
 
 	return 0;
 }
@@ -2064,6 +2627,8 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 	ulong load, load_end, data, len;
 	uint8_t os, comp;
 	const char *prop_name;
+	bool stream = false;
+	bool verified;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -2123,6 +2688,12 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 			puts("OK\n");
 		}
 
+		/* Hash all the images to be booted on all CPUs at once */
+		if (CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY) && images->verify &&
+		    image_type == IH_TYPE_KERNEL)
+			fit_conf_verify_parallel(images, fit, cfg_noffset,
+						 load_op == FIT_LOAD_STREAM);
+
 		bootstage_mark(BOOTSTAGE_ID_FIT_CONFIG);
 
 		noffset = fit_conf_get_prop_node(fit, cfg_noffset, prop_name,
@@ -2137,11 +2708,24 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	verified = CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY) && images->verify &&
+		   fit_image_verified(images, fit, noffset);
+
+	/* If possible, check the hashes while the data is copied */
+	if (CONFIG_IS_ENABLED(FIT_STREAM_LOAD) && images->verify && !verified)
+		stream = fit_image_hash_only(fit, noffset);
+
+	ret = fit_image_select(fit, noffset,
+			       images->verify && !stream && !verified);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
 	}
+	if (verified) {
+		puts("   Verifying Hash Integrity ... ");
+		fit_image_show_hashes(fit, noffset);
+		puts("OK\n");
+	}
 
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_CHECK_ARCH);
 	if (!tools_build() && IS_ENABLED(CONFIG_SANDBOX)) {
@@ -2223,7 +2807,7 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 
 	data = map_to_sysmem(buf);
 	load = data;
-	if (load_op == FIT_LOAD_IGNORED) {
+	if (load_op == FIT_LOAD_IGNORED || load_op == FIT_LOAD_STREAM) {
 		/* Don't load */
 	} else if (fit_image_get_load(fit, noffset, &load)) {
 		if (load_op == FIT_LOAD_REQUIRED) {
@@ -2270,16 +2854,61 @@ int fit_image_load(struct bootm_headers *images, ulong addr,
 		} else {
 			loadbuf = map_sysmem(load, max_decomp_len);
 		}
-		if (image_decomp(comp, load, data, image_type,
-				loadbuf, buf, len, max_decomp_len, &load_end)) {
-			printf("Error decompressing %s\n", prop_name);
+		if (stream && decomp_stream_supported(comp)) {
+			stream = false;
+			ret = fit_image_load_stream(fit, noffset, comp,
+						    loadbuf, max_decomp_len,
+						    buf, len, &len);
+			if (ret == -EACCES) {
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return ret;
+			} else if (ret) {
+				printf("Error decompressing %s\n", prop_name);
+				return -ENOEXEC;
+			}
+		} else {
+			if (image_decomp(comp, load, data, image_type, loadbuf,
+					 buf, len, max_decomp_len, &load_end)) {
+				printf("Error decompressing %s\n", prop_name);
 
-			return -ENOEXEC;
+				return -ENOEXEC;
+			}
+			len = load_end - load;
 		}
-		len = load_end - load;
 	} else if (load != data) {
 		loadbuf = map_sysmem(load, len);
-		memcpy(loadbuf, buf, len);
+		if (stream) {
+			stream = false;
+			ret = fit_image_load_stream(fit, noffset, IH_COMP_NONE,
+						    loadbuf, len, buf, len,
+						    &len);
+			if (ret) {
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return ret;
+			}
+		} else {
+			memcpy(loadbuf, buf, len);
+		}
+	} else if (stream && load_op == FIT_LOAD_STREAM &&
+		   (comp == IH_COMP_NONE || decomp_stream_supported(comp))) {
+		/* bootm_load_os() checks the hashes while loading the OS */
+		stream = false;
+		images->fit_verify_os = true;
+	}
+
+	/* Images checked earlier may have been written over */
+	if (CONFIG_IS_ENABLED(FIT_PARALLEL_VERIFY) && loadbuf != buf)
+		fit_image_verified_drop(images, fit, map_to_sysmem(loadbuf),
+					len);
+
+	if (stream) {
+		ret = fit_image_check_hashes(fit, noffset);
+		if (ret) {
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+			return ret;
+		}
 	}
 
 	if (image_type == IH_TYPE_RAMDISK && comp != IH_COMP_NONE)
@@ -17,33 +17,51 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
+	       "readahead blocks: %u\n"
+	       "readahead hits: %u\n"
 	       "entries: %u\n"
-	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "bytes: %#lx\n"
+	       "blocks/entry: %u\n"
+	       "max bytes: %#lx\n"
+	       "max readahead blocks: %u\n",
+	       stats.hits, stats.partial_hits, stats.misses, stats.evictions,
+	       stats.ra_blocks, stats.ra_hits, stats.entries, stats.bytes,
+	       stats.max_blocks_per_entry, stats.max_bytes,
+	       stats.max_readahead);
 	return 0;
 }
 
 static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 			  int argc, char *const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
-	if (argc != 3)
+	struct block_cache_stats stats;
+	unsigned blocks_per_entry, readahead;
+	unsigned long max_bytes;
+
+	if (argc != 3 && argc != 4)
 		return CMD_RET_USAGE;
 
+	blkcache_stats(&stats);
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	max_bytes = hextoul(argv[2], NULL);
+	readahead = stats.max_readahead;
+	if (argc == 4)
+		readahead = simple_strtoul(argv[3], 0, 0);
+	blkcache_configure(blocks_per_entry, max_bytes, readahead);
+
+	blkcache_stats(&stats);
+	printf("changed to max of %#lx bytes in entries of %u blocks, reading ahead up to %u blocks\n",
+	       stats.max_bytes, stats.max_blocks_per_entry,
+	       stats.max_readahead);
 	return 0;
 }
 
 static struct cmd_tbl cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
-	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(configure, 4, 0, blkc_configure, "", ""),
 };
 
 static int do_blkcache(struct cmd_tbl *cmdtp, int flag,
@@ -67,9 +85,10 @@ static int do_blkcache(struct cmd_tbl *cmdtp, int flag,
 }
 
 U_BOOT_CMD(
-	blkcache, 4, 0, do_blkcache,
+	blkcache, 5, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"blkcache configure <blocks> <size> [<readahead>] "
+	"- set blocks per entry, max cache size in bytes (hex)\n"
+	"    and max blocks to read ahead\n"
 );
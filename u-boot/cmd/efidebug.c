@@ -511,6 +511,34 @@ static int do_efi_show_images(struct cmd_tbl *cmdtp, int flag,
 	return CMD_RET_SUCCESS;
 }
 
+/**
+ * do_efi_show_lookups() - show statistics about handle and protocol lookups
+ *
+ * @cmdtp:	Command table
+ * @flag:	Command flag
+ * @argc:	Number of arguments
+ * @argv:	Argument array
+ * Return:	CMD_RET_SUCCESS on success, CMD_RET_RET_FAILURE on failure
+ *
+ * Implement efidebug "lookups" sub-command.
+ * Show how often handles and protocols have been looked up.
+ */
+static int do_efi_show_lookups(struct cmd_tbl *cmdtp, int flag,
+			       int argc, char *const argv[])
+{
+	struct efi_lookup_stats stats;
+
+	efi_get_lookup_stats(&stats);
+	printf("Handles:          %lu\n", stats.handles);
+	printf("Protocol GUIDs:   %lu\n", stats.protocols);
+	printf("Handle lookups:   %lu (%lu invalid)\n", stats.handle_lookups,
+	       stats.handle_misses);
+	printf("Protocol lookups: %lu\n", stats.protocol_lookups);
+	printf("Locate calls:     %lu\n", stats.locates);
+
+	return CMD_RET_SUCCESS;
+}
+
 static const char * const efi_mem_type_string[] = {
 	[EFI_RESERVED_MEMORY_TYPE] = "RESERVED",
 	[EFI_LOADER_CODE] = "LOADER CODE",
@@ -1563,6 +1591,8 @@ static struct cmd_tbl cmd_efidebug_sub[] = {
 			 "", ""),
 	U_BOOT_CMD_MKENT(images, CONFIG_SYS_MAXARGS, 1, do_efi_show_images,
 			 "", ""),
+	U_BOOT_CMD_MKENT(lookups, CONFIG_SYS_MAXARGS, 1, do_efi_show_lookups,
+			 "", ""),
 	U_BOOT_CMD_MKENT(memmap, CONFIG_SYS_MAXARGS, 1, do_efi_show_memmap,
 			 "", ""),
 	U_BOOT_CMD_MKENT(tables, CONFIG_SYS_MAXARGS, 1, do_efi_show_tables,
@@ -1655,6 +1685,8 @@ U_BOOT_LONGHELP(efidebug,
 	"  - show UEFI handles\n"
 	"efidebug images\n"
 	"  - show loaded images\n"
+	"efidebug lookups\n"
+	"  - show handle and protocol lookup counts\n"
 	"efidebug memmap\n"
 	"  - show UEFI memory map\n"
 	"efidebug tables\n"
@@ -8,6 +8,7 @@
 #include <command.h>
 #include <dm.h>
 #include <nvme.h>
+#include <vsprintf.h>
 
 static int nvme_curr_dev;
 
@@ -37,6 +38,17 @@ static int do_nvme(struct cmd_tbl *cmdtp, int flag, int argc,
 			return ret;
 		}
 	}
+	if (argc == 3 && !strncmp(argv[1], "time", 4)) {
+		struct udevice *udev;
+
+		ret = blk_get_device(UCLASS_NVME, nvme_curr_dev, &udev);
+		if (ret < 0)
+			return CMD_RET_FAILURE;
+
+		nvme_set_io_timeout(udev, dectoul(argv[2], NULL));
+
+		return 0;
+	}
 
 	return blk_common_cmd(argc, argv, UCLASS_NVME, &nvme_curr_dev);
 }
@@ -49,6 +61,7 @@ U_BOOT_CMD(
 	"nvme info - show all available NVMe devices\n"
 	"nvme device [dev] - show or set current NVMe device\n"
 	"nvme part [dev] - print partition table of one or all NVMe devices\n"
+	"nvme timeout ms - set the I/O timeout of the current NVMe device\n"
 	"nvme read addr blk# cnt - read `cnt' blocks starting at block\n"
 	"     `blk#' to memory address `addr'\n"
 	"nvme write addr blk# cnt - write `cnt' blocks starting at block\n"
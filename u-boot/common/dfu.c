@@ -87,6 +87,10 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 			}
 		}
 
+		/* A failure is reported to the host by its next DFU_GETSTATUS */
+		if (dfu_write_pending())
+			pr_err("Deferred DFU write failed!\n");
+
 #ifdef CONFIG_DFU_TIMEOUT
 		unsigned long wait_time = dfu_get_timeout();
 
@@ -22,6 +22,7 @@
 #include <linux/errno.h>
 #else
 #include "mkimage.h"
+#include <arpa/inet.h>
 #include <linux/compiler_attributes.h>
 #include <time.h>
 #include <linux/kconfig.h>
@@ -165,7 +166,9 @@ static int hash_finish_crc16_ccitt(struct hash_algo *algo, void *ctx,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint16_t *)dest_buf) = *((uint16_t *)ctx);
+	/* Big-endian, like crc16_ccitt_wd_buf() */
+	*((uint16_t *)ctx) = htons(*((uint16_t *)ctx));
+	memcpy(dest_buf, ctx, sizeof(uint16_t));
 	free(ctx);
 	return 0;
 }
@@ -192,7 +195,9 @@ static int __maybe_unused hash_finish_crc32(struct hash_algo *algo, void *ctx,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* Big-endian, like crc32_wd_buf() */
+	*((uint32_t *)ctx) = htonl(*((uint32_t *)ctx));
+	memcpy(dest_buf, ctx, sizeof(uint32_t));
 	free(ctx);
 	return 0;
 }
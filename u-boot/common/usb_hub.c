@@ -60,6 +60,9 @@ struct usb_device_scan {
 
 static LIST_HEAD(usb_scan_list);
 
+/* Leave ports on usb_scan_list for usb_hub_scan_pending() */
+static bool usb_scan_deferred;
+
 __weak void usb_hub_reset_devices(struct usb_hub_device *hub, int port)
 {
 	return;
@@ -605,6 +608,26 @@ out:
 	return ret;
 }
 
+void usb_hub_scan_defer(bool defer)
+{
+	usb_scan_deferred = defer;
+}
+
+int usb_hub_scan_pending(void)
+{
+	return usb_device_list_scan();
+}
+
+void usb_hub_scan_cancel(void)
+{
+	struct usb_device_scan *usb_scan, *tmp;
+
+	list_for_each_entry_safe(usb_scan, tmp, &usb_scan_list, list) {
+		list_del(&usb_scan->list);
+		free(usb_scan);
+	}
+}
+
 static struct usb_hub_device *usb_get_hub_device(struct usb_device *dev)
 {
 	struct usb_hub_device *hub;
@@ -879,6 +902,8 @@ static int usb_hub_configure(struct usb_device *dev)
 	/*
 	 * And now call the scanning code which loops over the generated list
 	 */
+	if (usb_scan_deferred)
+		return 0;
 	ret = usb_device_list_scan();
 
 	return ret;
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Boot-time workers
+ *
+ * The boot CPU and any secondary CPUs started by the architecture take jobs
+ * from a shared queue until it is empty, so the jobs do not need to be of a
+ * similar size.
+ */
+
+#include <log.h>
+#include <worker.h>
+#include <linux/kernel.h>
+
+/**
+ * struct worker_queue - jobs being run by worker_run()
+ *
+ * @jobs: Jobs to run
+ * @count: Number of jobs in @jobs
+ * @next: Index of the next job to take
+ */
+struct worker_queue {
+	struct worker_job *jobs;
+	int count;
+	int next;
+};
+
+static void worker_loop(void *arg)
+{
+	struct worker_queue *queue = arg;
+	int i;
+
+	while (1) {
+		i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_ACQ_REL);
+		if (i >= queue->count)
+			break;
+		queue->jobs[i].func(queue->jobs[i].arg);
+	}
+}
+
+int worker_run(struct worker_job *jobs, int count)
+{
+	struct worker_queue queue = {
+		.jobs = jobs,
+		.count = count,
+	};
+	int started = 0;
+
+	if (count > 1)
+		started = arch_worker_start(worker_loop, &queue,
+					    min(count - 1, CONFIG_WORKER_MAX));
+	log_debug("%d jobs, %d secondary CPUs\n", count, started);
+	worker_loop(&queue);
+	if (started)
+		arch_worker_wait();
+
+	return started + 1;
+}
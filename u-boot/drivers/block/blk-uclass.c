@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -429,19 +430,14 @@ static int blk_buffer_aligned(struct bounce_buffer *state)
 	return 1;	/* Default, any buffer is OK */
 }
 
-long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+/* Read blocks from the device, through the bounce buffer if needed */
+static ulong blk_read_dev(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
 
-	if (!ops->read)
-		return -ENOSYS;
-
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
-		return blkcnt;
-
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
 		int ret;
@@ -460,11 +456,75 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 		blks_read = ops->read(dev, start, blkcnt, buf);
 	}
 
+	return blks_read;
+}
+
+/*
+ * Read @blkcnt blocks followed by @ra blocks of readahead in a single device
+ * request, passing them all to the block cache. Returns -ve on error, in
+ * which case the caller should fall back to a plain read.
+ */
+static long blk_read_ahead(struct udevice *dev, lbaint_t start,
+			   lbaint_t blkcnt, lbaint_t ra, void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	ulong blks_read;
+	void *rabuf;
+
+	rabuf = malloc_cache_aligned((blkcnt + ra) * desc->blksz);
+	if (!rabuf)
+		return -ENOMEM;
+
+	blks_read = blk_read_dev(dev, start, blkcnt + ra, rabuf);
+	if (IS_ERR_VALUE(blks_read) || blks_read < blkcnt) {
+		free(rabuf);
+		return -EIO;
+	}
+
+	memcpy(buf, rabuf, blkcnt * desc->blksz);
+	blkcache_fill_readahead(desc->uclass_id, desc->devnum, start, blkcnt,
+				blks_read - blkcnt, desc->blksz, rabuf);
+	free(rabuf);
+
+	return blkcnt;
+}
+
+long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t cached, ra;
+	ulong blks_read;
+
+	if (!ops->read)
+		return -ENOSYS;
+
+	cached = blkcache_read(desc->uclass_id, desc->devnum,
+			       start, blkcnt, desc->blksz, buf);
+	if (cached == blkcnt)
+		return blkcnt;
+
+	/* only the blocks after the cached prefix need to be read */
+	start += cached;
+	blkcnt -= cached;
+	buf += cached * desc->blksz;
+
+	ra = blkcache_readahead(desc->uclass_id, desc->devnum, start, blkcnt,
+				desc->blksz);
+	if (start + blkcnt + ra > desc->lba)
+		ra = start + blkcnt < desc->lba ? desc->lba - start - blkcnt : 0;
+	if (ra && blk_read_ahead(dev, start, blkcnt, ra, buf) == blkcnt)
+		return cached + blkcnt;
+
+	blks_read = blk_read_dev(dev, start, blkcnt, buf);
+	if (IS_ERR_VALUE(blks_read))
+		return cached ? cached : blks_read;
+
 	if (blks_read == blkcnt)
 		blkcache_fill(desc->uclass_id, desc->devnum, start, blkcnt,
 			      desc->blksz, buf);
 
-	return blks_read;
+	return cached + blks_read;
 }
 
 long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
@@ -478,6 +538,7 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	desc->change_seq++;
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -510,6 +571,7 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	desc->change_seq++;
 
 	return ops->erase(dev, start, blkcnt);
 }
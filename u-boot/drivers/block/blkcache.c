@@ -10,37 +10,78 @@
 #include <part.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
+#include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/log2.h>
+
+/*
+ * The cache holds segments of max_blocks_per_entry blocks, each aligned to
+ * a multiple of its size. A segment is looked up by hashing (iftype,
+ * devnum, segment number) and all segments sit on a single LRU list. Only
+ * part of a segment may be valid, which lets a read be served from the
+ * cached prefix while the remainder is fetched from the device.
+ *
+ * The total amount of cached data is bounded by max_bytes.
+ */
+
+#define BLKCACHE_HASH_BITS	6
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
 
 struct block_cache_node {
 	struct list_head lh;
+	struct hlist_node hn;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t seg;
+	lbaint_t lo;		/* first valid block within the segment */
+	lbaint_t hi;		/* one past the last valid block */
 	unsigned long blksz;
+	bool readahead;		/* filled by readahead and not yet used */
 	char *cache;
 };
 
 static LIST_HEAD(block_cache);
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
+
+/* log2 of max_blocks_per_entry */
+static uint seg_shift = 3;
+
+/* Last miss, used to detect sequential access for readahead */
+static struct {
+	int iftype;
+	int devnum;
+	lbaint_t next;
+	lbaint_t window;
+} ra_state = {
+	.iftype = -1,
+};
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_bytes = CONFIG_BLOCK_CACHE_SIZE,
+	.max_readahead = CONFIG_BLOCK_CACHE_READAHEAD,
 };
 
+static uint cache_hash(int iftype, int devnum, lbaint_t seg)
+{
+	u32 val;
+
+	val = (u32)seg ^ (u32)((u64)seg >> 32);
+	val ^= (u32)devnum << 24 ^ (u32)iftype << 16;
+
+	return (val * 0x61c88647) >> (32 - BLKCACHE_HASH_BITS);
+}
+
 static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+					   lbaint_t seg, unsigned long blksz)
 {
 	struct block_cache_node *node;
+	struct hlist_node *pos;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+	hlist_for_each(pos, &block_cache_hash[cache_hash(iftype, devnum, seg)]) {
+		node = hlist_entry(pos, struct block_cache_node, hn);
+		if (node->seg == seg && node->devnum == devnum &&
+		    node->iftype == iftype && node->blksz == blksz) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
 				list_del(&node->lh);
@@ -48,113 +89,243 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 			}
 			return node;
 		}
-	return 0;
+	}
+
+	return NULL;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+static void cache_unlink(struct block_cache_node *node)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
-	}
+	list_del(&node->lh);
+	hlist_del(&node->hn);
+	_stats.entries--;
+	_stats.bytes -= node->blksz << seg_shift;
+}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+static void cache_free(struct block_cache_node *node)
+{
+	free(node->cache);
+	free(node);
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static struct block_cache_node *cache_alloc(int iftype, int devnum,
+					    lbaint_t seg, unsigned long blksz)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	unsigned long bytes = blksz << seg_shift;
+	struct block_cache_node *node = NULL;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	if (bytes > _stats.max_bytes)
+		return NULL;
 
-	if (_stats.max_entries == 0)
-		return;
+	while (_stats.bytes + bytes > _stats.max_bytes) {
+		struct block_cache_node *lru;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		/* pop LRU, keeping one node to reuse if it is the right size */
+		lru = list_last_entry(&block_cache, struct block_cache_node, lh);
+		cache_unlink(lru);
+		_stats.evictions++;
+		debug("drop: seg " LBAF "\n", lru->seg);
+		if (!node && lru->blksz == blksz)
+			node = lru;
+		else
+			cache_free(lru);
 	}
 
-	if (!node->cache) {
+	if (!node) {
+		node = malloc(sizeof(*node));
+		if (!node)
+			return NULL;
 		node->cache = malloc(bytes);
 		if (!node->cache) {
 			free(node);
-			return;
+			return NULL;
 		}
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-
 	node->iftype = iftype;
 	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
+	node->seg = seg;
 	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
+	node->readahead = false;
 	list_add(&node->lh, &block_cache);
+	hlist_add_head(&node->hn,
+		       &block_cache_hash[cache_hash(iftype, devnum, seg)]);
 	_stats.entries++;
+	_stats.bytes += bytes;
+
+	return node;
+}
+
+lbaint_t blkcache_read(int iftype, int devnum,
+		       lbaint_t start, lbaint_t blkcnt,
+		       unsigned long blksz, void *buffer)
+{
+	lbaint_t mask = ((lbaint_t)1 << seg_shift) - 1;
+	char *dst = buffer;
+	lbaint_t done = 0;
+
+	while (done < blkcnt) {
+		lbaint_t blk = start + done;
+		struct block_cache_node *node;
+		lbaint_t off, count;
+
+		node = cache_find(iftype, devnum, blk >> seg_shift, blksz);
+		off = blk & mask;
+		if (!node || off < node->lo || off >= node->hi)
+			break;
+
+		count = min(node->hi - off, blkcnt - done);
+		memcpy(dst, node->cache + off * blksz, count * blksz);
+		if (node->readahead) {
+			node->readahead = false;
+			_stats.ra_hits++;
+		}
+		dst += count * blksz;
+		done += count;
+	}
+
+	if (done == blkcnt) {
+		debug("hit: start " LBAF ", count " LBAFU "\n",
+		      start, blkcnt);
+		++_stats.hits;
+	} else if (done) {
+		debug("partial: start " LBAF ", count " LBAFU ", cached " LBAFU "\n",
+		      start, blkcnt, done);
+		++_stats.partial_hits;
+	} else {
+		debug("miss: start " LBAF ", count " LBAFU "\n",
+		      start, blkcnt);
+		++_stats.misses;
+	}
+
+	return done;
+}
+
+static void cache_fill(int iftype, int devnum, lbaint_t start,
+		       lbaint_t blkcnt, unsigned long blksz,
+		       const char *src, bool readahead)
+{
+	lbaint_t mask = ((lbaint_t)1 << seg_shift) - 1;
+
+	debug("fill: start " LBAF ", count " LBAFU "%s\n",
+	      start, blkcnt, readahead ? " (readahead)" : "");
+
+	while (blkcnt) {
+		lbaint_t seg = start >> seg_shift;
+		lbaint_t off = start & mask;
+		lbaint_t count = min(mask + 1 - off, blkcnt);
+		struct block_cache_node *node;
+
+		node = cache_find(iftype, devnum, seg, blksz);
+		if (node && off <= node->hi && off + count >= node->lo) {
+			/* extend the valid range */
+			node->lo = min(node->lo, off);
+			node->hi = max(node->hi, off + count);
+		} else {
+			if (!node) {
+				node = cache_alloc(iftype, devnum, seg, blksz);
+				if (!node)
+					return;
+			}
+			node->lo = off;
+			node->hi = off + count;
+			node->readahead = readahead;
+		}
+		memcpy(node->cache + off * blksz, src, count * blksz);
+
+		src += count * blksz;
+		start += count;
+		blkcnt -= count;
+	}
+}
+
+void blkcache_fill(int iftype, int devnum,
+		   lbaint_t start, lbaint_t blkcnt,
+		   unsigned long blksz, void const *buffer)
+{
+	/* don't let bulk transfers flush the cache */
+	if (blkcnt * blksz > _stats.max_bytes / 2)
+		return;
+
+	cache_fill(iftype, devnum, start, blkcnt, blksz, buffer, false);
+}
+
+void blkcache_fill_readahead(int iftype, int devnum,
+			     lbaint_t start, lbaint_t blkcnt, lbaint_t ra,
+			     unsigned long blksz, void const *buffer)
+{
+	const char *src = buffer;
+
+	cache_fill(iftype, devnum, start, blkcnt, blksz, src, false);
+	cache_fill(iftype, devnum, start + blkcnt, ra, blksz,
+		   src + blkcnt * blksz, true);
+	_stats.ra_blocks += ra;
+}
+
+lbaint_t blkcache_readahead(int iftype, int devnum,
+			    lbaint_t start, lbaint_t blkcnt,
+			    unsigned long blksz)
+{
+	lbaint_t limit, ra = 0;
+
+	if (ra_state.iftype == iftype && ra_state.devnum == devnum &&
+	    ra_state.next == start && blkcnt < _stats.max_readahead) {
+		/* sequential access: start with a segment, then double */
+		ra = ra_state.window ? ra_state.window * 2 :
+			(lbaint_t)_stats.max_blocks_per_entry;
+		ra = min(ra, (lbaint_t)_stats.max_readahead);
+
+		/* keep within what blkcache_fill() would accept */
+		limit = _stats.max_bytes / 2 / blksz;
+		ra = blkcnt < limit ? min(ra, limit - blkcnt) : 0;
+	}
+
+	ra_state.iftype = iftype;
+	ra_state.devnum = devnum;
+	ra_state.next = start + blkcnt + ra;
+	ra_state.window = ra;
+
+	return ra;
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if (iftype == -1 ||
 		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+			cache_unlink(node);
+			cache_free(node);
 		}
 	}
+
+	if (iftype == -1 ||
+	    (ra_state.iftype == iftype && ra_state.devnum == devnum))
+		ra_state.iftype = -1;
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, unsigned long size, unsigned ra)
 {
+	/* segments must be a power of two so they can be found by shifting */
+	blocks = blocks ? rounddown_pow_of_two(blocks) : 1;
+
 	/* invalidate cache if there is a change */
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
+	    (size != _stats.max_bytes))
 		blkcache_invalidate(-1, 0);
 
+	seg_shift = ilog2(blocks);
 	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.max_bytes = size;
+	_stats.max_readahead = ra;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.partial_hits = 0;
+	_stats.evictions = 0;
+	_stats.ra_blocks = 0;
+	_stats.ra_hits = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -162,6 +333,10 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.partial_hits = 0;
+	_stats.evictions = 0;
+	_stats.ra_blocks = 0;
+	_stats.ra_hits = 0;
 }
 
 void blkcache_free(void)
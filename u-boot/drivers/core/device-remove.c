@@ -206,6 +206,14 @@ int device_remove(struct udevice *dev, uint flags)
 	if (!(dev_get_flags(dev) & DM_FLAG_ACTIVATED))
 		return 0;
 
+	/* Let an unfinished probe complete, so the driver sees a normal remove */
+	if (CONFIG_IS_ENABLED(DM_PROBE_ASYNC) &&
+	    (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING)) {
+		device_probe_wait(dev);
+		if (!(dev_get_flags(dev) & DM_FLAG_ACTIVATED))
+			return 0;
+	}
+
 	ret = device_notify(dev, EVT_DM_PRE_REMOVE);
 	if (ret)
 		return ret;
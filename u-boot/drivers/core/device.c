@@ -9,6 +9,7 @@
  */
 
 #include <cpu_func.h>
+#include <cyclic.h>
 #include <errno.h>
 #include <event.h>
 #include <log.h>
@@ -486,8 +487,13 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
-	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED) {
+		/* Wait for a probe started by the scheduler to complete */
+		if (CONFIG_IS_ENABLED(DM_PROBE_ASYNC) &&
+		    (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING))
+			return device_probe_wait(dev);
 		return 0;
+	}
 
 	ret = device_notify(dev, EVT_DM_PRE_PROBE);
 	if (ret)
@@ -582,10 +588,28 @@ int device_probe(struct udevice *dev)
 
 	if (drv->probe) {
 		ret = drv->probe(dev);
+		/* device_probe_async() has left the probe to be finished later */
+		if (ret == -EINPROGRESS &&
+		    (dev_get_flags(dev) & DM_FLAG_PROBE_PENDING))
+			return 0;
 		if (ret)
 			goto fail;
 	}
 
+	return device_probe_finish(dev, 0);
+fail:
+	dev_bic_flags(dev, DM_FLAG_ACTIVATED);
+
+	device_free(dev);
+
+	return ret;
+}
+
+int device_probe_finish(struct udevice *dev, int ret)
+{
+	if (ret)
+		goto fail;
+
 	ret = uclass_post_probe_device(dev);
 	if (ret)
 		goto fail_uclass;
@@ -616,6 +640,19 @@ fail:
 	return ret;
 }
 
+int device_probe_async(struct udevice *dev, int (*poll)(struct udevice *dev))
+{
+	int ret;
+
+	if (CONFIG_IS_ENABLED(DM_PROBE_ASYNC) && !dm_probe_defer(dev, poll))
+		return -EINPROGRESS;
+
+	while (ret = poll(dev), ret == -EINPROGRESS)
+		schedule();
+
+	return ret;
+}
+
 void *dev_get_plat(const struct udevice *dev)
 {
 	if (!dev) {
@@ -355,4 +355,11 @@ void dm_dump_mem(struct dm_stats *stats)
 	/* Drop the device name */
 	printf("Drop device name (not SRAM): %x (%d)\n", stats->dev_name_size,
 	       stats->dev_name_size);
+
+	if (CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)) {
+		printf("\n");
+		printf("Phandle cache: hits %x (%u), misses %x (%u)\n",
+		       stats->phandle_hits, stats->phandle_hits,
+		       stats->phandle_misses, stats->phandle_misses);
+	}
 }
@@ -11,6 +11,9 @@
 #include <debug_uart.h>
 #include <errno.h>
 #include <log.h>
+#include <malloc.h>
+#include <sort.h>
+#include <asm/global_data.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -20,6 +23,8 @@
 #include <fdtdec.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -196,11 +201,119 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+/**
+ * struct compat_entry - an entry in the index of compatible strings
+ *
+ * @compat: Compatible string
+ * @drv: Driver with @compat in its of_match table
+ * @id: Entry for @compat in the of_match table of @drv
+ */
+struct compat_entry {
+	const char *compat;
+	struct driver *drv;
+	const struct udevice_id *id;
+};
+
+static struct compat_entry *compat_index;
+static int compat_count;
+
+static int compat_entry_cmp(const void *va, const void *vb)
+{
+	const struct compat_entry *a = va, *b = vb;
+	int ret;
+
+	ret = strcmp(a->compat, b->compat);
+	if (ret)
+		return ret;
+
+	/* keep the linker-list order, so the first matching driver wins */
+	if (a->drv != b->drv)
+		return a->drv < b->drv ? -1 : 1;
+
+	return a->id < b->id ? -1 : a->id > b->id;
+}
+
+static int compat_index_build(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_entry *ent;
+	struct driver *drv;
+	int count = 0;
+
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (id = drv->of_match; id && id->compatible; id++)
+			count++;
+	}
+
+	ent = malloc(count * sizeof(*ent));
+	if (!ent)
+		return -ENOMEM;
+	compat_index = ent;
+
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (id = drv->of_match; id && id->compatible; id++) {
+			ent->compat = id->compatible;
+			ent->drv = drv;
+			ent->id = id;
+			ent++;
+		}
+	}
+	qsort(compat_index, count, sizeof(*ent), compat_entry_cmp);
+	compat_count = count;
+	log_debug("Indexed %d compatible strings\n", count);
+
+	return 0;
+}
+
+static struct driver *compat_index_lookup(const char *compat,
+					  const struct udevice_id **idp)
+{
+	int lo = 0, hi = compat_count;
+
+	/* find the first entry which is not before @compat */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (strcmp(compat_index[mid].compat, compat) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == compat_count || strcmp(compat_index[lo].compat, compat))
+		return NULL;
+	*idp = compat_index[lo].id;
+
+	return compat_index[lo].drv;
+}
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+	/*
+	 * The index is built on first use after relocation. Before that the
+	 * heap is small and the drivers have not reached their final address.
+	 */
+	if (CONFIG_IS_ENABLED(DM_COMPAT_INDEX) && (gd->flags & GD_FLG_RELOC) &&
+	    (compat_index || !compat_index_build()))
+		return compat_index_lookup(compat, idp);
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -238,20 +351,16 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
+		if (drv) {
+			entry = drv;
+			if (entry->of_match &&
+			    driver_check_compatible(entry->of_match, &id, compat))
+				continue;
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			if (!entry)
+				continue;
 		}
-		if (entry == driver + n_ents)
-			continue;
 
 		if (pre_reloc_only) {
 			if (!ofnode_pre_reloc(node) &&
@@ -47,6 +47,30 @@ static struct device_node *of_stdout;
 /* pointer to options given after the alias (separated by :) or NULL if none */
 static const char *of_stdout_options;
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/**
+ * struct of_phandle_cache - nodes of a tree, indexed by phandle
+ *
+ * @link:	List node to link the structure in of_phandle_caches list
+ * @root:	Root node of the tree
+ * @count:	Number of entries in @nodes, one more than the highest phandle
+ * @nodes:	Node for each phandle, or NULL if none
+ */
+struct of_phandle_cache {
+	struct list_head link;
+	const struct device_node *root;
+	uint count;
+	struct device_node *nodes[];
+};
+
+/* list of struct of_phandle_cache, one for each tree */
+static LIST_HEAD(of_phandle_caches);
+
+/* number of phandle lookups answered by, and not by, a cache */
+static uint of_phandle_hits;
+static uint of_phandle_misses;
+#endif
+
 /**
  * struct alias_prop - Alias property in 'aliases' node
  *
@@ -55,6 +79,7 @@ static const char *of_stdout_options;
  *
  * @link:	List node to link the structure in aliases_lookup list
  * @alias:	Alias property name
+ * @path:	Alias property value, when @np was looked up
  * @np:		Pointer to device_node that the alias stands for
  * @id:		Index value from end of alias name
  * @stem:	Alias string without the index
@@ -62,6 +87,7 @@ static const char *of_stdout_options;
 struct alias_prop {
 	struct list_head link;
 	const char *alias;
+	const void *path;
 	struct device_node *np;
 	int id;
 	char stem[0];
@@ -343,6 +369,19 @@ static struct device_node *__of_find_node_by_path(struct device_node *parent,
 #define for_each_property_of_node(dn, pp) \
 	for (pp = dn->properties; pp != NULL; pp = pp->next)
 
+/* Find the node for an alias, using that found by of_alias_scan() if any */
+static struct device_node *of_alias_find_node(const struct property *pp)
+{
+	struct alias_prop *app;
+
+	list_for_each_entry(app, &aliases_lookup, link) {
+		if (app->alias == pp->name && app->path == pp->value)
+			return app->np;
+	}
+
+	return of_find_node_by_path(pp->value);
+}
+
 struct device_node *of_find_node_opts_by_path(struct device_node *root,
 					      const char *path,
 					      const char **opts)
@@ -378,7 +417,7 @@ struct device_node *of_find_node_opts_by_path(struct device_node *root,
 		for_each_property_of_node(of_aliases, pp) {
 			if (strlen(pp->name) == len && !strncmp(pp->name, path,
 								len)) {
-				np = of_find_node_by_path(pp->value);
+				np = of_alias_find_node(pp);
 				break;
 			}
 		}
@@ -445,6 +484,111 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 	return np;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+static struct of_phandle_cache *
+of_phandle_cache_find(const struct device_node *root)
+{
+	struct of_phandle_cache *cache;
+
+	list_for_each_entry(cache, &of_phandle_caches, link) {
+		if (cache->root == root)
+			return cache;
+	}
+
+	return NULL;
+}
+
+int of_phandle_cache_build(struct device_node *root)
+{
+	struct of_phandle_cache *cache;
+	struct device_node *np;
+	uint max = 0, count = 0;
+
+	of_phandle_cache_free(root);
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->phandle) {
+			max = max(max, np->phandle);
+			count++;
+		}
+	}
+
+	/* Phandles are normally allocated in order, but may not be */
+	if (max > 2 * count + 64) {
+		log_debug("Phandles too sparse to cache (%u of %u)\n", count,
+			  max);
+		return 0;
+	}
+	cache = calloc(1, sizeof(*cache) + (max + 1) * sizeof(np));
+	if (!cache)
+		return -ENOMEM;
+	cache->root = root;
+	cache->count = max + 1;
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->phandle && !cache->nodes[np->phandle])
+			cache->nodes[np->phandle] = np;
+	}
+	list_add(&cache->link, &of_phandle_caches);
+
+	return 0;
+}
+
+void of_phandle_cache_free(const struct device_node *root)
+{
+	struct of_phandle_cache *cache;
+
+	cache = of_phandle_cache_find(root);
+	if (cache) {
+		list_del(&cache->link);
+		free(cache);
+	}
+}
+
+void of_phandle_cache_get_stats(uint *hitsp, uint *missesp)
+{
+	*hitsp = of_phandle_hits;
+	*missesp = of_phandle_misses;
+}
+
+/* Look up a phandle in the tree's cache, returning false if it has none */
+static bool of_phandle_cache_lookup(const struct device_node *root,
+				    phandle handle, struct device_node **npp)
+{
+	struct of_phandle_cache *cache;
+
+	cache = of_phandle_cache_find(root);
+	if (!cache) {
+		of_phandle_misses++;
+		return false;
+	}
+	of_phandle_hits++;
+	*npp = handle < cache->count ? cache->nodes[handle] : NULL;
+
+	return true;
+}
+
+/* Drop the nodes in a subtree which is being removed from the tree */
+static void of_phandle_cache_remove(struct device_node *to_remove)
+{
+	struct of_phandle_cache *cache;
+	struct device_node *root, *np;
+	uint i;
+
+	for (root = to_remove; root->parent; root = root->parent)
+		;
+	cache = of_phandle_cache_find(root);
+	if (!cache)
+		return;
+	for (i = 0; i < cache->count; i++) {
+		for (np = cache->nodes[i]; np; np = np->parent) {
+			if (np == to_remove) {
+				cache->nodes[i] = NULL;
+				break;
+			}
+		}
+	}
+}
+#endif
+
 struct device_node *of_find_node_by_phandle(struct device_node *root,
 					    phandle handle)
 {
@@ -453,6 +597,10 @@ struct device_node *of_find_node_by_phandle(struct device_node *root,
 	if (!handle)
 		return NULL;
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+	if (of_phandle_cache_lookup(root ? root : gd->of_root, handle, &np))
+		return np;
+#endif
 	for_each_of_allnodes_from(root, np)
 		if (np->phandle == handle)
 			break;
@@ -886,6 +1034,7 @@ int of_alias_scan(void)
 			return -ENOMEM;
 		memset(ap, 0, sizeof(*ap) + len + 1);
 		ap->alias = start;
+		ap->path = pp->value;
 		of_alias_add(ap, np, id, start, len);
 	}
 
@@ -1087,6 +1236,10 @@ int of_remove_node(struct device_node *to_remove)
 	if (!np)
 		return -EFAULT;
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+	of_phandle_cache_remove(to_remove);
+#endif
+
 	/* if there is a previous node, link it to this one's sibling */
 	if (prev)
 		prev->sibling = np->sibling;
@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Probe scheduler, which lets devices that wait for their hardware finish
+ * probing in the background
+ *
+ * A driver which calls device_probe_async() while being probed by
+ * dm_probe_run() is left with DM_FLAG_ACTIVATED and DM_FLAG_PROBE_PENDING
+ * set, so device_active() is false for it. Its poll function is called from
+ * the cyclic framework, so the wait overlaps with probing other devices, but
+ * the probe is only finished (uclass post_probe() and so on) from a safe
+ * point: dm_probe_run(), anything which probes the device, or the start of
+ * the main loop.
+ */
+
+#define LOG_CATEGORY LOGC_DM
+
+#include <cyclic.h>
+#include <event.h>
+#include <log.h>
+#include <malloc.h>
+#include <dm/device.h>
+#include <dm/device-internal.h>
+#include <dm/ofnode.h>
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/string.h>
+
+/**
+ * struct dm_probe_pending - a device whose probe has not finished
+ *
+ * @sibling: Node in dm_probe_pending_list
+ * @dev: Device being probed
+ * @poll: Function to check whether the probe is complete
+ * @ret: Last result of @poll, -EINPROGRESS until it is complete
+ * @busy: true while @poll is running, so it is not called again from within
+ */
+struct dm_probe_pending {
+	struct list_head sibling;
+	struct udevice *dev;
+	int (*poll)(struct udevice *dev);
+	int ret;
+	bool busy;
+};
+
+static LIST_HEAD(dm_probe_pending_list);
+static struct cyclic_info dm_probe_cyclic;
+
+/* Device which dm_probe_run() is probing, so may be deferred */
+static struct udevice *dm_probe_cur;
+
+static struct dm_probe_pending *dm_probe_find(struct udevice *dev)
+{
+	struct dm_probe_pending *p;
+
+	list_for_each_entry(p, &dm_probe_pending_list, sibling) {
+		if (p->dev == dev)
+			return p;
+	}
+
+	return NULL;
+}
+
+static void dm_probe_poll(struct dm_probe_pending *p)
+{
+	if (p->ret != -EINPROGRESS || p->busy)
+		return;
+	p->busy = true;
+	p->ret = p->poll(p->dev);
+	p->busy = false;
+}
+
+static void dm_probe_poll_all(struct cyclic_info *c)
+{
+	struct dm_probe_pending *p;
+
+	list_for_each_entry(p, &dm_probe_pending_list, sibling)
+		dm_probe_poll(p);
+}
+
+/*
+ * Stop polling, if the cyclic function is still registered; it is not when
+ * cyclic_unregister_all() has been called, e.g. between tests
+ */
+static void dm_probe_cyclic_stop(void)
+{
+#if CONFIG_IS_ENABLED(CYCLIC)
+	struct cyclic_info *c;
+
+	hlist_for_each_entry(c, cyclic_get_list(), list) {
+		if (c == &dm_probe_cyclic) {
+			cyclic_unregister(c);
+			break;
+		}
+	}
+#endif
+}
+
+/* Finish the probe of a device whose poll function is done */
+static int dm_probe_complete(struct dm_probe_pending *p)
+{
+	struct udevice *dev = p->dev;
+	int ret = p->ret;
+
+	list_del(&p->sibling);
+	free(p);
+	if (list_empty(&dm_probe_pending_list))
+		dm_probe_cyclic_stop();
+	dev_bic_flags(dev, DM_FLAG_PROBE_PENDING);
+
+	ret = device_probe_finish(dev, ret);
+	if (ret)
+		log_debug("Failed to probe '%s': %dE\n", dev->name, ret);
+
+	return ret;
+}
+
+int dm_probe_defer(struct udevice *dev, int (*poll)(struct udevice *dev))
+{
+	struct dm_probe_pending *p;
+
+	if (dev != dm_probe_cur)
+		return -EPERM;
+
+	p = malloc(sizeof(*p));
+	if (!p)
+		return -ENOMEM;
+	p->dev = dev;
+	p->poll = poll;
+	p->ret = -EINPROGRESS;
+	p->busy = false;
+
+	if (list_empty(&dm_probe_pending_list))
+		cyclic_register(&dm_probe_cyclic, dm_probe_poll_all, 0,
+				"dm_probe");
+	list_add_tail(&p->sibling, &dm_probe_pending_list);
+	dev_or_flags(dev, DM_FLAG_PROBE_PENDING);
+	log_debug("Probe of '%s' pending\n", dev->name);
+
+	return 0;
+}
+
+int device_probe_wait(struct udevice *dev)
+{
+	struct dm_probe_pending *p;
+
+	p = dm_probe_find(dev);
+	if (!p)
+		return 0;
+
+	/* The device is in use from within its own poll function */
+	if (p->busy)
+		return 0;
+
+	for (dm_probe_poll(p); p->ret == -EINPROGRESS; dm_probe_poll(p))
+		schedule();
+
+	return dm_probe_complete(p);
+}
+
+/* Finish any probes whose poll function is done; return how many */
+static int dm_probe_complete_done(void)
+{
+	struct dm_probe_pending *p;
+	int count = 0;
+
+	/* Finishing a probe may finish others, so start again each time */
+again:
+	list_for_each_entry(p, &dm_probe_pending_list, sibling) {
+		if (p->ret != -EINPROGRESS && !p->busy) {
+			dm_probe_complete(p);
+			count++;
+			goto again;
+		}
+	}
+
+	return count;
+}
+
+static int dm_probe_wait_all(void)
+{
+	struct dm_probe_pending *p;
+
+	while (!list_empty(&dm_probe_pending_list)) {
+		p = list_first_entry(&dm_probe_pending_list,
+				     struct dm_probe_pending, sibling);
+		device_probe_wait(p->dev);
+	}
+
+	return 0;
+}
+EVENT_SPY_SIMPLE(EVT_MAIN_LOOP, dm_probe_wait_all);
+
+/* Check whether a node, or the node of one of its parents, is pending */
+static bool dm_probe_node_pending(ofnode node)
+{
+	struct dm_probe_pending *p;
+
+	for (; ofnode_valid(node); node = ofnode_get_parent(node)) {
+		list_for_each_entry(p, &dm_probe_pending_list, sibling) {
+			if (ofnode_equal(node, dev_ofnode(p->dev)))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static bool dm_probe_list_pending(ofnode node, const char *list_name,
+				  const char *cells_name)
+{
+	struct ofnode_phandle_args args;
+	int i;
+
+	for (i = 0;; i++) {
+		if (ofnode_parse_phandle_with_args(node, list_name, cells_name,
+						   0, i, &args))
+			break;
+		if (dm_probe_node_pending(args.node))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Check whether a device must wait for a pending probe: that of a parent or a
+ * supplier named in its device tree node
+ */
+static bool dm_probe_deps_pending(struct udevice *dev)
+{
+	ofnode node = dev_ofnode(dev);
+	struct udevice *parent;
+	struct ofprop prop;
+	const char *name;
+	int len;
+
+	if (list_empty(&dm_probe_pending_list))
+		return false;
+
+	for (parent = dev->parent; parent; parent = parent->parent) {
+		if (dev_get_flags(parent) & DM_FLAG_PROBE_PENDING)
+			return true;
+	}
+	if (!ofnode_valid(node))
+		return false;
+
+	if (dm_probe_list_pending(node, "clocks", "#clock-cells") ||
+	    dm_probe_list_pending(node, "power-domains",
+				  "#power-domain-cells") ||
+	    dm_probe_list_pending(node, "resets", "#reset-cells"))
+		return true;
+
+	ofnode_for_each_prop(prop, node) {
+		ofprop_get_property(&prop, &name, &len);
+		len = strlen(name);
+		if (len > 7 && !strcmp(name + len - 7, "-supply") &&
+		    dm_probe_list_pending(node, name, NULL))
+			return true;
+	}
+
+	return false;
+}
+
+/* Add devices to be probed to @queue (if not NULL), parents first */
+static int dm_probe_collect(struct udevice *dev, struct udevice **queue,
+			    int count)
+{
+	struct udevice *child;
+
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_AFTER_BIND) {
+		if (queue)
+			queue[count] = dev;
+		count++;
+	}
+	list_for_each_entry(child, &dev->child_head, sibling_node)
+		count = dm_probe_collect(child, queue, count);
+
+	return count;
+}
+
+static bool dm_probe_is_ancestor(struct udevice *parent, struct udevice *dev)
+{
+	for (dev = dev->parent; dev; dev = dev->parent) {
+		if (dev == parent)
+			return true;
+	}
+
+	return false;
+}
+
+int dm_probe_run(struct udevice *root)
+{
+	struct udevice **queue;
+	struct udevice *dev;
+	int count, left, i, j;
+	bool progress;
+	int ret;
+
+	count = dm_probe_collect(root, NULL, 0);
+	if (!count)
+		return 0;
+	queue = malloc(count * sizeof(*queue));
+	if (!queue)
+		return -ENOMEM;
+	dm_probe_collect(root, queue, 0);
+
+	for (left = count; left;) {
+		progress = false;
+		for (i = 0; i < count; i++) {
+			dev = queue[i];
+			if (!dev || dm_probe_deps_pending(dev))
+				continue;
+
+			dm_probe_cur = dev;
+			ret = device_probe(dev);
+			dm_probe_cur = NULL;
+			queue[i] = NULL;
+			left--;
+			progress = true;
+			if (!ret)
+				continue;
+
+			/* As before, skip the children of a failed device */
+			log_debug("Failed to probe '%s': %dE\n", dev->name, ret);
+			for (j = i + 1; j < count; j++) {
+				if (queue[j] && dm_probe_is_ancestor(dev, queue[j])) {
+					queue[j] = NULL;
+					left--;
+				}
+			}
+		}
+
+		/* Everything left waits for a pending probe; let them run */
+		if (!progress) {
+			dm_probe_poll_all(NULL);
+			if (!dm_probe_complete_done())
+				schedule();
+		}
+	}
+	free(queue);
+
+	/* Without the cyclic framework nothing would poll the rest */
+	if (!CONFIG_IS_ENABLED(CYCLIC))
+		dm_probe_wait_all();
+
+	return 0;
+}
+
+void dm_probe_reset(void)
+{
+	struct dm_probe_pending *p, *next;
+
+	list_for_each_entry_safe(p, next, &dm_probe_pending_list, sibling)
+		free(p);
+	INIT_LIST_HEAD(&dm_probe_pending_list);
+	dm_probe_cyclic_stop();
+	dm_probe_cur = NULL;
+}
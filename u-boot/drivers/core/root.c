@@ -99,6 +99,8 @@ int dm_init(bool of_live)
 		dm_warn("Virtual root driver already exists!\n");
 		return -EINVAL;
 	}
+	if (CONFIG_IS_ENABLED(DM_PROBE_ASYNC))
+		dm_probe_reset();
 	if (CONFIG_IS_ENABLED(OF_PLATDATA_INST)) {
 		gd->uclass_root = &uclass_head;
 	} else {
@@ -117,8 +119,11 @@ int dm_init(bool of_live)
 					  &DM_ROOT_NON_CONST);
 		if (ret)
 			return ret;
-		if (CONFIG_IS_ENABLED(OF_CONTROL))
+		if (CONFIG_IS_ENABLED(OF_CONTROL)) {
 			dev_set_ofnode(DM_ROOT_NON_CONST, ofnode_root());
+			if (CONFIG_IS_ENABLED(DM_NODE_INDEX))
+				uclass_index_device(DM_ROOT_NON_CONST);
+		}
 		ret = device_probe(DM_ROOT_NON_CONST);
 		if (ret)
 			return ret;
@@ -337,6 +342,9 @@ static int dm_scan(bool pre_reloc_only)
 	if (ret)
 		return ret;
 
+	if (CONFIG_IS_ENABLED(DM_PROBE_ASYNC) && !pre_reloc_only)
+		return dm_probe_run(gd->dm_root);
+
 	return dm_probe_devices(gd->dm_root, pre_reloc_only);
 }
 
@@ -420,6 +428,17 @@ void dm_get_mem(struct dm_stats *stats)
 	dev_collect_stats(stats, gd->dm_root);
 	uclass_collect_stats(stats);
 	dev_tag_collect_stats(stats);
+	if (CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)) {
+		uint hits, misses;
+
+		fdtdec_phandle_cache_get_stats(&stats->phandle_hits,
+					       &stats->phandle_misses);
+		if (CONFIG_IS_ENABLED(OF_LIVE)) {
+			of_phandle_cache_get_stats(&hits, &misses);
+			stats->phandle_hits += hits;
+			stats->phandle_misses += misses;
+		}
+	}
 
 	stats->total_size = stats->dev_size + stats->uc_size +
 		stats->attach_size_total + stats->uc_attach_size +
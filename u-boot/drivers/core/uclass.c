@@ -41,6 +41,98 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+/* Initial size of the hash tables, which grow as devices are bound */
+#define UCLASS_HASH_MIN_BITS	3
+
+static uint uclass_hash(ulong val, uint bits)
+{
+	u32 v = val ^ (u32)((u64)val >> 32);
+
+	return (v * 0x9e3779b1) >> (32 - bits);
+}
+
+/* Add to the end of a chain, so lookups find devices in bind order */
+static void uclass_hash_add(struct hlist_node *n, struct hlist_head *head)
+{
+	struct hlist_node *last;
+
+	if (hlist_empty(head)) {
+		hlist_add_head(n, head);
+		return;
+	}
+	for (last = head->first; last->next; last = last->next)
+		;
+	hlist_add_after(last, n);
+}
+
+static void uclass_index_insert(struct uclass *uc, struct udevice *dev)
+{
+	uint phandle;
+
+	uclass_hash_add(&dev->node_hash,
+			&uc->node_hash[uclass_hash(dev_ofnode(dev).of_offset,
+						   uc->hash_bits)]);
+	phandle = dev_read_phandle(dev);
+	if (phandle)
+		uclass_hash_add(&dev->phandle_hash,
+				&uc->phandle_hash[uclass_hash(phandle,
+							      uc->hash_bits)]);
+}
+
+/*
+ * Set up hash tables with 2^bits entries, moving the devices from the old
+ * ones, if any. On failure the old tables are kept, since they still work.
+ */
+static int uclass_index_resize(struct uclass *uc, uint bits)
+{
+	struct hlist_head *old = uc->node_hash;
+	struct hlist_head *hash;
+	struct udevice *dev;
+
+	hash = calloc(2 << bits, sizeof(*hash));
+	if (!hash)
+		return -ENOMEM;
+	uc->node_hash = hash;
+	uc->phandle_hash = hash + (1 << bits);
+	uc->hash_bits = bits;
+
+	if (old) {
+		uclass_foreach_dev(dev, uc) {
+			if (hlist_unhashed(&dev->node_hash))
+				continue;
+			INIT_HLIST_NODE(&dev->phandle_hash);
+			uclass_index_insert(uc, dev);
+		}
+		free(old);
+	}
+
+	return 0;
+}
+
+void uclass_index_device(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	if (!uc->node_hash || !dev_has_ofnode(dev))
+		return;
+	uclass_unindex_device(dev);
+	if (uc->hash_count >= 1 << uc->hash_bits)
+		uclass_index_resize(uc, uc->hash_bits + 1);
+	uclass_index_insert(uc, dev);
+	uc->hash_count++;
+}
+
+void uclass_unindex_device(struct udevice *dev)
+{
+	if (hlist_unhashed(&dev->node_hash))
+		return;
+	hlist_del_init(&dev->node_hash);
+	hlist_del_init(&dev->phandle_hash);
+	dev->uclass->hash_count--;
+}
+#endif
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -85,6 +177,14 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, DM_UCLASS_ROOT_NON_CONST);
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	/*
+	 * Before relocation the devices are few and the heap is small, so
+	 * they are not indexed. Without the tables, lookups scan the devices.
+	 */
+	if (gd->flags & GD_FLG_RELOC)
+		uclass_index_resize(uc, UCLASS_HASH_MIN_BITS);
+#endif
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -101,6 +201,9 @@ fail:
 		uclass_set_priv(uc, NULL);
 	}
 	list_del(&uc->sibling_node);
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	free(uc->node_hash);
+#endif
 fail_mem:
 	free(uc);
 
@@ -136,6 +239,9 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto)
 		free(uclass_get_priv(uc));
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	free(uc->node_hash);
+#endif
 	free(uc);
 
 	return 0;
@@ -393,6 +499,22 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	if (uc->node_hash) {
+		struct hlist_head *head;
+
+		head = &uc->node_hash[uclass_hash(node.of_offset,
+						  uc->hash_bits)];
+		hlist_for_each_entry(dev, head, node_hash) {
+			if (ofnode_equal(dev_ofnode(dev), node)) {
+				*devp = dev;
+				goto done;
+			}
+		}
+		ret = -ENODEV;
+		goto done;
+	}
+#endif
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -410,9 +532,8 @@ done:
 }
 
 #if CONFIG_IS_ENABLED(OF_REAL)
-static int uclass_find_device_by_phandle_id(enum uclass_id id,
-					    uint find_phandle,
-					    struct udevice **devp)
+int uclass_find_device_by_phandle_id(enum uclass_id id, uint find_phandle,
+				     struct udevice **devp)
 {
 	struct udevice *dev;
 	struct uclass *uc;
@@ -422,6 +543,22 @@ static int uclass_find_device_by_phandle_id(enum uclass_id id,
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	if (uc->node_hash) {
+		struct hlist_head *head;
+
+		head = &uc->phandle_hash[uclass_hash(find_phandle,
+						     uc->hash_bits)];
+		hlist_for_each_entry(dev, head, phandle_hash) {
+			if (dev_read_phandle(dev) == find_phandle) {
+				*devp = dev;
+				return 0;
+			}
+		}
+
+		return -ENODEV;
+	}
+#endif
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -693,6 +830,8 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	if (CONFIG_IS_ENABLED(DM_NODE_INDEX))
+		uclass_index_device(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -707,6 +846,8 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	if (CONFIG_IS_ENABLED(DM_NODE_INDEX))
+		uclass_unindex_device(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -730,6 +871,8 @@ int uclass_pre_unbind_device(struct udevice *dev)
 
 int uclass_unbind_device(struct udevice *dev)
 {
+	if (CONFIG_IS_ENABLED(DM_NODE_INDEX))
+		uclass_unindex_device(dev);
 	list_del(&dev->uclass_node);
 
 	return 0;
@@ -183,10 +183,44 @@ static unsigned char *dfu_buf;
 static unsigned long dfu_buf_size;
 static enum dfu_device_type dfu_buf_device_type;
 
+/*
+ * dfu_buf holds a ring of CONFIG_DFU_BUF_COUNT buffers of dfu_buf_size bytes.
+ * Full buffers wait in the ring, oldest first from dfu_ring_head, to be
+ * written out by dfu_write_pending() while the next one is filled.
+ */
+static struct dfu_entity *dfu_ring_dfu;
+static int dfu_ring_head;
+static int dfu_ring_pending;
+static long dfu_ring_len[CONFIG_DFU_BUF_COUNT];
+
+/* Error from a write by dfu_write_pending(), until the host is told of it */
+static int dfu_ring_err;
+
+#if CONFIG_DFU_BUF_COUNT > 1
+#define DFU_BUF_HIGH_WATER	min(CONFIG_DFU_BUF_HIGH_WATER, \
+				    CONFIG_DFU_BUF_COUNT - 1)
+#else
+#define DFU_BUF_HIGH_WATER	1
+#endif
+
+static void dfu_ring_reset(void)
+{
+	dfu_ring_dfu = NULL;
+	dfu_ring_head = 0;
+	dfu_ring_pending = 0;
+}
+
+static u8 *dfu_ring_buf(int slot)
+{
+	return dfu_buf + (slot % CONFIG_DFU_BUF_COUNT) * dfu_buf_size;
+}
+
 unsigned char *dfu_free_buf(void)
 {
 	free(dfu_buf);
 	dfu_buf = NULL;
+	dfu_ring_reset();
+	dfu_ring_err = 0;
 	return dfu_buf;
 }
 
@@ -216,10 +250,11 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 	if (dfu->max_buf_size && dfu_buf_size > dfu->max_buf_size)
 		dfu_buf_size = dfu->max_buf_size;
 
-	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
+	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+			   dfu_buf_size * CONFIG_DFU_BUF_COUNT);
 	if (dfu_buf == NULL)
 		printf("%s: Could not memalign 0x%lx bytes\n",
-		       __func__, dfu_buf_size);
+		       __func__, dfu_buf_size * CONFIG_DFU_BUF_COUNT);
 
 	dfu_buf_device_type = dfu->dev_type;
 	return dfu_buf;
@@ -242,31 +277,123 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static int dfu_write_block(struct dfu_entity *dfu, void *buf, long w_size)
+{
+	int ret;
+
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   buf, w_size, 0);
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &w_size);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
+
+	/* update offset */
+	dfu->offset += w_size;
+
+	puts("#");
+
+	return ret;
+}
+
+/* Write out the oldest full buffer in the ring */
+static int dfu_ring_write(void)
+{
+	int slot = dfu_ring_head;
+
+	dfu_ring_head = (dfu_ring_head + 1) % CONFIG_DFU_BUF_COUNT;
+	dfu_ring_pending--;
+
+	return dfu_write_block(dfu_ring_dfu, dfu_ring_buf(slot),
+			       dfu_ring_len[slot]);
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	while (dfu_ring_pending) {
+		ret = dfu_ring_write();
+		if (ret)
+			return ret;
+	}
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
-
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	ret = dfu_write_block(dfu, dfu->i_buf_start, w_size);
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
 
-	/* update offset */
-	dfu->offset += w_size;
+	return ret;
+}
 
-	puts("#");
+/*
+ * Leave the current buffer, which is full, in the ring and move on to the
+ * next one. If none is free, the oldest is written out first.
+ */
+static int dfu_write_buffer_queue(struct dfu_entity *dfu, void *buf)
+{
+	u8 *end = dfu_buf + dfu_buf_size * CONFIG_DFU_BUF_COUNT;
+	int slot, ret;
+
+	/*
+	 * A caller which receives into dfu_get_buf() (as thor does) reuses
+	 * the first buffer straight away, so it cannot wait in the ring
+	 */
+	if (CONFIG_DFU_BUF_COUNT == 1 ||
+	    ((u8 *)buf >= dfu_buf && (u8 *)buf < end))
+		return dfu_write_buffer_drain(dfu);
+
+	if (dfu->i_buf == dfu->i_buf_start)
+		return 0;
+
+	if (dfu_ring_pending == CONFIG_DFU_BUF_COUNT - 1) {
+		ret = dfu_ring_write();
+		if (ret)
+			return ret;
+	}
+
+	slot = (dfu_ring_head + dfu_ring_pending) % CONFIG_DFU_BUF_COUNT;
+	dfu_ring_len[slot] = dfu->i_buf - dfu->i_buf_start;
+	dfu_ring_pending++;
+	dfu_ring_dfu = dfu;
+
+	dfu->i_buf_start = dfu_ring_buf(slot + 1);
+	dfu->i_buf_end = dfu->i_buf_start + dfu_buf_size;
+	dfu->i_buf = dfu->i_buf_start;
+
+	return 0;
+}
+
+int dfu_write_pending(void)
+{
+	struct dfu_entity *dfu = dfu_ring_dfu;
+	int ret;
+
+	if (dfu_ring_pending < DFU_BUF_HIGH_WATER)
+		return 0;
+
+	ret = dfu_ring_write();
+	if (ret) {
+		dfu_transaction_cleanup(dfu);
+		dfu_error_callback(dfu, "DFU write error");
+		dfu_ring_err = ret;
+	}
+
+	return ret;
+}
+
+int dfu_get_write_error(void)
+{
+	int ret = dfu_ring_err;
+
+	dfu_ring_err = 0;
 
 	return ret;
 }
@@ -277,6 +404,7 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->crc = 0;
 	dfu->offset = 0;
 	dfu->i_blk_seq_num = 0;
+	dfu_ring_reset();
 	dfu->i_buf_start = dfu_get_buf(dfu);
 	dfu->i_buf_end = dfu->i_buf_start;
 	dfu->i_buf = dfu->i_buf_start;
@@ -374,7 +502,7 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_queue(dfu, buf);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			dfu_error_callback(dfu, "DFU write error");
@@ -394,9 +522,12 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	memcpy(dfu->i_buf, buf, size);
 	dfu->i_buf += size;
 
-	/* if end or if buffer full flush */
+	/* if end flush, if buffer full move on to the next */
 	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		if (size)
+			ret = dfu_write_buffer_queue(dfu, buf);
+		else
+			ret = dfu_write_buffer_drain(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			dfu_error_callback(dfu, "DFU write error");
@@ -164,6 +164,35 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+	lbaint_t chunk, cur_blkcnt, blks_erased, blks = 0;
+	u32 grp = info->erase_grp;
+
+	/*
+	 * The range is made of whole erase groups; keep each chunk so too, or
+	 * the card rounds it out to whole groups and erases blocks either side
+	 */
+	chunk = FASTBOOT_MAX_BLK_WRITE - FASTBOOT_MAX_BLK_WRITE % grp;
+	if (!chunk)
+		chunk = grp;
+
+	while (blks < blkcnt) {
+		cur_blkcnt = min(blkcnt - blks, chunk);
+		if (fastboot_progress_callback)
+			fastboot_progress_callback("erasing");
+		blks_erased = blk_derase(sparse->dev_desc, blk + blks,
+					 cur_blkcnt);
+		if (blks_erased != cur_blkcnt)
+			break;
+		blks += blks_erased;
+	}
+
+	return blks;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc,
 			    struct disk_partition *info, const char *part_name,
 			    void *buffer, u32 download_bytes, char *response)
@@ -609,8 +638,9 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		return;
 
 	if (is_sparse_image(download_buffer)) {
+		struct mmc *mmc = find_mmc_device(dev_desc->devnum);
 		struct fb_mmc_sparse sparse_priv;
-		struct sparse_storage sparse;
+		struct sparse_storage sparse = {};
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
@@ -622,6 +652,14 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.reserve = fb_mmc_sparse_reserve;
 		sparse.mssg = fastboot_fail;
 
+		/* eMMC says what erased blocks read back as */
+		if (mmc && !IS_SD(mmc) && mmc->ext_csd) {
+			sparse.erase = fb_mmc_sparse_erase;
+			sparse.erase_grp = mmc->erase_grp_size;
+			sparse.erase_zero =
+				!mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+		}
+
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
@@ -479,8 +479,10 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 		return -EMEDIUMTYPE;
 
 	ret = mmc_switch_part(mmc, hwpart);
-	if (!ret)
+	if (!ret) {
 		blkcache_invalidate(desc->uclass_id, desc->devnum);
+		desc->change_seq++;
+	}
 
 	return ret;
 }
@@ -27,6 +27,7 @@ static int sb_eth_raw_start(struct udevice *dev)
 
 	debug("eth_sandbox_raw: Start\n");
 
+	priv->rx_used = 0;
 	ret = sandbox_eth_raw_os_start(priv, pdata->enetaddr);
 	if (priv->local) {
 		env_set("ipaddr", "127.0.0.1");
@@ -63,6 +64,18 @@ static int sb_eth_raw_send(struct udevice *dev, void *packet, int length)
 	return sandbox_eth_raw_os_send(packet, length, priv);
 }
 
+/* Fill in enough of the Ethernet header missing on the local interface */
+static void sb_eth_raw_fill_hdr(struct udevice *dev, uchar *packet)
+{
+	struct eth_pdata *pdata = dev_get_plat(dev);
+	struct ethernet_hdr *eth = (void *)packet;
+
+	memcpy(eth->et_dest, pdata->enetaddr, ARP_HLEN);
+	memset(eth->et_src, 0x01, ARP_HLEN);
+	eth->et_protlen = htons(reply_arp ? PROT_ARP : PROT_IP);
+	reply_arp = 0;
+}
+
 static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_pdata *pdata = dev_get_plat(dev);
@@ -105,13 +118,7 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 
 	if (!retval && length) {
 		if (priv->local) {
-			struct ethernet_hdr *eth = (void *)net_rx_packets[0];
-
-			/* Fill in enough of the missing Ethernet header */
-			memcpy(eth->et_dest, pdata->enetaddr, ARP_HLEN);
-			memset(eth->et_src, 0x01, ARP_HLEN);
-			eth->et_protlen = htons(reply_arp ? PROT_ARP : PROT_IP);
-			reply_arp = 0;
+			sb_eth_raw_fill_hdr(dev, net_rx_packets[0]);
 			length += ETHER_HDR_SIZE;
 		}
 
@@ -123,6 +130,57 @@ static int sb_eth_raw_recv(struct udevice *dev, int flags, uchar **packetp)
 	return retval;
 }
 
+static int sb_eth_raw_recv_batch(struct udevice *dev, int flags,
+				 uchar **packets, int *lengths, int max)
+{
+	struct eth_sandbox_raw_priv *priv = dev_get_priv(dev);
+	void *bufs[PKTBUFSRX];
+	int i, ret;
+
+	/* Each packet needs its own buffer until the batch is freed */
+	if (max > PKTBUFSRX - priv->rx_used)
+		max = PKTBUFSRX - priv->rx_used;
+	if (max <= 0)
+		return 0;
+
+	if (reply_arp) {
+		if (priv->rx_used)
+			return 0;
+		ret = sb_eth_raw_recv(dev, flags, &packets[0]);
+		if (ret <= 0)
+			return ret;
+		lengths[0] = ret;
+		priv->rx_used = 1;
+		return 1;
+	}
+
+	for (i = 0; i < max; i++) {
+		packets[i] = net_rx_packets[priv->rx_used + i];
+		bufs[i] = priv->local ? packets[i] + ETHER_HDR_SIZE : packets[i];
+	}
+	ret = sandbox_eth_raw_os_recv_batch(bufs, lengths, max, priv);
+	for (i = 0; i < ret; i++) {
+		if (priv->local) {
+			sb_eth_raw_fill_hdr(dev, packets[i]);
+			lengths[i] += ETHER_HDR_SIZE;
+		}
+	}
+	if (ret > 0)
+		priv->rx_used += ret;
+
+	return ret;
+}
+
+static int sb_eth_raw_free_pkt(struct udevice *dev, uchar *packet, int length)
+{
+	struct eth_sandbox_raw_priv *priv = dev_get_priv(dev);
+
+	if (priv->rx_used)
+		priv->rx_used--;
+
+	return 0;
+}
+
 static void sb_eth_raw_stop(struct udevice *dev)
 {
 	struct eth_sandbox_raw_priv *priv = dev_get_priv(dev);
@@ -145,6 +203,8 @@ static const struct eth_ops sb_eth_raw_ops = {
 	.start			= sb_eth_raw_start,
 	.send			= sb_eth_raw_send,
 	.recv			= sb_eth_raw_recv,
+	.recv_batch		= sb_eth_raw_recv_batch,
+	.free_pkt		= sb_eth_raw_free_pkt,
 	.stop			= sb_eth_raw_stop,
 	.read_rom_hwaddr	= sb_eth_raw_read_rom_hwaddr,
 };
@@ -326,6 +326,7 @@ static int sb_eth_start(struct udevice *dev)
 	debug("eth_sandbox: Start\n");
 
 	priv->recv_packets = 0;
+	priv->recv_batched = 0;
 	for (int i = 0; i < PKTBUFSRX; i++) {
 		priv->recv_packet_buffer[i] = net_rx_packets[i];
 		priv->recv_packet_length[i] = 0;
@@ -366,6 +367,29 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 	return 0;
 }
 
+static int sb_eth_recv_batch(struct udevice *dev, int flags,
+			     uchar **packets, int *lengths, int max)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i, count;
+
+	if (skip_timeout) {
+		timer_test_add_offset(11000UL);
+		skip_timeout = false;
+	}
+
+	count = min(priv->recv_packets - priv->recv_batched, max);
+	for (i = 0; i < count; i++) {
+		packets[i] = priv->recv_packet_buffer[priv->recv_batched + i];
+		lengths[i] = priv->recv_packet_length[priv->recv_batched + i];
+	}
+	priv->recv_batched += count;
+	debug("eth_sandbox: received %d packets, %d waiting\n", count,
+	      priv->recv_packets - priv->recv_batched);
+
+	return count;
+}
+
 static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -374,6 +398,9 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	if (!priv->recv_packets)
 		return 0;
 
+	if (priv->recv_batched)
+		--priv->recv_batched;
+
 	--priv->recv_packets;
 	for (i = 0; i < priv->recv_packets; i++) {
 		priv->recv_packet_length[i] = priv->recv_packet_length[i + 1];
@@ -406,6 +433,7 @@ static const struct eth_ops sb_eth_ops = {
 	.start			= sb_eth_start,
 	.send			= sb_eth_send,
 	.recv			= sb_eth_recv,
+	.recv_batch		= sb_eth_recv_batch,
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
@@ -15,17 +15,19 @@
 #include <time.h>
 #include <dm/device-internal.h>
 #include <linux/compat.h>
+#include <linux/log2.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
-#define NVME_CQ_ALLOCATION	ALIGN(NVME_CQ_SIZE(NVME_Q_DEPTH), \
-				      ARCH_DMA_MINALIGN)
+#define NVME_CQ_ALLOCATION(depth)	ALIGN(NVME_CQ_SIZE(depth), \
+					      ARCH_DMA_MINALIGN)
+#define NVME_MAX_NLB		0x10000
+#define NVME_MAX_XFER_SHIFT	20
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 {
@@ -44,66 +46,91 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/**
+ * nvme_setup_prps() - fill in the PRP list for a transfer
+ *
+ * @dev:	NVMe device
+ * @prp2:	returns the value for the PRP2 field of the command
+ * @total_len:	length of the transfer in bytes
+ * @dma_addr:	address of the buffer, used for PRP1
+ * @prp_list:	PRP list pages of the command's slot in the PRP pool
+ */
+static void nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
+			    int total_len, u64 dma_addr, u64 *prp_list)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u64 *prp = prp_list;
 	int length = total_len;
 	int i, nprps;
 	u32 prps_per_page = page_size >> 3;
-	u32 num_pages;
 
 	length -= (page_size - offset);
 
 	if (length <= 0) {
 		*prp2 = 0;
-		return 0;
+		return;
 	}
 
-	if (length)
-		dma_addr += (page_size - offset);
+	dma_addr += (page_size - offset);
 
 	if (length <= page_size) {
 		*prp2 = dma_addr;
-		return 0;
+		return;
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
-
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
-	}
-
-	prp_pool = dev->prp_pool;
 	i = 0;
 	while (nprps) {
+		/* The last entry of a full page chains to the next one */
 		if ((i == (prps_per_page - 1)) && nprps > 1) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
+			prp[i] = cpu_to_le64((ulong)(prp + prps_per_page));
 			i = 0;
-			prp_pool += page_size;
+			prp += prps_per_page;
 		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+		prp[i++] = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   num_pages * page_size);
+	flush_dcache_range((ulong)prp_list, (ulong)(prp + prps_per_page));
+}
+
+/**
+ * nvme_alloc_prp_pool() - allocate PRP lists for all I/O command slots
+ *
+ * Each slot gets enough pages for a PRP list describing the largest transfer
+ * the controller accepts, so nothing needs allocating while doing I/O.
+ *
+ * @dev:	NVMe device, with the page size and maximum transfer size known
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+static int nvme_alloc_prp_pool(struct nvme_dev *dev)
+{
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	u32 prps_per_page = dev->page_size >> 3;
+	u32 nprps;
+
+	/*
+	 * Controllers with their own submission method advance the queue
+	 * only when a command completes, so keep a single command in flight
+	 */
+	if (ops && ops->submit_cmd)
+		dev->nr_slots = 1;
+	else
+		dev->nr_slots = dev->queues[NVME_IO_Q]->q_depth - 1;
+
+	nprps = 1U << (dev->max_transfer_shift - ilog2(dev->page_size));
+	dev->prp_pages = max(DIV_ROUND_UP(nprps, prps_per_page - 1), 1U);
+
+	free(dev->slots);
+	free(dev->prp_pool);
+	dev->slots = calloc(dev->nr_slots, sizeof(*dev->slots));
+	dev->prp_pool = memalign(dev->page_size,
+				 dev->nr_slots * dev->prp_pages * dev->page_size);
+	if (!dev->slots || !dev->prp_pool)
+		return -ENOMEM;
 
 	return 0;
 }
@@ -124,7 +151,7 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 	 * as the cache line should never become dirty.
 	 */
 	ulong start = (ulong)&nvmeq->cqes[0];
-	ulong stop = start + NVME_CQ_ALLOCATION;
+	ulong stop = start + NVME_CQ_ALLOCATION(nvmeq->q_depth);
 
 	invalidate_dcache_range(start, stop);
 
@@ -132,12 +159,16 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue
+ *
+ * The doorbell is not written, so that several commands can be handed to the
+ * controller at once with nvme_ring_sq(). Controllers with their own
+ * submission method get the command straight away.
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	struct nvme_ops *ops;
 	u16 tail = nvmeq->sq_tail;
@@ -154,10 +185,62 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
+/**
+ * nvme_ring_sq() - tell the controller about newly queued commands
+ *
+ * @nvmeq:	The queue to use
+ */
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	struct nvme_ops *ops;
+
+	ops = (struct nvme_ops *)nvmeq->dev->udev->driver->ops;
+	if (ops && ops->submit_cmd)
+		return;
+
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
+}
+
+/**
+ * nvme_next_cqe() - move on to the next completion queue entry
+ *
+ * The completion queue doorbell is not written, see nvme_ring_cq().
+ *
+ * @nvmeq:	The queue to use
+ */
+static void nvme_next_cqe(struct nvme_queue *nvmeq)
+{
+	if (++nvmeq->cq_head == nvmeq->q_depth) {
+		nvmeq->cq_head = 0;
+		nvmeq->cq_phase = !nvmeq->cq_phase;
+	}
+}
+
+/**
+ * nvme_ring_cq() - release consumed completion queue entries
+ *
+ * @nvmeq:	The queue to use
+ */
+static void nvme_ring_cq(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->cq_head, nvmeq->q_db + nvmeq->dev->db_stride);
+}
+
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 				struct nvme_command *cmd,
 				u32 *result, unsigned timeout)
@@ -191,14 +274,8 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	if (status) {
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
 		       status, phase, head);
-		status = 0;
-		if (++head == nvmeq->q_depth) {
-			head = 0;
-			phase = !phase;
-		}
-		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-		nvmeq->cq_head = head;
-		nvmeq->cq_phase = phase;
+		nvme_next_cqe(nvmeq);
+		nvme_ring_cq(nvmeq);
 
 		return -EIO;
 	}
@@ -206,13 +283,8 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	if (result)
 		*result = readl(&(nvmeq->cqes[head].result));
 
-	if (++head == nvmeq->q_depth) {
-		head = 0;
-		phase = !phase;
-	}
-	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-	nvmeq->cq_head = head;
-	nvmeq->cq_phase = phase;
+	nvme_next_cqe(nvmeq);
+	nvme_ring_cq(nvmeq);
 
 	return status;
 }
@@ -233,7 +305,7 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 		return NULL;
 	memset(nvmeq, 0, sizeof(*nvmeq));
 
-	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_ALLOCATION);
+	nvmeq->cqes = (void *)memalign(4096, NVME_CQ_ALLOCATION(depth));
 	if (!nvmeq->cqes)
 		goto free_nvmeq;
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(depth));
@@ -344,7 +416,7 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(nvmeq->q_depth));
 	flush_dcache_range((ulong)nvmeq->cqes,
-			   (ulong)nvmeq->cqes + NVME_CQ_ALLOCATION);
+			   (ulong)nvmeq->cqes + NVME_CQ_ALLOCATION(nvmeq->q_depth));
 	dev->online_queues++;
 }
 
@@ -663,6 +735,13 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		dev->max_transfer_shift = 20;
 	}
 
+	/*
+	 * Each I/O command slot has a PRP list for the largest transfer, so
+	 * keep that to a single page by splitting larger transfers
+	 */
+	dev->max_transfer_shift = min_t(u32, dev->max_transfer_shift,
+					NVME_MAX_XFER_SHIFT);
+
 	free(ctrl);
 	return 0;
 }
@@ -741,65 +820,163 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+/**
+ * nvme_reap_io() - wait for I/O commands to complete
+ *
+ * This waits for at least one outstanding command to complete, then consumes
+ * all completions which are available and releases their slots. Completions
+ * which do not match an outstanding command, e.g. late ones for commands
+ * which timed out, are consumed but not counted.
+ *
+ * @dev:	NVMe device
+ * @cmd:	command template, passed to the controller's complete_cmd()
+ * @failed:	lowest starting block of a failed command, updated here
+ * Return: number of commands completed, -ETIMEDOUT on timeout
+ */
+static int nvme_reap_io(struct nvme_dev *dev, struct nvme_command *cmd,
+			u64 *failed)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	ulong timeout_us = dev->io_timeout_ms * 1000UL;
+	ulong start_time = timer_get_us();
+	struct nvme_io_slot *slot;
+	struct nvme_ops *ops;
+	int count = 0;
+	u16 status, id;
+
+	ops = (struct nvme_ops *)dev->udev->driver->ops;
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, nvmeq->cq_head);
+		if ((status & 0x01) != nvmeq->cq_phase) {
+			if (count)
+				break;
+			if (timer_get_us() - start_time >= timeout_us) {
+				count = -ETIMEDOUT;
+				break;
+			}
+			continue;
+		}
+
+		id = readw(&nvmeq->cqes[nvmeq->cq_head].command_id);
+		if (ops && ops->complete_cmd)
+			ops->complete_cmd(nvmeq, cmd);
+		nvme_next_cqe(nvmeq);
+
+		id -= dev->slot_id_base;
+		if (id >= dev->nr_slots || !dev->slots[id].busy) {
+			printf("ERROR: unexpected command id %x\n",
+			       (u16)(id + dev->slot_id_base));
+			continue;
+		}
+		slot = &dev->slots[id];
+		slot->busy = false;
+		count++;
+		status >>= 1;
+		if (status) {
+			printf("ERROR: status = %x, slba = %llx\n", status,
+			       slot->slba);
+			*failed = min(*failed, slot->slba);
+		}
+	}
+	nvme_ring_cq(nvmeq);
+
+	return count;
+}
+
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_plat(udev);
-	int status;
+	struct nvme_io_slot *slot;
 	u64 prp2;
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
 	uintptr_t temp_buffer = (uintptr_t)buffer;
+	u32 prp_stride = dev->prp_pages * (dev->page_size >> 3);
+	int inflight = 0, queued, ret;
+	u16 id;
 
 	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u64 end = blknr + blkcnt;
+	u64 failed = end;
+	u32 lbas = min(1ULL << (dev->max_transfer_shift - ns->lba_shift),
+		       (u64)NVME_MAX_NLB);
+	u32 nlb;
 
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
+	memset(&c, 0, sizeof(c));
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
-		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+	/*
+	 * Keep as many commands in flight as there are slots, topping the
+	 * queue up whenever some of them complete
+	 */
+	while (inflight || (slba < end && failed == end)) {
+		queued = 0;
+		for (id = 0; id < dev->nr_slots; id++) {
+			if (slba == end || failed != end)
+				break;
+			slot = &dev->slots[id];
+			if (slot->busy)
+				continue;
+
+			nlb = min_t(u64, lbas, end - slba);
+			nvme_setup_prps(dev, &prp2, nlb << ns->lba_shift,
+					temp_buffer,
+					dev->prp_pool + id * prp_stride);
+			c.rw.command_id = cpu_to_le16(dev->slot_id_base + id);
+			c.rw.slba = cpu_to_le64(slba);
+			c.rw.length = cpu_to_le16(nlb - 1);
+			c.rw.prp1 = cpu_to_le64(temp_buffer);
+			c.rw.prp2 = cpu_to_le64(prp2);
+			nvme_queue_cmd(nvmeq, &c);
+
+			slot->slba = slba;
+			slot->nlb = nlb;
+			slot->busy = true;
+			inflight++;
+			queued++;
+			slba += nlb;
+			temp_buffer += (ulong)nlb << ns->lba_shift;
+		}
+		if (queued)
+			nvme_ring_sq(nvmeq);
+
+		ret = nvme_reap_io(dev, &c, &failed);
+		if (ret < 0) {
+			printf("ERROR: I/O timeout\n");
+			/* Anything still outstanding counts as failed */
+			for (id = 0; id < dev->nr_slots; id++) {
+				slot = &dev->slots[id];
+				if (slot->busy)
+					failed = min(failed, slot->slba);
+				slot->busy = false;
+			}
+			/* Retire their ids, as they may still complete */
+			dev->slot_id_base += dev->nr_slots;
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		}
+		inflight -= ret;
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	return failed - blknr;
+}
+
+void nvme_set_io_timeout(struct udevice *udev, uint timeout_ms)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+
+	ns->dev->io_timeout_ms = timeout_ms;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -834,6 +1011,7 @@ int nvme_init(struct udevice *udev)
 	int ret;
 
 	ndev->udev = udev;
+	ndev->io_timeout_ms = IO_TIMEOUT * 100;
 	INIT_LIST_HEAD(&ndev->namespaces);
 	if (readl(&ndev->bar->csts) == -1) {
 		ret = -EBUSY;
@@ -860,15 +1038,6 @@ int nvme_init(struct udevice *udev)
 		goto free_queue;
 	}
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret) {
 		log_debug("Unable to setup I/O queues(err=%dE)\n", ret);
@@ -877,6 +1046,13 @@ int nvme_init(struct udevice *udev)
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page size and maximum transfer size are known */
+	ret = nvme_alloc_prp_pool(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	/* Create a blk device for each namespace */
 
 	id = memalign(ndev->page_size, sizeof(struct nvme_id_ns));
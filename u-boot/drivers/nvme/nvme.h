@@ -619,10 +619,32 @@ struct nvme_dev {
 	u32 page_size;
 	u8 vwc;
 	u64 *prp_pool;
-	u32 prp_entry_num;
+	u32 prp_pages;
+	struct nvme_io_slot *slots;
+	u16 nr_slots;
+	u16 slot_id_base;
+	u32 io_timeout_ms;
 	u32 nn;
 };
 
+/**
+ * struct nvme_io_slot - an I/O command which may be in flight
+ *
+ * Each slot owns @prp_pages pages of the device's PRP pool for its PRP list.
+ * Its index, added to the device's @slot_id_base, is used as the command
+ * identifier. The base moves on when commands time out, so that any late
+ * completions for them do not match the slots once they are reused.
+ *
+ * @slba:	first logical block of the command
+ * @nlb:	number of logical blocks
+ * @busy:	true while the command is outstanding
+ */
+struct nvme_io_slot {
+	u64 slba;
+	u32 nlb;
+	bool busy;
+};
+
 /* Admin queue and a single I/O queue. */
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -186,6 +186,12 @@ static int handle_getstatus(struct usb_request *req)
 
 	dfu_set_poll_timeout(dstat, 0);
 
+	/* A buffer written out between requests may have failed */
+	if (dfu_get_write_error()) {
+		f_dfu->dfu_status = DFU_STATUS_errWRITE;
+		f_dfu->dfu_state = DFU_STATE_dfuERROR;
+	}
+
 	switch (f_dfu->dfu_state) {
 	case DFU_STATE_dfuDNLOAD_SYNC:
 	case DFU_STATE_dfuDNBUSY:
@@ -20,6 +20,9 @@
 
 static bool asynch_allowed;
 
+/* Set by usb_init_async() until usb_init() scans the root-hub ports */
+static bool usb_init_pending;
+
 struct usb_uclass_priv {
 	int companion_device_count;
 };
@@ -205,6 +208,10 @@ int usb_stop(void)
 		}
 	}
 
+	if (usb_init_pending) {
+		usb_hub_scan_cancel();
+		usb_init_pending = false;
+	}
 #ifdef CONFIG_USB_STORAGE
 	usb_stor_reset();
 #endif
@@ -221,25 +228,32 @@ int usb_stop(void)
 	return err;
 }
 
+static void usb_show_bus(struct udevice *bus, int ret)
+{
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+
+	if (ret)
+		printf("failed, error %d\n", ret);
+	else if (priv->next_addr == 0)
+		printf("No USB Device found\n");
+	else
+		printf("%d USB Device(s) found\n", priv->next_addr);
+}
+
 static void usb_scan_bus(struct udevice *bus, bool recurse)
 {
-	struct usb_bus_priv *priv;
 	struct udevice *dev;
 	int ret;
 
-	priv = dev_get_uclass_priv(bus);
-
 	assert(recurse);	/* TODO: Support non-recusive */
 
 	printf("scanning bus %s for devices... ", bus->name);
 	debug("\n");
 	ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
-	if (ret)
-		printf("failed, error %d\n", ret);
-	else if (priv->next_addr == 0)
-		printf("No USB Device found\n");
+	if (usb_init_pending && !ret)
+		printf("in the background\n");
 	else
-		printf("%d USB Device(s) found\n", priv->next_addr);
+		usb_show_bus(bus, ret);
 }
 
 static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
@@ -287,10 +301,13 @@ static int usb_probe_companion(struct udevice *bus)
 	return 0;
 }
 
-int usb_init(void)
+/*
+ * Probe the controllers and scan the primary ones. If usb_init_pending is set,
+ * the ports of their root hubs are left to be scanned by usb_init_finish().
+ */
+static int usb_init_start(void)
 {
 	int controllers_initialized = 0;
-	struct usb_uclass_priv *uc_priv;
 	struct usb_bus_priv *priv;
 	struct udevice *bus;
 	struct uclass *uc;
@@ -302,8 +319,6 @@ int usb_init(void)
 	if (ret)
 		return ret;
 
-	uc_priv = uclass_get_priv(uc);
-
 	uclass_foreach_dev(bus, uc) {
 		/* init low_level USB */
 		printf("Bus %s: ", bus->name);
@@ -359,6 +374,43 @@ int usb_init(void)
 			usb_scan_bus(bus, true);
 	}
 
+	/* if we were not able to find at least one working bus, bail out */
+	if (controllers_initialized == 0)
+		printf("No USB controllers found\n");
+
+	return 0;
+}
+
+static int usb_init_finish(void)
+{
+	struct usb_uclass_priv *uc_priv;
+	struct usb_bus_priv *priv;
+	struct udevice *bus;
+	struct uclass *uc;
+	int ret;
+
+	ret = uclass_get(UCLASS_USB, &uc);
+	if (ret)
+		return ret;
+
+	uc_priv = uclass_get_priv(uc);
+
+	if (usb_init_pending) {
+		usb_init_pending = false;
+		usb_started = true;
+		ret = usb_hub_scan_pending();
+		uclass_foreach_dev(bus, uc) {
+			if (!device_active(bus))
+				continue;
+
+			priv = dev_get_uclass_priv(bus);
+			if (!priv->companion) {
+				printf("Bus %s: ", bus->name);
+				usb_show_bus(bus, ret);
+			}
+		}
+	}
+
 	/*
 	 * Now that the primary controllers have been scanned and have handed
 	 * over any devices they do not understand to their companions, scan
@@ -385,13 +437,45 @@ int usb_init(void)
 		return ret;
 	remove_inactive_children(uc, bus);
 
-	/* if we were not able to find at least one working bus, bail out */
-	if (controllers_initialized == 0)
-		printf("No USB controllers found\n");
-
 	return usb_started ? 0 : -ENOENT;
 }
 
+int usb_init(void)
+{
+	int ret;
+
+	if (!usb_init_pending) {
+		ret = usb_init_start();
+		if (ret)
+			return ret;
+	}
+
+	return usb_init_finish();
+}
+
+int usb_init_async(void)
+{
+	int ret;
+
+	if (usb_init_pending)
+		return 0;
+
+	usb_init_pending = true;
+	usb_hub_scan_defer(true);
+	ret = usb_init_start();
+	usb_hub_scan_defer(false);
+	if (ret || !usb_started) {
+		usb_hub_scan_cancel();
+		usb_init_pending = false;
+		return ret ? ret : -ENOENT;
+	}
+
+	/* USB cannot be used until usb_init() has scanned the ports */
+	usb_started = false;
+
+	return 0;
+}
+
 int usb_setup_ehci_gadget(struct ehci_ctrl **ctlrp)
 {
 	struct usb_plat *plat;
@@ -19,6 +19,14 @@ static int usb_bootdev_bind(struct udevice *dev)
 	return 0;
 }
 
+static int usb_bootdev_start(struct bootdev_hunter *info, bool show)
+{
+	if (usb_started)
+		return 0;
+
+	return usb_init_async();
+}
+
 static int usb_bootdev_hunt(struct bootdev_hunter *info, bool show)
 {
 	if (usb_started)
@@ -46,6 +54,7 @@ U_BOOT_DRIVER(usb_bootdev) = {
 BOOTDEV_HUNTER(usb_bootdev_hunter) = {
 	.prio		= BOOTDEVP_5_SCAN_SLOW,
 	.uclass		= UCLASS_USB,
+	.start		= usb_bootdev_start,
 	.hunt		= usb_bootdev_hunt,
 	.drv		= DM_DRIVER_REF(usb_bootdev),
 };
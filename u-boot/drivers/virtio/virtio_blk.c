@@ -8,56 +8,209 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+#define VIRTIO_BLK_MAX_VQS	4
+
+/*
+ * Without VIRTIO_BLK_F_SIZE_MAX a data segment is only limited by the 32-bit
+ * descriptor length
+ */
+#define VIRTIO_BLK_SEG_SIZE	ALIGN_DOWN(U32_MAX, 512)
+
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+	VIRTIO_BLK_F_MQ,
+	VIRTIO_BLK_F_DISCARD,
+	VIRTIO_BLK_F_WRITE_ZEROES,
+};
+
+/**
+ * struct virtio_blk_req - a request in flight on a virtqueue
+ *
+ * @out_hdr:	request header, read by the device
+ * @range:	range of a discard or write-zeroes request, read by the device
+ * @status:	completion status, written by the device
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	struct virtio_blk_discard_write_zeroes range;
+	u8 status;
+};
+
+/**
+ * struct virtio_blk_priv - private data for a virtio block device
+ *
+ * @vqs:		request virtqueues
+ * @reqs:		request slots, one array of @max_reqs entries per queue
+ * @num_vqs:		number of entries in @vqs
+ * @max_reqs:		maximum number of requests in flight per queue
+ * @seg_max:		maximum number of data segments per request
+ * @seg_size:		maximum size of a data segment, in bytes
+ * @max_discard:	maximum sectors per discard request, 0 if unsupported
+ * @max_write_zeroes:	maximum sectors per write-zeroes request, 0 if
+ *			unsupported
+ * @sgs:		scatter-gather list used while adding a request
+ * @sgp:		pointers into @sgs as expected by virtqueue_add()
+ */
 struct virtio_blk_priv {
-	struct virtqueue *vq;
+	struct virtqueue *vqs[VIRTIO_BLK_MAX_VQS];
+	struct virtio_blk_req *reqs[VIRTIO_BLK_MAX_VQS];
+	uint num_vqs;
+	uint max_reqs;
+	uint seg_max;
+	u32 seg_size;
+	u32 max_discard;
+	u32 max_write_zeroes;
+	struct virtio_sg *sgs;
+	struct virtio_sg **sgp;
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+/**
+ * virtio_blk_add_req() - queue one request
+ *
+ * Read and write requests get as many data segments as the device and the
+ * free space in the ring allow. Discard and write-zeroes requests carry a
+ * single range.
+ *
+ * @dev:	virtio block device
+ * @vq:		virtqueue to add the request to
+ * @req:	request slot to use
+ * @sector:	first sector
+ * @blkcnt:	number of sectors left to transfer
+ * @buffer:	data buffer for read and write requests
+ * @type:	request type (VIRTIO_BLK_T_...)
+ * Return: number of sectors queued, 0 if the ring is full
+ */
+static lbaint_t virtio_blk_add_req(struct udevice *dev, struct virtqueue *vq,
+				   struct virtio_blk_req *req, u64 sector,
+				   lbaint_t blkcnt, void *buffer, u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	uint num_out = 0, num_in = 0, nsegs, i;
+	struct virtio_sg *sg = priv->sgs;
+	lbaint_t count, max;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	if (vq->num_free < 3)
+		return 0;
 
-	sgs[num_out++] = &hdr_sg;
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->status = VIRTIO_BLK_S_IOERR;
+	sg->addr = &req->out_hdr;
+	sg->length = sizeof(req->out_hdr);
+	num_out++;
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
+	if (type == VIRTIO_BLK_T_DISCARD || type == VIRTIO_BLK_T_WRITE_ZEROES) {
+		max = type == VIRTIO_BLK_T_DISCARD ? priv->max_discard :
+		      priv->max_write_zeroes;
+		count = min(blkcnt, max);
+		req->out_hdr.sector = 0;
+		req->range.sector = cpu_to_le64(sector);
+		req->range.num_sectors = cpu_to_le32(count);
+		req->range.flags = type == VIRTIO_BLK_T_WRITE_ZEROES ?
+			cpu_to_le32(VIRTIO_BLK_WRITE_ZEROES_FLAG_UNMAP) : 0;
+		sg[num_out].addr = &req->range;
+		sg[num_out].length = sizeof(req->range);
+		num_out++;
+	} else {
+		nsegs = min(priv->seg_max, vq->num_free - 2);
+		max = (lbaint_t)nsegs * (priv->seg_size >> 9);
+		count = min(blkcnt, max);
+		req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+		for (i = 0; i * (priv->seg_size >> 9) < count; i++) {
+			sg[1 + i].addr = buffer + (ulong)i * priv->seg_size;
+			sg[1 + i].length = min_t(u64, priv->seg_size,
+						 (count << 9) -
+						 (u64)i * priv->seg_size);
+		}
+		if (type & VIRTIO_BLK_T_OUT)
+			num_out += i;
+		else
+			num_in += i;
+	}
 
-	sgs[num_out + num_in++] = &status_sg;
-	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
-		  device_active(dev), priv, priv->vq);
+	sg[num_out + num_in].addr = &req->status;
+	sg[num_out + num_in].length = sizeof(req->status);
+	num_in++;
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+	for (i = 0; i < num_out + num_in; i++)
+		priv->sgp[i] = &sg[i];
+	if (virtqueue_add(vq, priv->sgp, num_out, num_in))
+		return 0;
+
+	return count;
+}
+
+/**
+ * virtio_blk_do_req() - run a block operation
+ *
+ * The operation is split into as many requests as fit in the virtqueues,
+ * which are all kicked once and then reaped together. This repeats until the
+ * whole range is done.
+ *
+ * @dev:	virtio block device
+ * @sector:	first sector
+ * @blkcnt:	number of sectors
+ * @buffer:	data buffer for read and write requests
+ * @type:	request type (VIRTIO_BLK_T_...)
+ * Return: @blkcnt on success, -ve on error
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	uint nreqs[VIRTIO_BLK_MAX_VQS];
+	lbaint_t left = blkcnt, count;
+	bool failed = false;
+	uint q, i, done;
+
+	log_debug("dev=%s, sector=%llx, blkcnt=%lx, type=%x\n", dev->name,
+		  sector, (ulong)blkcnt, type);
+
+	while (left && !failed) {
+		for (q = 0; q < priv->num_vqs; q++) {
+			for (nreqs[q] = 0; left && nreqs[q] < priv->max_reqs;
+			     nreqs[q]++) {
+				count = virtio_blk_add_req(dev, priv->vqs[q],
+							   &priv->reqs[q][nreqs[q]],
+							   sector, left, buffer,
+							   type);
+				if (!count)
+					break;
+				sector += count;
+				left -= count;
+				if (buffer)
+					buffer += count << 9;
+			}
+			if (nreqs[q])
+				virtqueue_kick(priv->vqs[q]);
+		}
 
-	virtqueue_kick(priv->vq);
+		/* An empty ring must take at least one request */
+		if (!nreqs[0])
+			failed = true;
 
-	log_debug("wait...");
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
-	log_debug("done\n");
+		/* Reap every queue before failing, so none is left in flight */
+		for (q = 0; q < priv->num_vqs; q++) {
+			for (done = 0; done < nreqs[q];) {
+				if (virtqueue_get_buf(priv->vqs[q], NULL))
+					done++;
+			}
+			for (i = 0; i < nreqs[q]; i++) {
+				if (priv->reqs[q][i].status != VIRTIO_BLK_S_OK)
+					failed = true;
+			}
+		}
+	}
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	return failed ? -EIO : blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -75,6 +228,22 @@ static ulong virtio_blk_write(struct udevice *dev, lbaint_t start,
 				 VIRTIO_BLK_T_OUT);
 }
 
+static ulong virtio_blk_erase(struct udevice *dev, lbaint_t start,
+			      lbaint_t blkcnt)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+
+	/* Prefer write-zeroes, which leaves the range in a known state */
+	if (priv->max_write_zeroes)
+		return virtio_blk_do_req(dev, start, blkcnt, NULL,
+					 VIRTIO_BLK_T_WRITE_ZEROES);
+	if (priv->max_discard)
+		return virtio_blk_do_req(dev, start, blkcnt, NULL,
+					 VIRTIO_BLK_T_DISCARD);
+
+	return -ENOSYS;
+}
+
 static int virtio_blk_bind(struct udevice *dev)
 {
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
@@ -103,8 +272,9 @@ static int virtio_blk_bind(struct udevice *dev)
 		sprintf(desc->vendor, "%04x", uc_priv->vendor);
 	desc->bdev = dev;
 
-	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	/* Indicate what driver features we support, the same for legacy */
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    feature, ARRAY_SIZE(feature));
 
 	return 0;
 }
@@ -113,13 +283,55 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	u16 num_queues;
+	u32 val;
 	u64 cap;
+	uint q;
 	int ret;
 
-	ret = virtio_find_vqs(dev, 1, &priv->vq);
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_MQ, struct virtio_blk_config,
+				 num_queues, &num_queues) || !num_queues)
+		num_queues = 1;
+	priv->num_vqs = min_t(uint, num_queues, VIRTIO_BLK_MAX_VQS);
+
+	ret = virtio_find_vqs(dev, priv->num_vqs, priv->vqs);
 	if (ret)
 		return ret;
 
+	/* Leave room for the header and the status in each request */
+	val = virtqueue_get_vring_size(priv->vqs[0]);
+	priv->max_reqs = val / 3;
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SEG_MAX,
+				 struct virtio_blk_config, seg_max,
+				 &priv->seg_max) || !priv->seg_max)
+		priv->seg_max = 1;
+	priv->seg_max = min(priv->seg_max, val - 2);
+
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SIZE_MAX,
+				 struct virtio_blk_config, size_max, &val))
+		val = VIRTIO_BLK_SEG_SIZE;
+	priv->seg_size = max_t(u32, ALIGN_DOWN(val, 512), 512);
+
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_DISCARD,
+				 struct virtio_blk_config, max_discard_sectors,
+				 &priv->max_discard))
+		priv->max_discard = 0;
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_WRITE_ZEROES,
+				 struct virtio_blk_config,
+				 max_write_zeroes_sectors,
+				 &priv->max_write_zeroes))
+		priv->max_write_zeroes = 0;
+
+	priv->sgs = calloc(priv->seg_max + 2, sizeof(*priv->sgs));
+	priv->sgp = calloc(priv->seg_max + 2, sizeof(*priv->sgp));
+	if (!priv->sgs || !priv->sgp)
+		return -ENOMEM;
+	for (q = 0; q < priv->num_vqs; q++) {
+		priv->reqs[q] = calloc(priv->max_reqs, sizeof(**priv->reqs));
+		if (!priv->reqs[q])
+			return -ENOMEM;
+	}
+
 	desc->blksz = 512;
 	desc->log2blksz = 9;
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
@@ -128,9 +340,23 @@ static int virtio_blk_probe(struct udevice *dev)
 	return 0;
 }
 
+static int virtio_blk_remove(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	uint q;
+
+	for (q = 0; q < priv->num_vqs; q++)
+		free(priv->reqs[q]);
+	free(priv->sgs);
+	free(priv->sgp);
+
+	return virtio_reset(dev);
+}
+
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
+	.erase	= virtio_blk_erase,
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
@@ -139,7 +365,7 @@ U_BOOT_DRIVER(virtio_blk) = {
 	.ops	= &virtio_blk_ops,
 	.bind	= virtio_blk_bind,
 	.probe	= virtio_blk_probe,
-	.remove	= virtio_reset,
+	.remove	= virtio_blk_remove,
 	.priv_auto	= sizeof(struct virtio_blk_priv),
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
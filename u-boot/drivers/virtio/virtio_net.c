@@ -31,6 +31,7 @@ struct virtio_net_priv {
 
 	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
 	bool rx_running;
+	bool rx_refilled;
 	int net_hdr_len;
 };
 
@@ -119,6 +120,31 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	return len - priv->net_hdr_len;
 }
 
+static int virtio_net_recv_batch(struct udevice *dev, int flags,
+				 uchar **packets, int *lengths, int max)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	unsigned int len;
+	void *buf;
+	int count;
+
+	/* Tell the device about all the buffers freed by the last batch */
+	if (priv->rx_refilled) {
+		virtqueue_kick(priv->rx_vq);
+		priv->rx_refilled = false;
+	}
+
+	for (count = 0; count < max; count++) {
+		buf = virtqueue_get_buf(priv->rx_vq, &len);
+		if (!buf)
+			break;
+		packets[count] = buf + priv->net_hdr_len;
+		lengths[count] = len - priv->net_hdr_len;
+	}
+
+	return count;
+}
+
 static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
@@ -128,6 +154,7 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 
 	/* Put the buffer back to the rx ring */
 	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+	priv->rx_refilled = true;
 
 	return 0;
 }
@@ -219,6 +246,7 @@ static const struct eth_ops virtio_net_ops = {
 	.start = virtio_net_start,
 	.send = virtio_net_send,
 	.recv = virtio_net_recv,
+	.recv_batch = virtio_net_recv_batch,
 	.free_pkt = virtio_net_free_pkt,
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
@@ -6,6 +6,7 @@
  */
 
 #include <dm.h>
+#include <malloc.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
@@ -13,6 +14,14 @@
 #include <linux/compat.h>
 #include <linux/err.h>
 #include <linux/io.h>
+#include "virtio_blk.h"
+
+/* Geometry of the emulated block device */
+#define SANDBOX_BLK_SECTORS	512
+#define SANDBOX_BLK_SIZE_MAX	4096
+#define SANDBOX_BLK_SEG_MAX	4
+#define SANDBOX_BLK_QUEUES	2
+#define SANDBOX_BLK_VRING_NUM	16
 
 struct virtio_sandbox_priv {
 	u8 id;
@@ -22,11 +31,29 @@ struct virtio_sandbox_priv {
 	ulong queue_desc;
 	ulong queue_available;
 	ulong queue_used;
+	u8 *disk;
 };
 
 static int virtio_sandbox_get_config(struct udevice *udev, unsigned int offset,
 				     void *buf, unsigned int len)
 {
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+	struct virtio_blk_config config = {
+		.capacity = SANDBOX_BLK_SECTORS,
+		.size_max = SANDBOX_BLK_SIZE_MAX,
+		.seg_max = SANDBOX_BLK_SEG_MAX,
+		.num_queues = SANDBOX_BLK_QUEUES,
+		.max_discard_sectors = SANDBOX_BLK_SECTORS,
+		.max_discard_seg = 1,
+		.discard_sector_alignment = 1,
+		.max_write_zeroes_sectors = SANDBOX_BLK_SECTORS / 4,
+		.max_write_zeroes_seg = 1,
+	};
+
+	if (!priv->disk || offset + len > sizeof(config))
+		return 0;
+	memcpy(buf, (u8 *)&config + offset, len);
+
 	return 0;
 }
 
@@ -95,7 +122,9 @@ static struct virtqueue *virtio_sandbox_setup_vq(struct udevice *udev,
 	int err;
 
 	/* Create the vring */
-	vq = vring_create_virtqueue(index, 4, 4096, udev);
+	vq = vring_create_virtqueue(index,
+				    priv->disk ? SANDBOX_BLK_VRING_NUM : 4,
+				    4096, udev);
 	if (!vq) {
 		err = -ENOMEM;
 		goto error_new_virtqueue;
@@ -148,8 +177,101 @@ static int virtio_sandbox_find_vqs(struct udevice *udev, unsigned int nvqs,
 	return 0;
 }
 
+/**
+ * virtio_sandbox_blk_req() - handle one block request
+ *
+ * @priv:	transport private data
+ * @vq:		virtqueue the request was made on
+ * @head:	first descriptor of the request
+ * Return: number of bytes written to the driver's buffers
+ */
+static u32 virtio_sandbox_blk_req(struct virtio_sandbox_priv *priv,
+				  struct virtqueue *vq, uint head)
+{
+	struct udevice *vdev = vq->vdev;
+	struct vring_desc *desc = vq->vring.desc;
+	struct virtio_blk_discard_write_zeroes *range;
+	struct virtio_blk_outhdr *hdr;
+	u64 pos, end = SANDBOX_BLK_SECTORS << 9;
+	u32 type, len, written = 1;
+	u8 status = VIRTIO_BLK_S_OK;
+	void *addr;
+	uint i;
+
+	hdr = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[head].addr);
+	type = virtio32_to_cpu(vdev, hdr->type);
+	pos = virtio64_to_cpu(vdev, hdr->sector) << 9;
+
+	/* Everything between the header and the status byte is payload */
+	for (i = virtio16_to_cpu(vdev, desc[head].next);
+	     virtio16_to_cpu(vdev, desc[i].flags) & VRING_DESC_F_NEXT;
+	     i = virtio16_to_cpu(vdev, desc[i].next)) {
+		addr = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+		len = virtio32_to_cpu(vdev, desc[i].len);
+
+		switch (type) {
+		case VIRTIO_BLK_T_IN:
+		case VIRTIO_BLK_T_OUT:
+			if (pos + len > end) {
+				status = VIRTIO_BLK_S_IOERR;
+				break;
+			}
+			if (type == VIRTIO_BLK_T_IN) {
+				memcpy(addr, priv->disk + pos, len);
+				written += len;
+			} else {
+				memcpy(priv->disk + pos, addr, len);
+			}
+			pos += len;
+			break;
+		case VIRTIO_BLK_T_DISCARD:
+		case VIRTIO_BLK_T_WRITE_ZEROES:
+			range = addr;
+			pos = le64_to_cpu(range->sector) << 9;
+			len = le32_to_cpu(range->num_sectors) << 9;
+			if (pos + len > end) {
+				status = VIRTIO_BLK_S_IOERR;
+				break;
+			}
+			/* Discarded sectors read back as 0xff */
+			memset(priv->disk + pos,
+			       type == VIRTIO_BLK_T_DISCARD ? 0xff : 0, len);
+			break;
+		default:
+			status = VIRTIO_BLK_S_UNSUPP;
+		}
+	}
+
+	addr = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+	*(u8 *)addr = status;
+
+	return written;
+}
+
 static int virtio_sandbox_notify(struct udevice *udev, struct virtqueue *vq)
 {
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+	struct vring *vring = &vq->vring;
+	struct udevice *vdev = vq->vdev;
+	u16 idx;
+	uint head, slot;
+
+	if (!priv->disk)
+		return 0;
+
+	/* Complete everything which is available, in order */
+	for (idx = virtio16_to_cpu(vdev, vring->used->idx);
+	     idx != virtio16_to_cpu(vdev, vring->avail->idx); idx++) {
+		slot = idx & (vring->num - 1);
+		head = virtio16_to_cpu(vdev, vring->avail->ring[slot]);
+		vring->used->ring[slot].len =
+			cpu_to_virtio32(vdev,
+					virtio_sandbox_blk_req(priv, vq, head));
+		vring->used->ring[slot].id = cpu_to_virtio32(vdev, head);
+		virtio_wmb();
+		vring->used->idx = cpu_to_virtio16(vdev, idx + 1);
+	}
+
 	return 0;
 }
 
@@ -164,6 +286,28 @@ static int virtio_sandbox_probe(struct udevice *udev)
 					       VIRTIO_ID_RNG);
 	uc_priv->vendor = ('u' << 24) | ('b' << 16) | ('o' << 8) | 't';
 
+	/* emulate a small RAM disk behind the block device */
+	if (uc_priv->device == VIRTIO_ID_BLOCK) {
+		priv->disk = calloc(SANDBOX_BLK_SECTORS, 512);
+		if (!priv->disk)
+			return -ENOMEM;
+		priv->device_features |= BIT_ULL(VIRTIO_BLK_F_SIZE_MAX) |
+					 BIT_ULL(VIRTIO_BLK_F_SEG_MAX) |
+					 BIT_ULL(VIRTIO_BLK_F_MQ) |
+					 BIT_ULL(VIRTIO_BLK_F_DISCARD) |
+					 BIT_ULL(VIRTIO_BLK_F_WRITE_ZEROES);
+	}
+
+	return 0;
+}
+
+static int virtio_sandbox_remove(struct udevice *udev)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	free(priv->disk);
+	priv->disk = NULL;
+
 	return 0;
 }
 
@@ -191,6 +335,7 @@ U_BOOT_DRIVER(virtio_sandbox1) = {
 	.of_match = virtio_sandbox1_ids,
 	.ops	= &virtio_sandbox1_ops,
 	.probe	= virtio_sandbox_probe,
+	.remove	= virtio_sandbox_remove,
 	.priv_auto	= sizeof(struct virtio_sandbox_priv),
 };
 
@@ -218,5 +363,6 @@ U_BOOT_DRIVER(virtio_sandbox2) = {
 	.of_match = virtio_sandbox2_ids,
 	.ops	= &virtio_sandbox2_ops,
 	.probe	= virtio_sandbox_probe,
+	.remove	= virtio_sandbox_remove,
 	.priv_auto	= sizeof(struct virtio_sandbox_priv),
 };
@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Path lookup and extent map cache for ext4
+ *
+ * U-Boot probes and closes the filesystem around every fs_*() call, so
+ * everything here is kept across ext4fs_close() and only dropped when a
+ * different filesystem is mounted, when U-Boot writes to this one, or when
+ * anything else writes to the block device (e.g. 'mmc write' or fastboot).
+ */
+
+#include <blk.h>
+#include <ext4fs.h>
+#include <ext_common.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <linux/list.h>
+#include "ext4_common.h"
+
+#define EXT4_DCACHE_HASH	64
+#define EXT4_DCACHE_MAX		256
+#define EXT4_EMAP_MAX		8
+#define EXT4_EXT_INIT_MAX_LEN	32768
+#define EXT4_EXT_MAX_DEPTH	5
+
+/**
+ * struct ext4_dentry - cached result of a path lookup
+ *
+ * @hash:	link in the hash bucket
+ * @lru:	link in the LRU list, most recently used first
+ * @ino:	inode number, 0 if the path does not exist
+ * @type:	file type of the inode (FILETYPE_...)
+ * @path:	path, relative to the root directory
+ */
+struct ext4_dentry {
+	struct hlist_node hash;
+	struct list_head lru;
+	int ino;
+	int type;
+	char path[];
+};
+
+static struct {
+	struct blk_desc *dev;
+	u32 change_seq;
+	lbaint_t part_offset;
+	struct ext2_sblock sblock;
+	struct hlist_head dhash[EXT4_DCACHE_HASH];
+	struct list_head dlru;
+	int dcount;
+	struct ext4_extent_map *emap[EXT4_EMAP_MAX];
+	u32 emap_tick;
+	bool valid;
+} ext4_cache = {
+	.dlru = LIST_HEAD_INIT(ext4_cache.dlru),
+};
+
+static uint ext4fs_dcache_hash(const char *path)
+{
+	uint hash = 5381;
+
+	while (*path)
+		hash = hash * 33 + *path++;
+
+	return hash % EXT4_DCACHE_HASH;
+}
+
+static void ext4fs_dentry_free(struct ext4_dentry *d)
+{
+	hlist_del(&d->hash);
+	list_del(&d->lru);
+	free(d);
+	ext4_cache.dcount--;
+}
+
+static void ext4fs_emap_free(struct ext4_extent_map *map)
+{
+	if (map)
+		free(map->ext);
+	free(map);
+}
+
+void ext4fs_cache_invalidate(void)
+{
+	struct ext4_dentry *d, *tmp;
+	int i;
+
+	list_for_each_entry_safe(d, tmp, &ext4_cache.dlru, lru)
+		ext4fs_dentry_free(d);
+
+	for (i = 0; i < EXT4_EMAP_MAX; i++) {
+		ext4fs_emap_free(ext4_cache.emap[i]);
+		ext4_cache.emap[i] = NULL;
+	}
+	ext4_cache.valid = false;
+}
+
+void ext4fs_cache_mount(struct ext2_data *data)
+{
+	struct blk_desc *dev = get_fs()->dev_desc;
+
+	if (ext4_cache.valid && ext4_cache.dev == dev &&
+	    ext4_cache.change_seq == dev->change_seq &&
+	    ext4_cache.part_offset == part_offset &&
+	    !memcmp(&ext4_cache.sblock, &data->sblock, sizeof(data->sblock)))
+		return;
+
+	ext4fs_cache_invalidate();
+	ext4_cache.dev = dev;
+	ext4_cache.change_seq = dev->change_seq;
+	ext4_cache.part_offset = part_offset;
+	memcpy(&ext4_cache.sblock, &data->sblock, sizeof(data->sblock));
+	ext4_cache.valid = true;
+}
+
+int ext4fs_dcache_lookup(const char *path, int *ino, int *type)
+{
+	struct ext4_dentry *d;
+	uint hash;
+
+	if (!ext4_cache.valid)
+		return -ENOENT;
+
+	hash = ext4fs_dcache_hash(path);
+	hlist_for_each_entry(d, &ext4_cache.dhash[hash], hash) {
+		if (!strcmp(d->path, path)) {
+			list_move(&d->lru, &ext4_cache.dlru);
+			*ino = d->ino;
+			*type = d->type;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+void ext4fs_dcache_add(const char *path, int ino, int type)
+{
+	struct ext4_dentry *d;
+	int dummy_ino, dummy_type;
+
+	if (!ext4_cache.valid ||
+	    !ext4fs_dcache_lookup(path, &dummy_ino, &dummy_type))
+		return;
+
+	if (ext4_cache.dcount >= EXT4_DCACHE_MAX)
+		ext4fs_dentry_free(list_last_entry(&ext4_cache.dlru,
+						   struct ext4_dentry, lru));
+
+	d = malloc(sizeof(*d) + strlen(path) + 1);
+	if (!d)
+		return;
+	strcpy(d->path, path);
+	d->ino = ino;
+	d->type = type;
+	hlist_add_head(&d->hash, &ext4_cache.dhash[ext4fs_dcache_hash(path)]);
+	list_add(&d->lru, &ext4_cache.dlru);
+	ext4_cache.dcount++;
+}
+
+static int ext4fs_emap_append(struct ext4_extent_map *map, u32 lblk, u32 len,
+			      u64 pblk)
+{
+	struct ext4_map_extent *e, *tmp;
+
+	if (map->count) {
+		e = &map->ext[map->count - 1];
+		/* Merge runs which are contiguous on the disk too */
+		if (e->lblk + e->len == lblk && e->pblk && pblk &&
+		    e->pblk + e->len == pblk) {
+			e->len += len;
+			return 0;
+		}
+		if (e->lblk + e->len > lblk)
+			return -EINVAL;
+	}
+
+	if (map->count == map->max) {
+		map->max = map->max ? map->max * 2 : 16;
+		tmp = realloc(map->ext, map->max * sizeof(*map->ext));
+		if (!tmp)
+			return -ENOMEM;
+		map->ext = tmp;
+	}
+
+	e = &map->ext[map->count++];
+	e->lblk = lblk;
+	e->len = len;
+	e->pblk = pblk;
+
+	return 0;
+}
+
+static int ext4fs_emap_walk(struct ext4_extent_map *map,
+			    struct ext4_extent_header *eh, int depth)
+{
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+	struct ext4_extent_idx *idx;
+	int i, entries, ret;
+	char *buf;
+
+	if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC ||
+	    depth > EXT4_EXT_MAX_DEPTH)
+		return -EINVAL;
+
+	entries = le16_to_cpu(eh->eh_entries);
+	if (!eh->eh_depth) {
+		struct ext4_extent *ext = (struct ext4_extent *)(eh + 1);
+
+		for (i = 0; i < entries; i++) {
+			u32 len = le16_to_cpu(ext[i].ee_len);
+			u64 start = 0;
+
+			/* Unwritten extents read as zeroes, like holes */
+			if (len > EXT4_EXT_INIT_MAX_LEN)
+				len -= EXT4_EXT_INIT_MAX_LEN;
+			else
+				start = ((u64)le16_to_cpu(ext[i].ee_start_hi) << 32) +
+					le32_to_cpu(ext[i].ee_start_lo);
+
+			ret = ext4fs_emap_append(map,
+						 le32_to_cpu(ext[i].ee_block),
+						 len, start);
+			if (ret)
+				return ret;
+		}
+
+		return 0;
+	}
+
+	idx = (struct ext4_extent_idx *)(eh + 1);
+	buf = memalign(ARCH_DMA_MINALIGN, blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0, ret = 0; i < entries && !ret; i++) {
+		u64 block;
+
+		block = ((u64)le16_to_cpu(idx[i].ei_leaf_hi) << 32) +
+			le32_to_cpu(idx[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz, buf))
+			ret = -EIO;
+		else
+			ret = ext4fs_emap_walk(map, (struct ext4_extent_header *)buf,
+					       depth + 1);
+	}
+	free(buf);
+
+	return ret;
+}
+
+const struct ext4_extent_map *ext4fs_emap_get(struct ext2fs_node *node)
+{
+	struct ext4_extent_map *map, **slot = &ext4_cache.emap[0];
+	int i;
+
+	if (!ext4_cache.valid || !node->ino)
+		return NULL;
+
+	for (i = 0; i < EXT4_EMAP_MAX; i++) {
+		map = ext4_cache.emap[i];
+		if (map && map->ino == node->ino) {
+			map->lru = ++ext4_cache.emap_tick;
+			return map;
+		}
+		if (!map)
+			slot = &ext4_cache.emap[i];
+		else if (*slot && map->lru < (*slot)->lru)
+			slot = &ext4_cache.emap[i];
+	}
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		return NULL;
+	map->ino = node->ino;
+
+	if (ext4fs_emap_walk(map, (struct ext4_extent_header *)
+			     node->inode.b.blocks.dir_blocks, 0)) {
+		log_debug("cannot map extents of inode %d\n", node->ino);
+		ext4fs_emap_free(map);
+		return NULL;
+	}
+
+	ext4fs_emap_free(*slot);
+	*slot = map;
+	map->lru = ++ext4_cache.emap_tick;
+
+	return map;
+}
@@ -2172,7 +2172,9 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		}
 		fpos += le16_to_cpu(dirent.direntlen);
 	}
-	return 0;
+
+	/* Tell a name which is not there apart from an error reading it */
+	return name ? -ENOENT : 0;
 }
 
 static char *ext4fs_read_symlink(struct ext2fs_node *node)
@@ -2249,8 +2251,8 @@ int ext4fs_find_file1(const char *currpath, struct ext2fs_node *currroot,
 
 		/* Iterate over the directory. */
 		found = ext4fs_iterate_dir(currnode, name, &currnode, &type);
-		if (found == 0)
-			return 0;
+		if (found == 0 || found == -ENOENT)
+			return found;
 
 		if (found == -1)
 			break;
@@ -2287,7 +2289,7 @@ int ext4fs_find_file1(const char *currpath, struct ext2fs_node *currroot,
 
 			free(symlink);
 
-			if (status == 0) {
+			if (status == 0 || status == -ENOENT) {
 				ext4fs_free_node(oldnode, currroot);
 				return 0;
 			}
@@ -2306,6 +2308,75 @@ int ext4fs_find_file1(const char *currpath, struct ext2fs_node *currroot,
 	return -1;
 }
 
+/*
+ * Look up a path from the root directory one component at a time, using and
+ * filling the lookup cache for each leading part of the path.
+ */
+static int ext4fs_find_file_cached(const char *path,
+				   struct ext2fs_node **foundnode,
+				   int *foundtype)
+{
+	struct ext2fs_node *root = &ext4fs_root->diropen;
+	struct ext2fs_node *currnode = root, *node;
+	char fpath[strlen(path) + 1];
+	int len = 0, ino, type = FILETYPE_DIRECTORY;
+	const char *end;
+
+	for (;;) {
+		/* Remove all leading slashes. */
+		while (*path == '/')
+			path++;
+		if (!*path)
+			break;
+
+		if (type != FILETYPE_DIRECTORY)
+			goto fail;
+
+		end = strchrnul(path, '/');
+		if (len)
+			fpath[len++] = '/';
+		memcpy(fpath + len, path, end - path);
+		len += end - path;
+		fpath[len] = '\0';
+
+		if (!ext4fs_dcache_lookup(fpath, &ino, &type)) {
+			if (!ino)
+				goto fail;
+			node = zalloc(sizeof(struct ext2fs_node));
+			if (!node)
+				goto fail;
+			node->data = ext4fs_root;
+			node->ino = ino;
+		} else {
+			char name[end - path + 1];
+			int status;
+
+			memcpy(name, path, end - path);
+			name[end - path] = '\0';
+			status = ext4fs_find_file1(name, currnode, &node, &type);
+			if (status != 1) {
+				/* Only remember names which are not there */
+				if (status == -ENOENT)
+					ext4fs_dcache_add(fpath, 0, 0);
+				goto fail;
+			}
+			ext4fs_dcache_add(fpath, node->ino, type);
+		}
+
+		ext4fs_free_node(currnode, root);
+		currnode = node;
+		path = end;
+	}
+
+	*foundnode = currnode;
+	*foundtype = type;
+	return 1;
+
+fail:
+	ext4fs_free_node(currnode, root);
+	return 0;
+}
+
 int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 	struct ext2fs_node **foundnode, int expecttype)
 {
@@ -2316,8 +2387,12 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 	if (!path)
 		return 0;
 
-	status = ext4fs_find_file1(path, rootnode, foundnode, &foundtype);
-	if (status == 0)
+	if (CONFIG_IS_ENABLED(EXT4_CACHE) && rootnode == &ext4fs_root->diropen)
+		status = ext4fs_find_file_cached(path, foundnode, &foundtype);
+	else
+		status = ext4fs_find_file1(path, rootnode, foundnode,
+					   &foundtype);
+	if (status == 0 || status == -ENOENT)
 		return 0;
 
 	/* Check if the node that was found was of the expected type. */
@@ -2408,6 +2483,7 @@ int ext4fs_mount(void)
 		goto fail;
 
 	ext4fs_root = data;
+	ext4fs_cache_mount(data);
 
 	return 1;
 fail:
@@ -59,6 +59,62 @@ int ext4fs_find_file1(const char *currpath, struct ext2fs_node *currroot,
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
 
+/**
+ * struct ext4_map_extent - run of file blocks which are contiguous on disk
+ *
+ * @lblk:	first logical block of the run in the file
+ * @len:	number of blocks in the run
+ * @pblk:	first physical block, 0 if the run reads as zeroes
+ */
+struct ext4_map_extent {
+	u32 lblk;
+	u32 len;
+	u64 pblk;
+};
+
+/**
+ * struct ext4_extent_map - all extents of an inode, sorted by logical block
+ *
+ * @ino:	inode number
+ * @count:	number of extents in @ext
+ * @max:	number of extents allocated in @ext
+ * @ext:	extents
+ * @lru:	value of the cache tick when last used
+ */
+struct ext4_extent_map {
+	int ino;
+	unsigned int count;
+	unsigned int max;
+	struct ext4_map_extent *ext;
+	u32 lru;
+};
+
+#if CONFIG_IS_ENABLED(EXT4_CACHE)
+/* Keep the cache if this is the filesystem it was filled from, else drop it */
+void ext4fs_cache_mount(struct ext2_data *data);
+/* Drop all cached lookups and extent maps, e.g. when writing */
+void ext4fs_cache_invalidate(void);
+/* Return 0 and the inode number (0 if the path does not exist) if cached */
+int ext4fs_dcache_lookup(const char *path, int *ino, int *type);
+void ext4fs_dcache_add(const char *path, int ino, int type);
+/* Return the extent map of an extent-based inode, NULL on error */
+const struct ext4_extent_map *ext4fs_emap_get(struct ext2fs_node *node);
+#else
+static inline void ext4fs_cache_mount(struct ext2_data *data) {}
+static inline void ext4fs_cache_invalidate(void) {}
+static inline int ext4fs_dcache_lookup(const char *path, int *ino, int *type)
+{
+	return -ENOENT;
+}
+
+static inline void ext4fs_dcache_add(const char *path, int ino, int type) {}
+static inline const struct ext4_extent_map *
+ext4fs_emap_get(struct ext2fs_node *node)
+{
+	return NULL;
+}
+#endif
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
 uint16_t ext4fs_checksum_update(unsigned int i);
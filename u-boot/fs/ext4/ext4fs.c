@@ -43,6 +43,65 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/*
+ * Read a file using its extent map: each run of blocks which are contiguous
+ * on the disk is read with a single request, holes are zeroed.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node,
+			       const struct ext4_extent_map *map, loff_t pos,
+			       loff_t len, char *buf)
+{
+	struct ext_filesystem *fs = get_fs();
+	int log2blksz = fs->dev_desc->log2blksz;
+	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data);
+	loff_t end = pos + len, next;
+	unsigned int lo = 0, hi = map->count, i;
+	lbaint_t sector;
+	u64 fileblock;
+
+	/* Find the first extent which does not end before pos */
+	fileblock = pos >> log2_fs_blocksize;
+	while (lo < hi) {
+		i = (lo + hi) / 2;
+		if ((u64)map->ext[i].lblk + map->ext[i].len <= fileblock)
+			lo = i + 1;
+		else
+			hi = i;
+	}
+
+	for (i = lo; pos < end; ) {
+		const struct ext4_map_extent *e = &map->ext[i];
+
+		fileblock = pos >> log2_fs_blocksize;
+		if (i >= map->count || fileblock < e->lblk) {
+			/* Sparse file */
+			next = i < map->count ?
+				(loff_t)e->lblk << log2_fs_blocksize : end;
+			next = min(next, end);
+			memset(buf, 0, next - pos);
+		} else {
+			next = min(end, (loff_t)(e->lblk + e->len) <<
+				   log2_fs_blocksize);
+			/* Unwritten extent */
+			if (!e->pblk) {
+				memset(buf, 0, next - pos);
+			} else {
+				sector = (e->pblk + fileblock - e->lblk) <<
+					(log2_fs_blocksize - log2blksz);
+				if (!ext4fs_devread(sector,
+						    pos & ((1 << log2_fs_blocksize) - 1),
+						    next - pos, buf))
+					return -1;
+			}
+			i++;
+		}
+		buf += next - pos;
+		pos = next;
+	}
+
+	return 0;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -79,6 +138,17 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		return -1;
 	}
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		const struct ext4_extent_map *map = ext4fs_emap_get(node);
+
+		if (map) {
+			if (ext4fs_read_extents(node, map, pos, len, buf))
+				return -1;
+			*actread = len;
+			return 0;
+		}
+	}
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
@@ -208,13 +278,17 @@ int ext4fs_ls(const char *dirname)
 int ext4fs_exists(const char *filename)
 {
 	struct ext2fs_node *dirnode = NULL;
-	int filetype;
+	int status;
 
 	if (!filename)
 		return 0;
 
-	return ext4fs_find_file1(filename, &ext4fs_root->diropen, &dirnode,
-				 &filetype);
+	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &dirnode,
+				  FILETYPE_UNKNOWN);
+	if (status == 1)
+		ext4fs_free_node(dirnode, &ext4fs_root->diropen);
+
+	return status;
 }
 
 int ext4fs_size(const char *filename, loff_t *size)
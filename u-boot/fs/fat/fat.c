@@ -150,23 +150,139 @@ static void get_name(dir_entry *dirent, char *s_name)
 		*s_name = DELETED_FLAG;
 }
 
-static int flush_dirty_fat_buffer(fsdata *mydata);
+static int flush_fat_window(fsdata *mydata, struct fat_cache_window *win);
 
 #if !CONFIG_IS_ENABLED(FAT_WRITE)
 /* Stub for read only operation */
-int flush_dirty_fat_buffer(fsdata *mydata)
+int flush_fat_window(fsdata *mydata, struct fat_cache_window *win)
 {
 	(void)(mydata);
+	(void)(win);
 	return 0;
 }
 #endif
 
+/*
+ * Write all modified FAT cache windows back to the disk.
+ */
+static int flush_dirty_fat_buffer(fsdata *mydata)
+{
+	int i;
+
+	for (i = 0; i < FATCACHEWINDOWS; i++) {
+		if (flush_fat_window(mydata, &mydata->fatcache[i]) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Set up an empty FAT cache. Only the first window is allocated here, the
+ * others are allocated when needed.
+ */
+static int fat_cache_init(fsdata *mydata)
+{
+	int i;
+
+	for (i = 0; i < FATCACHEWINDOWS; i++) {
+		mydata->fatcache[i].buf = NULL;
+		mydata->fatcache[i].bufnum = -1;
+		mydata->fatcache[i].dirty = 0;
+		mydata->fatcache[i].lru = 0;
+	}
+	mydata->fat_tick = 0;
+
+	mydata->fatcache[0].buf = malloc_cache_aligned(FATBUFSIZE);
+	if (!mydata->fatcache[0].buf)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Free the FAT cache buffers. Modified windows are not written back.
+ */
+static void fat_cache_free(fsdata *mydata)
+{
+	int i;
+
+	for (i = 0; i < FATCACHEWINDOWS; i++) {
+		free(mydata->fatcache[i].buf);
+		mydata->fatcache[i].buf = NULL;
+	}
+}
+
+/*
+ * Get the FAT cache window holding window 'bufnum' of the FAT, reading it
+ * from the disk if needed. A free window is used if there is one, otherwise
+ * the least recently used window is written back and replaced.
+ * Return NULL on failure.
+ */
+static struct fat_cache_window *fat_cache_get(fsdata *mydata, __u32 bufnum)
+{
+	struct fat_cache_window *win, *victim = NULL, *unused = NULL;
+	struct fat_cache_window *lru = NULL;
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	int i;
+
+	for (i = 0; i < FATCACHEWINDOWS; i++) {
+		win = &mydata->fatcache[i];
+		if (!win->buf) {
+			if (!unused)
+				unused = win;
+		} else if (win->bufnum == (int)bufnum) {
+			win->lru = ++mydata->fat_tick;
+			return win;
+		} else if (win->bufnum == -1) {
+			if (!victim)
+				victim = win;
+		} else if (!lru || win->lru < lru->lru) {
+			lru = win;
+		}
+	}
+
+	if (!victim && unused) {
+		unused->buf = malloc_cache_aligned(FATBUFSIZE);
+		if (unused->buf)
+			victim = unused;
+	}
+	if (!victim)
+		victim = lru;
+	if (!victim)
+		return NULL;
+
+	/* Write back the window to the disk */
+	if (flush_fat_window(mydata, victim) < 0)
+		return NULL;
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
+
+	startblock += mydata->fat_sect;	/* Offset from start of disk */
+
+	debug("FAT cache: reading window %u\n", bufnum);
+	victim->bufnum = -1;
+	if (disk_read(startblock, getsize, victim->buf) < 0) {
+		debug("Error reading FAT blocks\n");
+		return NULL;
+	}
+	victim->bufnum = bufnum;
+	victim->dirty = 0;
+	victim->lru = ++mydata->fat_tick;
+
+	return victim;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
  */
 static __u32 get_fatent(fsdata *mydata, __u32 entry)
 {
+	struct fat_cache_window *win;
 	__u32 bufnum;
 	__u32 offset, off8;
 	__u32 ret = 0x00;
@@ -198,42 +314,23 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	debug("FAT%d: entry: 0x%08x = %d, offset: 0x%04x = %d\n",
 	       mydata->fatsize, entry, entry, offset, offset);
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	/* Find the block of FAT entries in the cache, reading it if needed */
+	win = fat_cache_get(mydata, bufnum);
+	if (!win)
+		return ret;
 
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)win->buf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)win->buf)[offset]);
 		break;
 	case 12:
 		off8 = (offset * 3) / 2;
 		/* fatbut + off8 may be unaligned, read in byte granularity */
-		ret = mydata->fatbuf[off8] + (mydata->fatbuf[off8 + 1] << 8);
+		ret = win->buf[off8] + (win->buf[off8 + 1] << 8);
 
 		if (offset & 0x1)
 			ret >>= 4;
@@ -245,6 +342,72 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	return ret;
 }
 
+/**
+ * struct fat_extent - run of physically contiguous clusters in a file
+ *
+ * @start:	first cluster of the run
+ * @count:	number of clusters in the run
+ */
+struct fat_extent {
+	__u32 start;
+	__u32 count;
+};
+
+/*
+ * Number of extents mapped at a time, so that reading a fragmented file needs
+ * no more memory than reading a contiguous one
+ */
+#define FAT_MAP_EXTENTS		16
+
+/**
+ * fat_map_chain() - resolve part of a cluster chain into a list of extents
+ *
+ * Follow the chain for up to *@nclustp clusters, merging consecutive clusters
+ * into extents, so that the data can then be read with one device request per
+ * extent. This stops early when @max extents are full.
+ *
+ * @mydata:	file system description
+ * @clustp:	first cluster to map; returns the first cluster not mapped
+ * @nclustp:	number of clusters to map; returns the number left
+ * @ext:	returns the extents
+ * @max:	number of entries in @ext
+ * Return:	number of extents, or -1 on error
+ */
+static int fat_map_chain(fsdata *mydata, __u32 *clustp, __u32 *nclustp,
+			 struct fat_extent *ext, int max)
+{
+	__u32 clust = *clustp, nclust = *nclustp;
+	int count = 0;
+
+	while (nclust) {
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			printf("Invalid FAT entry\n");
+			return -1;
+		}
+
+		if (count && ext[count - 1].start + ext[count - 1].count == clust) {
+			ext[count - 1].count++;
+		} else {
+			if (count == max)
+				break;
+			ext[count].start = clust;
+			ext[count].count = 1;
+			count++;
+		}
+
+		if (!--nclust)
+			break;
+		clust = get_fatent(mydata, clust);
+	}
+	debug("FAT: mapped %u clusters into %d extents\n", *nclustp - nclust,
+	      count);
+
+	*clustp = clust;
+	*nclustp = nclust;
+	return count;
+}
+
 /*
  * Read at most 'size' bytes from the specified cluster into 'buffer'.
  * Return 0 on success, -1 otherwise.
@@ -264,21 +427,42 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
 
 	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
+		__u32 sect_count = DIV_ROUND_UP(size, mydata->sect_size);
+		__u32 chunk = max(FAT_BOUNCE_SIZE / mydata->sect_size, 1);
+		unsigned long len;
+		__u8 *tmpbuf;
 
 		debug("FAT: Misaligned buffer address (%p)\n", buffer);
 
-		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
+		/* Read through a bounce buffer, as large as we can get */
+		chunk = min(chunk, sect_count);
+		tmpbuf = malloc_cache_aligned(chunk * mydata->sect_size);
+		while (!tmpbuf && chunk > 1) {
+			chunk /= 2;
+			tmpbuf = malloc_cache_aligned(chunk * mydata->sect_size);
+		}
+		if (!tmpbuf) {
+			debug("Error: allocating bounce buffer\n");
+			return -1;
+		}
+
+		while (size) {
+			chunk = min(chunk, sect_count);
+			ret = disk_read(startsect, chunk, tmpbuf);
+			if (ret != chunk) {
 				debug("Error reading data (got %d)\n", ret);
+				free(tmpbuf);
 				return -1;
 			}
 
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
+			len = min(size, (unsigned long)chunk * mydata->sect_size);
+			memcpy(buffer, tmpbuf, len);
+			startsect += chunk;
+			sect_count -= chunk;
+			buffer += len;
+			size -= len;
 		}
+		free(tmpbuf);
 	} else if (size >= mydata->sect_size) {
 		__u32 bytes_read;
 		__u32 sect_count = size / mydata->sect_size;
@@ -328,9 +512,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
-	loff_t actsize;
+	struct fat_extent ext[FAT_MAP_EXTENTS];
+	loff_t extpos, extend, actsize;
+	__u32 curclust, skip, clust, nclust;
+	int i, count;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -345,101 +530,69 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
+	/* Resolve the cluster chain up to the end of the read, a part at a time */
+	clust = START(dentptr);
+	nclust = (__u32)(filesize - 1) / bytesperclust + 1;
+	extpos = 0;
+	while (pos < filesize) {
+		count = fat_map_chain(mydata, &clust, &nclust, ext,
+				      ARRAY_SIZE(ext));
+		if (count <= 0)
 			return -1;
-		}
-		actsize += bytesperclust;
-	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
-
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		__u8 *tmp_buffer;
-
-		actsize = min(filesize, (loff_t)bytesperclust);
-		tmp_buffer = malloc_cache_aligned(actsize);
-		if (!tmp_buffer) {
-			debug("Error: allocating buffer\n");
-			return -1;
-		}
-
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
-			printf("Error reading cluster\n");
-			free(tmp_buffer);
-			return -1;
-		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
-		free(tmp_buffer);
-		*gotsize += actsize;
-		if (!filesize)
-			return 0;
-		buffer += actsize;
+		for (i = 0; i < count && pos < filesize; i++, extpos = extend) {
+			extend = extpos + (loff_t)ext[i].count * bytesperclust;
+			if (extend <= pos)
+				continue;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-	}
+			/* go to cluster at pos */
+			skip = (__u32)(pos - extpos) / bytesperclust;
+			curclust = ext[i].start + skip;
+			extpos += (loff_t)skip * bytesperclust;
+
+			/* align to beginning of next cluster if any */
+			if (pos > extpos) {
+				__u8 *tmp_buffer;
+
+				actsize = min(filesize - extpos,
+					      (loff_t)bytesperclust);
+				tmp_buffer = malloc_cache_aligned(actsize);
+				if (!tmp_buffer) {
+					debug("Error: allocating buffer\n");
+					return -1;
+				}
+
+				if (get_cluster(mydata, curclust, tmp_buffer,
+						actsize) != 0) {
+					printf("Error reading cluster\n");
+					free(tmp_buffer);
+					return -1;
+				}
+				memcpy(buffer, tmp_buffer + (pos - extpos),
+				       actsize - (pos - extpos));
+				free(tmp_buffer);
+				buffer += actsize - (pos - extpos);
+				*gotsize += actsize - (pos - extpos);
+				pos = extpos + actsize;
+				extpos += bytesperclust;
+				curclust++;
+				if (pos >= filesize || extpos == extend)
+					continue;
+			}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
+			/* get the rest of the extent with a single read */
+			actsize = min(filesize, extend) - pos;
+			if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
+				printf("Error reading cluster\n");
 				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
+			*gotsize += actsize;
+			buffer += actsize;
+			pos += actsize;
 		}
+	}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
-
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -683,10 +836,7 @@ static int get_fs_info(fsdata *mydata)
 		mydata->root_cluster = 0;
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fat_dirty = 0;
-	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
-	if (mydata->fatbuf == NULL) {
+	if (fat_cache_init(mydata)) {
 		debug("Error: allocating memory\n");
 		return -1;
 	}
@@ -1237,7 +1387,7 @@ int fat_exists(const char *filename)
 		goto out;
 
 	ret = fat_itr_resolve(itr, filename, TYPE_ANY);
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 out:
 	free(itr);
 	return ret == 0;
@@ -1284,7 +1434,7 @@ int fat_size(const char *filename, loff_t *size)
 		 * Directories don't have size, but fs_size() is not
 		 * expected to fail if passed a directory path:
 		 */
-		free(fsdata.fatbuf);
+		fat_cache_free(&fsdata);
 		ret = fat_itr_root(itr, &fsdata);
 		if (ret)
 			goto out_free_itr;
@@ -1296,7 +1446,7 @@ int fat_size(const char *filename, loff_t *size)
 
 	*size = FAT2CPU32(itr->dent->size);
 out_free_both:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1328,7 +1478,7 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	ret = get_contents(&fsdata, dentptr, offset, buf, len, actread);
 
 out_free_both:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1375,7 +1525,7 @@ int fat_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	return 0;
 
 fail_free_both:
-	free(dir->fsdata.fatbuf);
+	fat_cache_free(&dir->fsdata);
 fail_free_dir:
 	free(dir);
 	return ret;
@@ -1415,7 +1565,7 @@ int fat_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp)
 void fat_closedir(struct fs_dir_stream *dirs)
 {
 	fat_dir *dir = (fat_dir *)dirs;
-	free(dir->fsdata.fatbuf);
+	fat_cache_free(&dir->fsdata);
 	free(dir);
 }
 
@@ -213,42 +213,52 @@ static int disk_write(__u32 block, __u32 nr_blocks, void *buf)
 }
 
 /*
- * Write fat buffer into block device
+ * Write the modified sectors of a FAT cache window into block device
  */
-static int flush_dirty_fat_buffer(fsdata *mydata)
+static int flush_fat_window(fsdata *mydata, struct fat_cache_window *win)
 {
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
+	__u32 startblock = win->bufnum * FATBUFBLOCKS;
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 first, count;
 
-	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
-	      (int)mydata->fat_dirty);
+	debug("debug: evicting %d, dirty: %#x\n", win->bufnum, win->dirty);
 
-	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
+	if ((!win->dirty) || (win->bufnum == -1))
 		return 0;
 
 	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-	if (startblock + getsize > fatlength)
-		getsize = fatlength - startblock;
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
 
 	startblock += mydata->fat_sect;
 
-	/* Write FAT buf */
-	if (disk_write(startblock, getsize, bufptr) < 0) {
-		debug("error: writing FAT blocks\n");
-		return -1;
-	}
+	/* Write each run of modified sectors with a single request */
+	for (first = 0; first < getsize; first += count + 1) {
+		__u8 *bufptr = win->buf + first * mydata->sect_size;
+
+		count = 0;
+		while (first + count < getsize &&
+		       (win->dirty & BIT(first + count)))
+			count++;
+		if (!count)
+			continue;
 
-	if (mydata->fats == 2) {
-		/* Update corresponding second FAT blocks */
-		startblock += mydata->fatlength;
-		if (disk_write(startblock, getsize, bufptr) < 0) {
-			debug("error: writing second FAT blocks\n");
+		/* Write FAT buf */
+		if (disk_write(startblock + first, count, bufptr) < 0) {
+			debug("error: writing FAT blocks\n");
 			return -1;
 		}
+
+		if (mydata->fats == 2) {
+			/* Update corresponding second FAT blocks */
+			if (disk_write(startblock + first + mydata->fatlength,
+				       count, bufptr) < 0) {
+				debug("error: writing second FAT blocks\n");
+				return -1;
+			}
+		}
 	}
-	mydata->fat_dirty = 0;
+	win->dirty = 0;
 
 	return 0;
 }
@@ -435,11 +445,30 @@ fill_dir_slot(fat_itr *itr, const char *l_name, const char *shortname)
 	return 0;
 }
 
+/*
+ * Mark the sectors holding 'len' bytes at 'offset' in a FAT cache window as
+ * modified, so that only those are written back.
+ */
+static void mark_fat_dirty(fsdata *mydata, struct fat_cache_window *win,
+			   __u32 offset, __u32 len)
+{
+	__u32 sect, last = (offset + len - 1) / mydata->sect_size;
+
+	/* A FAT12 entry at the very end must not mark a sector past the FAT */
+	if (win->bufnum * FATBUFBLOCKS + last >= mydata->fatlength)
+		last = mydata->fatlength - win->bufnum * FATBUFBLOCKS - 1;
+
+	for (sect = offset / mydata->sect_size;
+	     sect <= last && sect < FATBUFBLOCKS; sect++)
+		win->dirty |= BIT(sect);
+}
+
 /*
  * Set the entry at index 'entry' in a FAT (12/16/32) table.
  */
 static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
+	struct fat_cache_window *win;
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
 
@@ -461,73 +490,56 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		return -1;
 	}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
-	}
-
-	/* Mark as dirty */
-	mydata->fat_dirty = 1;
+	/* Find the block of FAT entries in the cache, reading it if needed */
+	win = fat_cache_get(mydata, bufnum);
+	if (!win)
+		return -1;
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
-		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		((__u32 *)win->buf)[offset] = cpu_to_le32(entry_value);
+		mark_fat_dirty(mydata, win, offset * 4, 4);
 		break;
 	case 16:
-		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		((__u16 *)win->buf)[offset] = cpu_to_le16(entry_value);
+		mark_fat_dirty(mydata, win, offset * 2, 2);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
+		/* the entry may straddle two 16-bit words */
+		mark_fat_dirty(mydata, win, off16 * 2, 4);
 
 		switch (offset & 0x3) {
 		case 0:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff;
-			((__u16 *)mydata->fatbuf)[off16] |= val1;
+			((__u16 *)win->buf)[off16] &= ~0xfff;
+			((__u16 *)win->buf)[off16] |= val1;
 			break;
 		case 1:
 			val1 = cpu_to_le16(entry_value) & 0xf;
 			val2 = (cpu_to_le16(entry_value) >> 4) & 0xff;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xf000;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 12);
+			((__u16 *)win->buf)[off16] &= ~0xf000;
+			((__u16 *)win->buf)[off16] |= (val1 << 12);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xff;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)win->buf)[off16 + 1] &= ~0xff;
+			((__u16 *)win->buf)[off16 + 1] |= val2;
 			break;
 		case 2:
 			val1 = cpu_to_le16(entry_value) & 0xff;
 			val2 = (cpu_to_le16(entry_value) >> 8) & 0xf;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xff00;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 8);
+			((__u16 *)win->buf)[off16] &= ~0xff00;
+			((__u16 *)win->buf)[off16] |= (val1 << 8);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xf;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)win->buf)[off16 + 1] &= ~0xf;
+			((__u16 *)win->buf)[off16 + 1] |= val2;
 			break;
 		case 3:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff0;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 4);
+			((__u16 *)win->buf)[off16] &= ~0xfff0;
+			((__u16 *)win->buf)[off16] |= (val1 << 4);
 			break;
 		default:
 			break;
@@ -1354,7 +1366,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 		      loff_t size, loff_t *actwrite)
 {
 	dir_entry *retdent;
-	fsdata datablock = { .fatbuf = NULL, };
+	fsdata datablock = {};
 	fsdata *mydata = &datablock;
 	fat_itr *itr = NULL;
 	int ret = -1;
@@ -1474,7 +1486,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 
 exit:
 	free(filename_copy);
-	free(mydata->fatbuf);
+	fat_cache_free(mydata);
 	free(itr);
 	return ret;
 }
@@ -1488,8 +1500,7 @@ int file_fat_write(const char *filename, void *buffer, loff_t offset,
 static int fat_dir_entries(fat_itr *itr)
 {
 	fat_itr *dirs;
-	fsdata fsdata = { .fatbuf = NULL, }, *mydata = &fsdata;
-						/* for FATBUFSIZE */
+	fsdata fsdata = {};
 	int count;
 
 	dirs = malloc_cache_aligned(sizeof(fat_itr));
@@ -1503,21 +1514,19 @@ static int fat_dir_entries(fat_itr *itr)
 	fat_itr_child(dirs, itr);
 	fsdata = *dirs->fsdata;
 
-	/* allocate local fat buffer */
-	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
-	if (!fsdata.fatbuf) {
+	/* allocate local fat cache */
+	if (fat_cache_init(&fsdata)) {
 		debug("Error: allocating memory\n");
 		count = -ENOMEM;
 		goto exit;
 	}
-	fsdata.fatbufnum = -1;
 	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
 		;
 
 exit:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 	free(dirs);
 	return count;
 }
@@ -1608,7 +1617,7 @@ static int delete_dentry_long(fat_itr *itr)
 
 int fat_unlink(const char *filename)
 {
-	fsdata fsdata = { .fatbuf = NULL, };
+	fsdata fsdata = {};
 	fat_itr *itr = NULL;
 	int n_entries, ret;
 	char *filename_copy, *dirname, *basename;
@@ -1664,7 +1673,7 @@ int fat_unlink(const char *filename)
 	ret = delete_dentry_long(itr);
 
 exit:
-	free(fsdata.fatbuf);
+	fat_cache_free(&fsdata);
 	free(itr);
 	free(filename_copy);
 
@@ -1674,7 +1683,7 @@ exit:
 int fat_mkdir(const char *dirname)
 {
 	dir_entry *retdent;
-	fsdata datablock = { .fatbuf = NULL, };
+	fsdata datablock = {};
 	fsdata *mydata = &datablock;
 	fat_itr *itr = NULL;
 	char *dirname_copy, *parent, *basename;
@@ -1808,7 +1817,7 @@ int fat_mkdir(const char *dirname)
 
 exit:
 	free(dirname_copy);
-	free(mydata->fatbuf);
+	fat_cache_free(mydata);
 	free(itr);
 	free(dotdent);
 	return ret;
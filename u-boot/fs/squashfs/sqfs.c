@@ -93,6 +93,75 @@ static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
 	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
 }
 
+/*
+ * Drop everything cached from the previous image: the decompressed tables and
+ * the block cache.
+ */
+static void sqfs_cache_free(void)
+{
+	int i;
+
+	for (i = 0; i < SQFS_CACHE_BLOCKS; i++) {
+		free(ctxt.cache[i].data);
+		ctxt.cache[i].data = NULL;
+	}
+	free(ctxt.inode_table);
+	free(ctxt.dir_table);
+	free(ctxt.dir_pos_list);
+	ctxt.inode_table = NULL;
+	ctxt.dir_table = NULL;
+	ctxt.dir_pos_list = NULL;
+	ctxt.dir_metablks = 0;
+	ctxt.cache_dev = NULL;
+}
+
+/*
+ * Looks up the decompressed block found at 'pos' on the disk. Returns NULL if
+ * it is not cached.
+ */
+static struct squashfs_cache_entry *sqfs_cache_lookup(u64 pos)
+{
+	int i;
+
+	for (i = 0; i < SQFS_CACHE_BLOCKS; i++) {
+		if (ctxt.cache[i].data && ctxt.cache[i].pos == pos) {
+			ctxt.cache[i].lru = ++ctxt.cache_tick;
+			return &ctxt.cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Adds the decompressed block found at 'pos' on the disk to the cache,
+ * replacing the least recently used entry. The cache takes ownership of
+ * 'data', which stays valid until the next insertion.
+ */
+static struct squashfs_cache_entry *sqfs_cache_insert(u64 pos, void *data,
+						      unsigned long len)
+{
+	struct squashfs_cache_entry *e = &ctxt.cache[0];
+	int i;
+
+	for (i = 0; i < SQFS_CACHE_BLOCKS; i++) {
+		if (!ctxt.cache[i].data) {
+			e = &ctxt.cache[i];
+			break;
+		}
+		if (ctxt.cache[i].lru < e->lru)
+			e = &ctxt.cache[i];
+	}
+
+	free(e->data);
+	e->pos = pos;
+	e->data = data;
+	e->len = len;
+	e->lru = ++ctxt.cache_tick;
+
+	return e;
+}
+
 /*
  * Retrieves fragment block entry and returns true if the fragment block is
  * compressed
@@ -104,6 +173,7 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	unsigned char *metadata_buffer, *metadata, *table;
 	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct squashfs_cache_entry *ce;
 	unsigned long dest_len;
 	int block, offset, ret;
 	u16 header;
@@ -115,39 +185,58 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
 		return -EINVAL;
 
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
 	start = get_unaligned_le64(&sblk->fragment_table_start);
-	end = get_unaligned_le64(&sblk->id_table_start);
-	exp_tbl = get_unaligned_le64(&sblk->export_table_start);
+	ce = sqfs_cache_lookup(start);
+	if (!ce) {
+		end = get_unaligned_le64(&sblk->id_table_start);
+		exp_tbl = get_unaligned_le64(&sblk->export_table_start);
 
-	if (exp_tbl > start && exp_tbl < end)
-		end = exp_tbl;
+		if (exp_tbl > start && exp_tbl < end)
+			end = exp_tbl;
 
-	n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
-				  cpu_to_le64(end), &table_offset);
+		n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
+					  cpu_to_le64(end), &table_offset);
 
-	start /= ctxt.cur_dev->blksz;
+		start /= ctxt.cur_dev->blksz;
 
-	/* Allocate a proper sized buffer to store the fragment index table */
-	table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!table) {
-		ret = -ENOMEM;
-		goto out;
+		/* Allocate a proper sized buffer to store the fragment index table */
+		table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+		if (!table) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		if (sqfs_disk_read(start, n_blks, table) < 0) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		/* Keep only the index table itself in the cache */
+		memmove(table, table + table_offset,
+			n_blks * ctxt.cur_dev->blksz - table_offset);
+		ce = sqfs_cache_insert(get_unaligned_le64(&sblk->fragment_table_start),
+				       table, n_blks * ctxt.cur_dev->blksz -
+				       table_offset);
+		table = NULL;
 	}
 
-	if (sqfs_disk_read(start, n_blks, table) < 0) {
+	if ((block + 1) * sizeof(u64) > ce->len) {
 		ret = -EINVAL;
 		goto out;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
-
 	/*
 	 * Get the start offset of the metadata block that contains the right
 	 * fragment block entry
 	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+	start_block = get_unaligned_le64(ce->data + block * sizeof(u64));
+
+	ce = sqfs_cache_lookup(start_block);
+	if (ce)
+		goto found;
 
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
@@ -192,7 +281,13 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
 	}
 
+	ce = sqfs_cache_insert(start_block, entries, SQFS_METADATA_BLOCK_SIZE);
+	entries = NULL;
+
+found:
+	entries = ce->data;
 	*e = entries[offset];
+	entries = NULL;
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
 out:
@@ -878,13 +973,37 @@ out:
 	return metablks_count;
 }
 
+/*
+ * Decompresses the inode and directory tables, unless they are already cached
+ * for this image.
+ */
+static int sqfs_load_tables(void)
+{
+	int metablks_count;
+
+	if (ctxt.inode_table && ctxt.dir_table)
+		return 0;
+
+	if (sqfs_read_inode_table(&ctxt.inode_table))
+		return -EINVAL;
+
+	metablks_count = sqfs_read_directory_table(&ctxt.dir_table,
+						   &ctxt.dir_pos_list);
+	if (metablks_count < 1) {
+		free(ctxt.inode_table);
+		ctxt.inode_table = NULL;
+		return -EINVAL;
+	}
+	ctxt.dir_metablks = metablks_count;
+
+	return 0;
+}
+
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
-	int j, token_count = 0, ret = 0, metablks_count;
+	int j, token_count = 0, ret = 0;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -897,17 +1016,9 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
-	if (ret) {
-		ret = -EINVAL;
-		goto out;
-	}
-
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
-	if (metablks_count < 1) {
-		ret = -EINVAL;
+	ret = sqfs_load_tables();
+	if (ret)
 		goto out;
-	}
 
 	/* Tokenize filename */
 	token_count = sqfs_count_tokens(filename);
@@ -936,10 +1047,10 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
-			      metablks_count);
+	dirs->inode_table = ctxt.inode_table;
+	dirs->dir_table = ctxt.dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count, ctxt.dir_pos_list,
+			      ctxt.dir_metablks);
 	if (ret)
 		goto out;
 
@@ -963,10 +1074,9 @@ out:
 	for (j = 0; j < token_count; j++)
 		free(token_list[j]);
 	free(token_list);
-	free(pos_list);
 	free(path);
 	if (ret) {
-		free(inode_table);
+		free(dirs->dir_header);
 		free(dirs);
 	}
 
@@ -1114,6 +1224,16 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 		goto error;
 	}
 
+	/* Keep the cached tables and blocks only if the image is the same */
+	if (ctxt.cache_dev != fs_dev_desc ||
+	    ctxt.cache_part_start != fs_partition->start ||
+	    memcmp(&ctxt.cache_sblk, sblk, sizeof(*sblk))) {
+		sqfs_cache_free();
+		ctxt.cache_dev = fs_dev_desc;
+		ctxt.cache_part_start = fs_partition->start;
+		memcpy(&ctxt.cache_sblk, sblk, sizeof(*sblk));
+	}
+
 	return 0;
 error:
 	ctxt.cur_dev = NULL;
@@ -1320,11 +1440,15 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
+	char *dir = NULL, *fragment_block, *datablock = NULL, *dest;
 	char *fragment = NULL, *file = NULL, *resolved, *data;
-	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
+	char *data_buffer = NULL;
+	u64 start, n_blks, table_size, data_offset, table_offset, blk_start;
 	int ret, j, i_number, datablk_count = 0;
+	loff_t end, pos, copy_len;
+	u32 block_size, first_blk;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct squashfs_cache_entry *ce;
 	struct squashfs_fragment_block_entry frag_entry;
 	struct squashfs_file_info finfo = {0};
 	struct squashfs_symlink_inode *symlink;
@@ -1339,14 +1463,6 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 
 	*actread = 0;
 
-	if (offset) {
-		/*
-		 * TODO: implement reading at an offset in file
-		 */
-		printf("Error: reading at a specific offset in a squashfs file is not supported yet.\n");
-		return -EINVAL;
-	}
-
 	/*
 	 * sqfs_opendir will uncompress inode and directory tables, and will
 	 * return a pointer to the directory that contains the requested file.
@@ -1428,151 +1544,170 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		goto out;
 	}
 
-	/* If the user specifies a length, check its sanity */
-	if (len) {
-		if (len > finfo.size) {
-			ret = -EINVAL;
-			goto out;
-		}
-
-		finfo.size = len;
-	} else {
-		len = finfo.size;
+	/* Read at most up to the end of the file */
+	if (offset > finfo.size) {
+		ret = -EINVAL;
+		goto out;
 	}
 
+	if (!len || len > finfo.size - offset)
+		len = finfo.size - offset;
+	end = offset + len;
+
+	block_size = get_unaligned_le32(&sblk->block_size);
 	if (datablk_count) {
-		data_offset = finfo.start;
-		datablock = malloc(get_unaligned_le32(&sblk->block_size));
-		if (!datablock) {
+		datablock = malloc(block_size);
+		/* A data block is never larger than the block size on disk */
+		n_blks = DIV_ROUND_UP(block_size + ctxt.cur_dev->blksz - 1,
+				      ctxt.cur_dev->blksz);
+		data_buffer = malloc_cache_aligned(n_blks *
+						   ctxt.cur_dev->blksz);
+		if (!datablock || !data_buffer) {
 			ret = -ENOMEM;
 			goto out;
 		}
 	}
 
-	for (j = 0; j < datablk_count; j++) {
-		char *data_buffer;
+	/* Skip the data blocks before the offset */
+	data_offset = finfo.start;
+	first_blk = lldiv(offset, block_size);
+	for (j = 0; j < datablk_count && j < first_blk; j++)
+		data_offset += SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
+
+	for (; j < datablk_count && (u64)j * block_size < end; j++) {
+		blk_start = (u64)j * block_size;
+		pos = max(offset, (loff_t)blk_start);
+		copy_len = min(end, (loff_t)(blk_start + block_size)) - pos;
 
-		start = lldiv(data_offset, ctxt.cur_dev->blksz);
 		table_size = SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
-		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
-		n_blks = DIV_ROUND_UP(table_size + table_offset,
-				      ctxt.cur_dev->blksz);
+		if (table_size > block_size) {
+			ret = -EINVAL;
+			goto out;
+		}
 
 		/* Don't load any data for sparse blocks */
 		if (finfo.blk_sizes[j] == 0) {
-			n_blks = 0;
-			table_offset = 0;
-			data_buffer = NULL;
-			data = NULL;
-		} else {
-			data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-			if (!data_buffer) {
-				ret = -ENOMEM;
-				goto out;
-			}
+			memset(buf + pos - offset, 0, copy_len);
+			*actread += copy_len;
+			continue;
+		}
 
-			ret = sqfs_disk_read(start, n_blks, data_buffer);
-			if (ret < 0) {
-				/*
-				 * Possible causes: too many data blocks or too large
-				 * SquashFS block size. Tip: re-compile the SquashFS
-				 * image with mksquashfs's -b <block_size> option.
-				 */
-				printf("Error: too many data blocks to be read.\n");
-				goto out;
-			}
+		start = lldiv(data_offset, ctxt.cur_dev->blksz);
+		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
+		n_blks = DIV_ROUND_UP(table_size + table_offset,
+				      ctxt.cur_dev->blksz);
 
-			data = data_buffer + table_offset;
+		ret = sqfs_disk_read(start, n_blks, data_buffer);
+		if (ret < 0) {
+			/*
+			 * Possible causes: too many data blocks or too large
+			 * SquashFS block size. Tip: re-compile the SquashFS
+			 * image with mksquashfs's -b <block_size> option.
+			 */
+			printf("Error: too many data blocks to be read.\n");
+			goto out;
 		}
 
+		data = data_buffer + table_offset;
+
 		/* Load the data */
-		if (finfo.blk_sizes[j] == 0) {
-			/* This is a sparse block */
-			sparse_size = get_unaligned_le32(&sblk->block_size);
-			if ((*actread + sparse_size) > len)
-				sparse_size = len - *actread;
-			memset(buf + *actread, 0, sparse_size);
-			*actread += sparse_size;
-		} else if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
-			dest_len = get_unaligned_le32(&sblk->block_size);
-			ret = sqfs_decompress(&ctxt, datablock, &dest_len,
-					      data, table_size);
+		if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
+			/* Whole blocks are decompressed in place */
+			dest = datablock;
+			if (pos == blk_start && copy_len == block_size)
+				dest = buf + pos - offset;
+
+			dest_len = block_size;
+			ret = sqfs_decompress(&ctxt, dest, &dest_len, data,
+					      table_size);
 			if (ret)
 				goto out;
 
-			if ((*actread + dest_len) > len)
-				dest_len = len - *actread;
-			memcpy(buf + *actread, datablock, dest_len);
-			*actread += dest_len;
+			if (dest != buf + pos - offset)
+				memcpy(buf + pos - offset,
+				       datablock + pos - blk_start, copy_len);
 		} else {
-			if ((*actread + table_size) > len)
-				table_size = len - *actread;
-			memcpy(buf + *actread, data, table_size);
-			*actread += table_size;
+			memcpy(buf + pos - offset, data + pos - blk_start,
+			       copy_len);
 		}
+		*actread += copy_len;
 
 		data_offset += table_size;
-		free(data_buffer);
-		if (*actread >= len)
-			break;
 	}
 
 	/*
-	 * There is no need to continue if the file is not fragmented.
+	 * There is no need to continue if the file is not fragmented, or if
+	 * the fragment is not part of the range to read.
 	 */
-	if (!finfo.frag) {
+	blk_start = (u64)datablk_count * block_size;
+	if (!finfo.frag || end <= blk_start) {
 		ret = 0;
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	pos = max(offset, (loff_t)blk_start);
+	copy_len = end - pos;
 
-	if (!fragment) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	ce = sqfs_cache_lookup(frag_entry.start);
+	if (!ce) {
+		start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
+		table_size = SQFS_BLOCK_SIZE(frag_entry.size);
+		table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
+		n_blks = DIV_ROUND_UP(table_size + table_offset,
+				      ctxt.cur_dev->blksz);
 
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
-		goto out;
+		fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
 
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
+		if (!fragment) {
 			ret = -ENOMEM;
 			goto out;
 		}
 
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
+		ret = sqfs_disk_read(start, n_blks, fragment);
+		if (ret < 0)
 			goto out;
-		}
 
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
+		/* Keep the uncompressed fragment block in the cache */
+		if (finfo.comp) {
+			dest_len = block_size;
+			fragment_block = malloc(dest_len);
+			if (!fragment_block) {
+				ret = -ENOMEM;
+				goto out;
+			}
 
-		free(fragment_block);
+			ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
+					      (void *)fragment  + table_offset,
+					      frag_entry.size);
+			if (ret) {
+				free(fragment_block);
+				goto out;
+			}
+		} else {
+			dest_len = table_size;
+			fragment_block = fragment;
+			memmove(fragment_block, fragment + table_offset,
+				dest_len);
+			fragment = NULL;
+		}
 
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
+		ce = sqfs_cache_insert(frag_entry.start, fragment_block,
+				       dest_len);
+	}
 
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
+	if (finfo.offset + (pos - blk_start) + copy_len > ce->len) {
+		ret = -EINVAL;
+		goto out;
 	}
 
+	memcpy(buf + pos - offset,
+	       ce->data + finfo.offset + (pos - blk_start), copy_len);
+	*actread += copy_len;
+	ret = 0;
+
 out:
 	free(fragment);
+	free(data_buffer);
 	free(datablock);
 	free(file);
 	free(dir);
@@ -1724,9 +1859,8 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 	if (!dirs)
 		return;
 
+	/* The inode and directory tables belong to the cache */
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
-	free(sqfs_dirs->inode_table);
-	free(sqfs_dirs->dir_table);
 	free(sqfs_dirs->dir_header);
 	free(sqfs_dirs);
 }
@@ -71,6 +71,23 @@ struct squashfs_super_block {
 	__le64 export_table_start;
 };
 
+#ifdef CONFIG_FS_SQUASHFS_CACHE_BLOCKS
+#define SQFS_CACHE_BLOCKS CONFIG_FS_SQUASHFS_CACHE_BLOCKS
+#else
+#define SQFS_CACHE_BLOCKS 1
+#endif
+
+/*
+ * Decompressed block (metadata block, fragment block or fragment index table),
+ * keyed by its position on the disk.
+ */
+struct squashfs_cache_entry {
+	u64 pos;
+	void *data;
+	unsigned long len;
+	u32 lru;
+};
+
 struct squashfs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
@@ -78,6 +95,21 @@ struct squashfs_ctxt {
 #if IS_ENABLED(CONFIG_ZSTD)
 	void *zstd_workspace;
 #endif
+	/*
+	 * Everything below is kept across sqfs_close() and only dropped when
+	 * a different image is probed, so that successive commands on the
+	 * same image do not decompress the same tables again.
+	 */
+	struct blk_desc *cache_dev;
+	lbaint_t cache_part_start;
+	struct squashfs_super_block cache_sblk;
+	/* Decompressed inode and directory tables */
+	unsigned char *inode_table;
+	unsigned char *dir_table;
+	u32 *dir_pos_list;
+	int dir_metablks;
+	struct squashfs_cache_entry cache[SQFS_CACHE_BLOCKS];
+	u32 cache_tick;
 };
 
 struct squashfs_directory_index {
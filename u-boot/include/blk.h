@@ -80,6 +80,8 @@ struct blk_desc {
 		uint32_t mbr_sig;	/* MBR integer signature */
 		efi_guid_t guid_sig;	/* GPT GUID Signature */
 	};
+	/* Incremented whenever the contents may have changed, e.g. on a write */
+	u32		change_seq;
 #if CONFIG_IS_ENABLED(BLK)
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -111,6 +113,9 @@ struct blk_desc {
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
+ * The longest cached prefix of the requested range is copied to @buffer, so
+ * the caller only needs to fetch the remaining blocks from the device.
+ *
  * @param iftype - uclass_id_x for type of device
  * @param dev - device index of particular type
  * @param start - starting block number
@@ -118,11 +123,11 @@ struct blk_desc {
  * @param blksz - size in bytes of each block
  * @param buffer - buffer to contain cached data
  *
- * Return: - 1 if block returned from cache, 0 otherwise.
+ * Return: - number of leading blocks returned from cache (0 to @blkcnt)
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+lbaint_t blkcache_read(int iftype, int dev,
+		       lbaint_t start, lbaint_t blkcnt,
+		       unsigned long blksz, void *buffer);
 
 /**
  * blkcache_fill() - make data read from a block device available
@@ -140,6 +145,39 @@ void blkcache_fill(int iftype, int dev,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_readahead() - decide how far to read ahead of a cache miss
+ *
+ * This tracks the last miss on each call and grows a readahead window while
+ * the misses are sequential.
+ *
+ * @param iftype - uclass_id_x for type of device
+ * @param dev - device index of particular type
+ * @param start - first block that missed the cache
+ * @param blkcnt - number of blocks that missed the cache
+ * @param blksz - size in bytes of each block
+ *
+ * Return: - number of blocks to read after @start + @blkcnt, 0 for none
+ */
+lbaint_t blkcache_readahead(int iftype, int dev,
+			    lbaint_t start, lbaint_t blkcnt,
+			    unsigned long blksz);
+
+/**
+ * blkcache_fill_readahead() - add a read with readahead data to the cache
+ *
+ * @param iftype - uclass_id_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks requested by the caller
+ * @param ra - number of readahead blocks following them
+ * @param blksz - size in bytes of each block
+ * @param buffer - buffer containing @blkcnt + @ra blocks
+ */
+void blkcache_fill_readahead(int iftype, int dev,
+			     lbaint_t start, lbaint_t blkcnt, lbaint_t ra,
+			     unsigned long blksz, void const *buffer);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -152,10 +190,11 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - blocks per entry, rounded down to a power of two
+ * @param size - maximum number of bytes held by the cache
+ * @param ra - maximum number of blocks to read ahead, 0 to disable
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned long size, unsigned ra);
 
 /*
  * statistics of the block cache
@@ -163,9 +202,15 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
+	unsigned partial_hits; /* reads served partly from the cache */
+	unsigned evictions;
+	unsigned ra_blocks; /* blocks read ahead */
+	unsigned ra_hits; /* entries filled by readahead which were used */
 	unsigned entries; /* current entry count */
+	unsigned long bytes; /* current size of cached data */
 	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned long max_bytes;
+	unsigned max_readahead;
 };
 
 /**
@@ -180,9 +225,9 @@ void blkcache_free(void);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline lbaint_t blkcache_read(int iftype, int dev,
+				     lbaint_t start, lbaint_t blkcnt,
+				     unsigned long blksz, void *buffer)
 {
 	return 0;
 }
@@ -191,6 +236,18 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline lbaint_t blkcache_readahead(int iftype, int dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  unsigned long blksz)
+{
+	return 0;
+}
+
+static inline void blkcache_fill_readahead(int iftype, int dev,
+					   lbaint_t start, lbaint_t blkcnt,
+					   lbaint_t ra, unsigned long blksz,
+					   void const *buffer) {}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
 static inline void blkcache_free(void) {}
@@ -541,7 +598,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	ulong blks_read;
 	if (blkcache_read(block_dev->uclass_id, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+			  start, blkcnt, block_dev->blksz, buffer) == blkcnt)
 		return blkcnt;
 
 	/*
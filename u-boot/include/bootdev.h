@@ -77,6 +77,10 @@ typedef int (*bootdev_hunter_func)(struct bootdev_hunter *info, bool show);
  * @uclass: Uclass ID for the media associated with this bootdev
  * @drv: bootdev driver for the things found by this hunter
  * @hunt: Function to call to hunt for bootdevs of this type (NULL if none)
+ * @start: Function to call to start hunting without waiting for the result
+ *	(NULL if none). This should set off any slow work, such as powering up
+ *	the ports of a bus, so that it proceeds while other bootdevs are used.
+ *	The @hunt function is still called later and must finish the job.
  *
  * Some bootdevs are not visible until other devices are enumerated. For
  * example, USB bootdevs only appear when the USB bus is enumerated.
@@ -93,6 +97,7 @@ struct bootdev_hunter {
 	enum uclass_id uclass;
 	struct driver *drv;
 	bootdev_hunter_func hunt;
+	bootdev_hunter_func start;
 };
 
 /* declare a new bootdev hunter */
@@ -321,6 +326,19 @@ int bootdev_hunt(const char *spec, bool show);
  */
 int bootdev_hunt_prio(enum bootdev_prio_t prio, bool show);
 
+/**
+ * bootdev_hunt_start() - Start hunters matching a particular spec
+ *
+ * This calls the start() function of the selected hunters (or all if @spec is
+ * NULL) which have one and have not been used yet. Each is finished when
+ * bootdev_hunt() or bootdev_hunt_prio() uses it.
+ *
+ * @spec: Spec to match, e.g. "usb0", or NULL for any, as with bootdev_hunt()
+ * @show: true to show each hunter as it is started
+ * Returns: 0 if OK, -ve on error
+ */
+int bootdev_hunt_start(const char *spec, bool show);
+
 /**
  * bootdev_unhunt() - Mark a device as needing to be hunted again
  *
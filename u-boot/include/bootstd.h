@@ -37,6 +37,8 @@ struct udevice;
  * @theme: Node containing the theme information
  * @hunters_used: Bitmask of used hunters, indexed by their position in the
  * linker list. The bit is set if the hunter has been used already
+ * @hunters_started: Bitmask of hunters which have been started by
+ * bootdev_hunt_start() but not used yet, indexed as @hunters_used
  */
 struct bootstd_priv {
 	const char **prefixes;
@@ -50,6 +52,7 @@ struct bootstd_priv {
 	struct udevice *vbe_bootmeth;
 	ofnode theme;
 	uint hunters_used;
+	uint hunters_started;
 };
 
 /**
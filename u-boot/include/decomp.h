@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Streaming decompression
+ *
+ * This provides a common interface for decompressing data which arrives in
+ * pieces, into an output window which may be smaller than the whole output.
+ */
+
+#ifndef __DECOMP_H
+#define __DECOMP_H
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+struct decomp_stream;
+
+/**
+ * struct decomp_ops - operations provided by each compression algorithm
+ *
+ * @run: Decompress as much as possible, see decomp_stream_run()
+ * @end: Free any memory allocated by the algorithm
+ */
+struct decomp_ops {
+	int (*run)(struct decomp_stream *ds);
+	void (*end)(struct decomp_stream *ds);
+};
+
+/**
+ * struct decomp_stream - state of a streaming decompression
+ *
+ * The caller sets up @next_in, @avail_in, @in_end, @next_out and @avail_out
+ * before each call to decomp_stream_run(), which updates them.
+ *
+ * @next_in: Next input byte
+ * @avail_in: Number of bytes available at @next_in
+ * @in_end: true if there is no more input after that at @next_in
+ * @next_out: Where to write the next output byte
+ * @avail_out: Space available at @next_out
+ * @total_in: Total number of input bytes read so far
+ * @total_out: Total number of bytes output so far
+ * @ops: Operations for the algorithm in use
+ * @priv: Private data for the algorithm
+ */
+struct decomp_stream {
+	const void *next_in;
+	size_t avail_in;
+	bool in_end;
+	void *next_out;
+	size_t avail_out;
+	ulong total_in;
+	ulong total_out;
+	const struct decomp_ops *ops;
+	void *priv;
+};
+
+#if CONFIG_IS_ENABLED(DECOMP_STREAM)
+
+/**
+ * decomp_stream_supported() - check if streaming supports an algorithm
+ *
+ * @comp: Compression algorithm (IH_COMP_...)
+ * Return: true if decomp_stream_init() can be used with @comp
+ */
+bool decomp_stream_supported(int comp);
+
+/**
+ * decomp_stream_init() - start a streaming decompression
+ *
+ * Supported are IH_COMP_GZIP (a single gzip member, whose CRC is checked),
+ * IH_COMP_LZ4 (a single LZ4 frame with independent blocks) and IH_COMP_ZSTD
+ * (one or more zstd frames). Input after the end of the stream is ignored.
+ * Since another zstd frame may follow the last one seen, a zstd stream only
+ * ends once @in_end is set.
+ *
+ * @ds: Stream to set up; the input and output fields are cleared
+ * @comp: Compression algorithm (IH_COMP_...)
+ * Return: 0 if OK, -ENOSYS if @comp is not supported, -ENOMEM if out of
+ * memory
+ */
+int decomp_stream_init(struct decomp_stream *ds, int comp);
+
+/**
+ * decomp_stream_run() - decompress as much as possible
+ *
+ * This reads input and writes output until the input is used up, the output
+ * window is full or the end of the compressed stream is reached. Some input
+ * may be held inside the stream, so an input byte which has been read does
+ * not necessarily have a matching output byte yet.
+ *
+ * If input is left over when this returns 0, the output window is full and
+ * the caller must provide a new one before continuing.
+ *
+ * @ds: Stream to use
+ * Return: 1 at the end of the stream, 0 if more input or output space is
+ * needed, -EINVAL or -EPROTO if the data is corrupt, -ENOMEM if out of memory
+ */
+int decomp_stream_run(struct decomp_stream *ds);
+
+/**
+ * decomp_stream_end() - finish a streaming decompression
+ *
+ * This frees the memory used by the stream. It must be called whether the
+ * decompression completed or not.
+ *
+ * @ds: Stream to finish
+ */
+void decomp_stream_end(struct decomp_stream *ds);
+
+#else
+
+static inline bool decomp_stream_supported(int comp)
+{
+	return false;
+}
+
+static inline int decomp_stream_init(struct decomp_stream *ds, int comp)
+{
+	return -ENOSYS;
+}
+
+static inline int decomp_stream_run(struct decomp_stream *ds)
+{
+	return -ENOSYS;
+}
+
+static inline void decomp_stream_end(struct decomp_stream *ds)
+{
+}
+
+#endif
+
+/* Helpers for the algorithms */
+
+static inline void decomp_stream_consume(struct decomp_stream *ds, size_t len)
+{
+	ds->next_in += len;
+	ds->avail_in -= len;
+	ds->total_in += len;
+}
+
+static inline void decomp_stream_produce(struct decomp_stream *ds, size_t len)
+{
+	ds->next_out += len;
+	ds->avail_out -= len;
+	ds->total_out += len;
+}
+
+int gzip_stream_init(struct decomp_stream *ds);
+int lz4_stream_init(struct decomp_stream *ds);
+int zstd_stream_init(struct decomp_stream *ds);
+
+#endif
@@ -360,6 +360,31 @@ int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
  */
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_write_pending() - write out a full buffer waiting to be written
+ *
+ * With CONFIG_DFU_BUF_COUNT > 1, dfu_write() leaves full buffers in a ring
+ * rather than writing them to the medium straight away. This writes out the
+ * oldest one, if at least CONFIG_DFU_BUF_HIGH_WATER are waiting. It is meant
+ * to be called between transfers, e.g. from the main loop of the USB gadget.
+ *
+ * See function :c:func:`dfu_write`
+ *
+ * Return:		0 for success, other value on failure
+ */
+int dfu_write_pending(void);
+
+/**
+ * dfu_get_write_error() - get and clear the error from dfu_write_pending()
+ *
+ * A failure in dfu_write_pending() ends the transaction, but happens outside
+ * any request from the host. The USB gadget uses this to report it in the
+ * response to the next DFU_GETSTATUS request.
+ *
+ * Return:		0 if there was no error, else the error from the write
+ */
+int dfu_get_write_error(void);
+
 /**
  * dfu_initiated_callback() - weak callback called on DFU transaction start
  *
@@ -192,6 +192,64 @@ int device_of_to_plat(struct udevice *dev);
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_finish() - Complete probing a device after its probe() method
+ *
+ * This runs the uclass post_probe() method and the post-probe event. On error
+ * the device is deactivated again.
+ *
+ * @dev: Device being probed, with DM_FLAG_ACTIVATED set
+ * @ret: Result of the driver's probe() method
+ * Return: 0 if OK, -ve on error
+ */
+int device_probe_finish(struct udevice *dev, int ret);
+
+/**
+ * device_probe_wait() - Wait for a device's pending probe to complete
+ *
+ * This polls the device until the probe started by device_probe_async() is
+ * done, then finishes it.
+ *
+ * @dev: Device to wait for
+ * Return: 0 if OK (or if no probe is pending), -ve on error, in which case
+ *	the device is no longer active
+ */
+int device_probe_wait(struct udevice *dev);
+
+/**
+ * dm_probe_defer() - Record a device whose probe is to be completed later
+ *
+ * This is only allowed while the device is being probed by dm_probe_run()
+ *
+ * @dev: Device being probed
+ * @poll: Function to check whether the probe is complete
+ * Return: 0 if deferred (DM_FLAG_PROBE_PENDING is set), -EPERM if the caller
+ *	must wait for the device, -ENOMEM if out of memory
+ */
+int dm_probe_defer(struct udevice *dev, int (*poll)(struct udevice *dev));
+
+/**
+ * dm_probe_run() - Probe devices, letting slow ones complete in the background
+ *
+ * This probes all devices below @root which have DM_FLAG_PROBE_AFTER_BIND
+ * set, parents first. A device is only probed when its parent and the
+ * suppliers named by its clocks, power-domains, resets and ...-supply
+ * properties have finished probing, so while a probe is pending, independent
+ * devices are probed instead. Probes still pending on return complete in the
+ * background, or when something waits for them.
+ *
+ * @root: Device to start from
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int dm_probe_run(struct udevice *root);
+
+/**
+ * dm_probe_reset() - Forget all pending probes
+ *
+ * This is called when driver model is set up again
+ */
+void dm_probe_reset(void);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
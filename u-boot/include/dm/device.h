@@ -84,6 +84,9 @@ struct driver_info;
 /* Device must be probed after it was bound */
 #define DM_FLAG_PROBE_AFTER_BIND	(1 << 15)
 
+/* Device probe was started by device_probe_async() and has not finished */
+#define DM_FLAG_PROBE_PENDING		(1 << 16)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -166,6 +169,8 @@ enum {
  * @dma_offset: Offset between the physical address space (CPU's) and the
  *		device's bus address space
  * @iommu: IOMMU device associated with this device
+ * @node_hash: Used by uclass to index its devices by @node_
+ * @phandle_hash: Used by uclass to index its devices by phandle
  */
 struct udevice {
 	const struct driver *driver;
@@ -198,6 +203,10 @@ struct udevice {
 #if CONFIG_IS_ENABLED(IOMMU)
 	struct udevice *iommu;
 #endif
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	struct hlist_node node_hash;
+	struct hlist_node phandle_hash;
+#endif
 };
 
 static inline int dm_udevice_size(void)
@@ -266,8 +275,13 @@ static inline __attribute_const__ ofnode dev_ofnode(const struct udevice *dev)
 #endif
 }
 
-/* Returns non-zero if the device is active (probed and not removed) */
-#define device_active(dev)	(dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+/*
+ * Returns non-zero if the device is active (probed and not removed). A device
+ * whose probe is still pending is not active until the probe completes.
+ */
+#define device_active(dev)	((dev_get_flags(dev) & \
+				  (DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING)) == \
+				 DM_FLAG_ACTIVATED)
 
 #if CONFIG_IS_ENABLED(DM_DMA)
 #define dev_set_dma_offset(_dev, _offset)	_dev->dma_offset = _offset
@@ -997,6 +1011,34 @@ int dev_disable_by_path(const char *path);
  */
 int dev_enable_by_path(const char *path);
 
+/**
+ * device_probe_async() - Let a driver's probe() method finish in the background
+ *
+ * This is for drivers whose probe mostly waits for hardware, e.g. a PHY to
+ * come out of reset or a link to train. The driver starts the hardware in its
+ * probe() method and ends with::
+ *
+ *	return device_probe_async(dev, foo_poll);
+ *
+ * @poll is then called until it returns something other than -EINPROGRESS.
+ * When the device is probed by dm_autoprobe() with CONFIG_DM_PROBE_ASYNC, this
+ * returns -EINPROGRESS at once and the probe is completed (including the
+ * uclass post_probe() method) once @poll succeeds, so that other devices can
+ * be probed in the meantime. Anything which probes the device, directly or as
+ * a parent or supplier, waits for it. Otherwise @poll is called here until it
+ * is done.
+ *
+ * @poll must not probe other devices, since it may be called from schedule(),
+ * and should time out if the hardware does not respond.
+ *
+ * @dev: Device being probed
+ * @poll: Function to check whether the probe is complete: returns 0 if done,
+ *	-EINPROGRESS if not done yet, other -ve value on error
+ * Return: -EINPROGRESS if the probe is to be completed later, else the result
+ *	of @poll
+ */
+int device_probe_async(struct udevice *dev, int (*poll)(struct udevice *dev));
+
 /**
  * device_is_on_pci_bus - Test if a device is on a PCI bus
  *
@@ -12,6 +12,8 @@
 #include <dm/ofnode.h>
 #include <dm/uclass-id.h>
 
+struct udevice_id;
+
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
  *
@@ -45,6 +47,20 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - find the driver for a compatible string
+ *
+ * This returns the first driver in the linker list which has @compat in its
+ * of_match table. With CONFIG_DM_COMPAT_INDEX this uses a sorted index of all
+ * compatible strings, built the first time it is needed after relocation.
+ *
+ * @compat: Compatible string to look up
+ * @idp: Returns the entry for @compat in the driver's of_match table
+ * Return: pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
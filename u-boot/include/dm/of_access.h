@@ -266,6 +266,33 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 struct device_node *of_find_node_by_phandle(struct device_node *root,
 					    phandle handle);
 
+/**
+ * of_phandle_cache_build() - Set up a cache of the nodes in a tree by phandle
+ *
+ * With CONFIG_OF_PHANDLE_CACHE, this is done when a tree is unflattened, so
+ * that of_find_node_by_phandle() does not need to search the tree. Nothing
+ * is cached if the phandles are too sparse to fit in a small array.
+ *
+ * @root:	root node of the tree
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int of_phandle_cache_build(struct device_node *root);
+
+/**
+ * of_phandle_cache_free() - Free the phandle cache for a tree, if any
+ *
+ * @root:	root node of the tree
+ */
+void of_phandle_cache_free(const struct device_node *root);
+
+/**
+ * of_phandle_cache_get_stats() - Get the number of phandle lookups
+ *
+ * @hitsp:	Returns the number of lookups answered by a cache
+ * @missesp:	Returns the number of lookups which searched the tree
+ */
+void of_phandle_cache_get_stats(uint *hitsp, uint *missesp);
+
 /**
  * of_read_u8() - Find and read a 8-bit integer from a property
  *
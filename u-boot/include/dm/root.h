@@ -34,6 +34,8 @@ extern struct list_head uclass_head;
  * @attach_size_total: Total number of bytes of attached data
  * @attach_count: Number of devices with attached, for each type
  * @attach_size: Total number of bytes of attached data, for each type
+ * @phandle_hits: Number of phandle lookups answered by a phandle cache
+ * @phandle_misses: Number of phandle lookups which searched the device tree
  */
 struct dm_stats {
 	int total_size;
@@ -50,6 +52,8 @@ struct dm_stats {
 	int attach_size_total;
 	int attach_count[DM_TAG_ATTACH_COUNT];
 	int attach_size[DM_TAG_ATTACH_COUNT];
+	uint phandle_hits;
+	uint phandle_misses;
 };
 
 /**
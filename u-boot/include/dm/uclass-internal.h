@@ -249,6 +249,22 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 				  const char *name, struct udevice **devp);
 
+/**
+ * uclass_find_device_by_phandle_id() - Find a uclass device by phandle ID
+ *
+ * This searches the devices in the uclass for one whose node has the given
+ * phandle.
+ *
+ * The device is NOT probed, it is merely returned.
+ *
+ * @id: ID to look up
+ * @find_phandle: Phandle to search for
+ * @devp: Returns pointer to device
+ * Return: 0 if OK, -ENODEV if there is no such device, other -ve on error
+ */
+int uclass_find_device_by_phandle_id(enum uclass_id id, uint find_phandle,
+				     struct udevice **devp);
+
 /**
  * uclass_bind_device() - Associate device with a uclass
  *
@@ -259,6 +275,30 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
  */
 int uclass_bind_device(struct udevice *dev);
 
+/**
+ * uclass_index_device() - Add a device to its uclass's index
+ *
+ * With CONFIG_DM_NODE_INDEX, the devices in each uclass are indexed by device
+ * tree node and phandle, so that uclass_find_device_by_ofnode() and phandle
+ * lookups do not need to check every device. This is done when the device is
+ * bound, but must be repeated if its node changes afterwards.
+ *
+ * The phandle is read when the device is indexed, so a phandle added to the
+ * node later is not found.
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_index_device(struct udevice *dev);
+
+/**
+ * uclass_unindex_device() - Remove a device from its uclass's index
+ *
+ * This does nothing if the device is not indexed.
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_unindex_device(struct udevice *dev);
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * uclass_pre_unbind_device() - Prepare to deassociate device with a uclass
@@ -30,12 +30,24 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @node_hash: Hash table of devices by device tree node, or NULL if the
+ * devices are not indexed (do not access outside driver model)
+ * @phandle_hash: Hash table of devices by phandle, with the same size as
+ * @node_hash (do not access outside driver model)
+ * @hash_bits: log2 of the number of entries in each hash table
+ * @hash_count: Number of devices in @node_hash
  */
 struct uclass {
 	void *priv_;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_NODE_INDEX)
+	struct hlist_head *node_hash;
+	struct hlist_head *phandle_hash;
+	uint hash_bits;
+	uint hash_count;
+#endif
 };
 
 struct driver;
@@ -360,12 +360,16 @@ struct efi_open_protocol_info_item {
  * protocol GUID to the respective protocol interface
  *
  * @link:		link to the list of protocols of a handle
+ * @index_link:		link to the list of handlers with the same GUID
+ * @handle:		handle on which the protocol is installed
  * @guid:		GUID of the protocol
  * @protocol_interface:	protocol interface
  * @open_infos:		link to the list of open protocol info items
  */
 struct efi_handler {
 	struct list_head link;
+	struct list_head index_link;
+	struct efi_object *handle;
 	const efi_guid_t guid;
 	void *protocol_interface;
 	struct list_head open_infos;
@@ -392,6 +396,9 @@ enum efi_object_type {
  * struct efi_object - dereferenced EFI handle
  *
  * @link:	pointers to put the handle into a linked list
+ * @hash_node:	node in the hash table used to validate handles
+ * @seq:	sequence number, giving the position of the handle in the object
+ *		list
  * @protocols:	linked list with the protocol interfaces installed on this
  *		handle
  * @type:	image type if the handle relates to an image
@@ -410,6 +417,8 @@ enum efi_object_type {
 struct efi_object {
 	/* Every UEFI object is part of a global object list */
 	struct list_head link;
+	struct hlist_node hash_node;
+	ulong seq;
 	/* The list of protocols */
 	struct list_head protocols;
 	enum efi_object_type type;
@@ -642,6 +651,29 @@ efi_status_t efi_create_handle(efi_handle_t *handle);
 efi_status_t efi_delete_handle(efi_handle_t obj);
 /* Call this to validate a handle and find the EFI object for it */
 struct efi_object *efi_search_obj(const efi_handle_t handle);
+
+/**
+ * struct efi_lookup_stats - statistics about handle and protocol lookups
+ *
+ * @handles:		number of handles
+ * @protocols:		number of protocol GUIDs which have been installed
+ * @handle_lookups:	number of handles validated by efi_search_obj()
+ * @handle_misses:	number of those which were not valid handles
+ * @protocol_lookups:	number of calls to efi_search_protocol()
+ * @locates:		number of searches for the handles with a protocol, by
+ *			LocateHandle(), LocateHandleBuffer() and LocateProtocol()
+ */
+struct efi_lookup_stats {
+	ulong handles;
+	ulong protocols;
+	ulong handle_lookups;
+	ulong handle_misses;
+	ulong protocol_lookups;
+	ulong locates;
+};
+
+/* Get statistics about handle and protocol lookups */
+void efi_get_lookup_stats(struct efi_lookup_stats *stats);
 /* Locate device_path handle */
 efi_status_t EFIAPI efi_locate_device_path(const efi_guid_t *protocol,
 					   struct efi_device_path **device_path,
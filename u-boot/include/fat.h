@@ -26,6 +26,16 @@ struct disk_partition;
 			 sizeof(dir_entry))
 
 #define FATBUFBLOCKS	6
+#ifdef CONFIG_FS_FAT_CACHE_WINDOWS
+#define FATCACHEWINDOWS	CONFIG_FS_FAT_CACHE_WINDOWS
+#else
+#define FATCACHEWINDOWS	1
+#endif
+#ifdef CONFIG_FS_FAT_BOUNCE_SIZE
+#define FAT_BOUNCE_SIZE	CONFIG_FS_FAT_BOUNCE_SIZE
+#else
+#define FAT_BOUNCE_SIZE	0
+#endif
 #define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
@@ -156,22 +166,31 @@ typedef struct dir_slot {
 } dir_slot;
 
 /*
- * Private filesystem parameters
+ * Window of the FAT cache, holding FATBUFBLOCKS sectors of the FAT
  *
  * Note: FAT buffer has to be 32 bit aligned
  * (see FAT32 accesses)
  */
+struct fat_cache_window {
+	__u8	*buf;		/* FAT sectors, NULL if not allocated yet */
+	int	bufnum;		/* Window number in the FAT, -1 if empty */
+	__u32	dirty;		/* Bitmap of modified sectors in buf */
+	__u32	lru;		/* Value of fat_tick when last used */
+};
+
+/*
+ * Private filesystem parameters
+ */
 typedef struct {
-	__u8	*fatbuf;	/* Current FAT buffer */
+	struct fat_cache_window fatcache[FATCACHEWINDOWS];
+	__u32	fat_tick;	/* Incremented on each FAT cache access */
 	int	fatsize;	/* Size of FAT in bits */
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
-	__u8	fat_dirty;      /* Set if fatbuf has been modified */
 	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
-	int	fatbufnum;	/* Used by get_fatent, init to -1 */
 	int	rootdir_size;	/* Size of root dir for non-FAT32 */
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
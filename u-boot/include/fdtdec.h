@@ -701,6 +701,28 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id);
  */
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find the node with a given phandle
+ *
+ * This is the same as fdt_node_offset_by_phandle(), except that with
+ * CONFIG_OF_PHANDLE_CACHE the offsets of the nodes in the control FDT are
+ * cached after relocation, so most lookups do not need to search the tree.
+ * The cache is checked before use, so it is safe to modify the FDT.
+ *
+ * @blob:	FDT blob
+ * @phandle:	Phandle to look for
+ * Return: node offset if found, -ve FDT_ERR_... on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, u32 phandle);
+
+/**
+ * fdtdec_phandle_cache_get_stats() - Get the number of phandle lookups
+ *
+ * @hitsp:	Returns the number of lookups answered by the cache
+ * @missesp:	Returns the number of lookups which searched the tree
+ */
+void fdtdec_phandle_cache_get_stats(uint *hitsp, uint *missesp);
+
 /**
  * Look up a property in a node and return its contents in an integer
  * array of given length. The property must have at least enough data for
@@ -11,6 +11,24 @@
 
 #define ROUNDUP(x, y)	(((x) + ((y) - 1)) & ~((y) - 1))
 
+/**
+ * struct sparse_storage - where to write a sparse image
+ *
+ * @erase is optional. If provided, it is used for whole groups of @erase_grp
+ * blocks, to write long runs of zeroes if @erase_zero is set and, with
+ * CONFIG_IMAGE_SPARSE_DISCARD, to discard DONT_CARE chunks.
+ *
+ * @blksz: Block size in bytes
+ * @start: First block of the partition
+ * @size: Size of the partition in blocks
+ * @priv: Private data for the functions below
+ * @write: Write blocks, returning the number of blocks used
+ * @reserve: Skip blocks, returning the number of blocks used
+ * @erase: Erase blocks, returning the number of blocks erased
+ * @erase_grp: Number of blocks in an erase group
+ * @erase_zero: true if erased blocks read back as zero
+ * @mssg: Report an error
+ */
 struct sparse_storage {
 	lbaint_t	blksz;
 	lbaint_t	start;
@@ -26,6 +44,12 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	lbaint_t	erase_grp;
+	bool		erase_zero;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -343,6 +343,9 @@ struct image_info {
 	uint8_t		arch;			/* CPU architecture */
 };
 
+/* Maximum number of images for bootm to verify in parallel */
+#define FIT_VERIFIED_MAX	8
+
 /*
  * Legacy and FIT format headers used by do_bootm() and do_bootm_<os>()
  * routines.
@@ -367,6 +370,7 @@ struct bootm_headers {
 	void		*fit_hdr_os;	/* os FIT image header */
 	const char	*fit_uname_os;	/* os subimage node unit name */
 	int		fit_noffset_os;	/* os subimage node offset */
+	bool		fit_verify_os;	/* os hashes not checked yet */
 
 	void		*fit_hdr_rd;	/* init ramdisk FIT image header */
 	const char	*fit_uname_rd;	/* init ramdisk subimage node unit name */
@@ -380,6 +384,11 @@ struct bootm_headers {
 	const char	*fit_uname_setup; /* x86 setup subimage node name */
 	int		fit_noffset_setup;/* x86 setup subimage node offset */
 
+	/* Images whose hashes were checked in parallel, see FIT_PARALLEL_VERIFY */
+	const void	*fit_hdr_verified;	/* FIT they are in */
+	int		fit_noffset_verified[FIT_VERIFIED_MAX];
+	int		fit_verified_count;
+
 #ifndef USE_HOSTCC
 	struct image_info	os;		/* os image info */
 	ulong		ep;		/* entry point of OS */
@@ -602,6 +611,7 @@ enum fit_load_op {
 	FIT_LOAD_OPTIONAL,	/* Can be provided, but optional */
 	FIT_LOAD_OPTIONAL_NON_ZERO,	/* Optional, a value of 0 is ignored */
 	FIT_LOAD_REQUIRED,	/* Must be provided */
+	FIT_LOAD_STREAM,	/* Ignore, hashes may be checked when loading */
 };
 
 int boot_get_setup(struct bootm_headers *images, uint8_t arch, ulong *setup_start,
@@ -1340,6 +1350,42 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       size_t size);
 
 int fit_image_verify(const void *fit, int noffset);
+
+/**
+ * fit_image_hash_only() - Check if an image is only protected by hashes
+ *
+ * This is true if the image has no signature which must be checked and
+ * all of its hashes can be calculated progressively. Such an image can be
+ * verified while loading it, or with its hashes calculated on other CPUs.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Offset of the image node in @fit
+ * Return: true if fit_image_load_stream() can be used for this image
+ */
+bool fit_image_hash_only(const void *fit, int image_noffset);
+
+/**
+ * fit_image_load_stream() - Load an image, checking its hashes as it goes
+ *
+ * The image data is processed in chunks, each of which is hashed and then
+ * copied or decompressed to @load_buf while it is still in the cache, so the
+ * data is only read once. The hashes are checked after the last chunk.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Offset of the image node in @fit
+ * @comp:	Compression of the image data (IH_COMP_NONE, or one supported by
+ *		decomp_stream_init())
+ * @load_buf:	Buffer to write the image to
+ * @unc_len:	Size of @load_buf
+ * @image_buf:	Image data
+ * @image_len:	Size of the image data
+ * @lenp:	Returns the number of bytes written to @load_buf
+ * Return: 0 if OK, -EACCES if a hash does not match, -ENOSPC if @load_buf is
+ * too small, -ENOSYS if @comp is not supported, other -ve value on other error
+ */
+int fit_image_load_stream(const void *fit, int image_noffset, int comp,
+			  void *load_buf, ulong unc_len, const void *image_buf,
+			  ulong image_len, ulong *lenp);
 #if CONFIG_IS_ENABLED(FIT_SIGNATURE)
 int fit_config_verify(const void *fit, int conf_noffset);
 #else
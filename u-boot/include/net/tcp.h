@@ -68,8 +68,8 @@ struct ip_tcp_hdr {
  * TCP header options, Seq, MSS, and SACK
  */
 
-#define TCP_SACK 32			/* Number of packets analyzed   */
-					/* on leading edge of stream    */
+#define TCP_SACK 32			/* Max out-of-order ranges	*/
+					/* tracked past the ACK edge	*/
 
 #define TCP_O_END	0x00		/* End of option list		*/
 #define TCP_1_NOP	0x01		/* Single padding NOP		*/
@@ -281,6 +281,8 @@ enum tcp_state tcp_get_tcp_state(void);
 void tcp_set_tcp_state(enum tcp_state new_state);
 int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 		       u8 action, u32 tcp_seq_num, u32 tcp_ack_num);
+u32 tcp_get_ack_edge(void);
+bool tcp_ack_can_wait(void);
 
 /**
  * rxhand_tcp() - An incoming packet handler.
@@ -90,4 +90,15 @@ int nvme_print_info(struct udevice *udev);
  */
 int nvme_get_namespace_id(struct udevice *udev, u32 *ns_id, u8 *eui64);
 
+/**
+ * nvme_set_io_timeout - set how long to wait for I/O commands to complete
+ *
+ * Commands which take longer are treated as failed. A very short timeout
+ * makes them fail on purpose, to test the recovery from a timeout.
+ *
+ * @udev:	NVMe block device
+ * @timeout_ms:	timeout in milliseconds, for the whole controller
+ */
+void nvme_set_io_timeout(struct udevice *udev, uint timeout_ms);
+
 #endif /* __NVME_H__ */
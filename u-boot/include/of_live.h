@@ -25,7 +25,7 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp);
  * unflatten_device_tree() - create tree of device_nodes from flat blob
  *
  * Note that this allocates a single block of memory, pointed to by *mynodes.
- * To free the tree, use free(*mynodes)
+ * To free the tree, use of_live_free(*mynodes)
  *
  * unflattens a device-tree, creating the
  * tree of struct device_node. It also fills the "name" and "type"
@@ -548,4 +548,22 @@ long os_get_time_offset(void);
  */
 void os_set_time_offset(long offset);
 
+/**
+ * os_thread_run() - run a function on several host threads
+ *
+ * This starts up to @count threads, limited by the number of host CPUs less
+ * one for the calling thread. Only one set of threads can run at a time.
+ *
+ * @count:	maximum number of threads to start
+ * @func:	function for each thread to run
+ * @arg:	argument to pass to @func
+ * Return:	number of threads started
+ */
+int os_thread_run(int count, void *(*func)(void *arg), void *arg);
+
+/**
+ * os_thread_wait() - wait for the threads from os_thread_run() to finish
+ */
+void os_thread_wait(void);
+
 #endif
@@ -465,6 +465,43 @@ void ut_unsilence_console(struct unit_test_state *uts);
  */
 void ut_set_skip_delays(struct unit_test_state *uts, bool skip_delays);
 
+/**
+ * ut_rand() - Step a simple pseudo-random sequence
+ *
+ * This is a linear congruential generator, for test data and workloads which
+ * must be the same on every run. The upper bits are the most random.
+ *
+ * @seedp: State of the sequence, updated
+ * Return: next value in the sequence
+ */
+static inline u32 ut_rand(u32 *seedp)
+{
+	*seedp = *seedp * 1103515245 + 12345;
+
+	return *seedp;
+}
+
+/**
+ * ut_fill_random() - Fill a buffer with pseudo-random bytes
+ *
+ * @buf: Buffer to fill
+ * @len: Number of bytes to fill
+ * @seed: Starting value; the same seed always gives the same bytes
+ */
+void ut_fill_random(void *buf, ulong len, u32 seed);
+
+/**
+ * ut_show_rate() - Show the throughput of a benchmark
+ *
+ * Benchmarks depend on the host, so they are marked UT_TESTF_MANUAL and their
+ * names end in _norun. This prints one line, e.g. "sha1     512 MiB/s".
+ *
+ * @name: What was measured
+ * @bytes: Number of bytes processed
+ * @start: Value of timer_get_us() when the processing started
+ */
+void ut_show_rate(const char *name, u64 bytes, ulong start);
+
 /**
  * test_get_state() - Get the active test state
  *
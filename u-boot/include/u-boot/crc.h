@@ -96,6 +96,49 @@ uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 void crc32_wd_buf(const uint8_t *input, uint ilen, uint8_t *output,
 		  uint chunk_sz);
 
+/**
+ * enum crc32_impl - CRC32 implementations in lib/crc32.c
+ *
+ * @CRC32_IMPL_TABLE: Byte-wise table lookup
+ * @CRC32_IMPL_SLICE_BY_8: Eight table lookups per 64-bit word
+ * @CRC32_IMPL_ARM64: ARMv8 CRC32 instructions
+ * @CRC32_IMPL_PCLMUL: x86 carry-less multiplication (sandbox only)
+ * @CRC32_IMPL_COUNT: Number of implementations
+ */
+enum crc32_impl {
+	CRC32_IMPL_TABLE,
+	CRC32_IMPL_SLICE_BY_8,
+	CRC32_IMPL_ARM64,
+	CRC32_IMPL_PCLMUL,
+
+	CRC32_IMPL_COUNT,
+};
+
+/**
+ * crc32_impl_name() - Get the name of a CRC32 implementation
+ *
+ * @impl: Implementation
+ * Return: name, or NULL if @impl is not valid
+ */
+const char *crc32_impl_name(enum crc32_impl impl);
+
+/**
+ * crc32_impl() - Calculate the CRC32 with a particular implementation
+ *
+ * This is only intended for tests, which compare the implementations. Use
+ * crc32() otherwise.
+ *
+ * @impl: Implementation to use
+ * @crcp: Input crc to chain from (0 to start a new calculation), returns the
+ *	checksum value
+ * @buf: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * Return: 0 if OK, -ENOSYS if @impl is not available in this build or on this
+ *	CPU
+ */
+int crc32_impl(enum crc32_impl impl, uint32_t *crcp, const uint8_t *buf,
+	       uint len);
+
 /* lib/crc32c.c */
 
 /**
@@ -62,6 +62,29 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
  */
 void sha1_finish( sha1_context *ctx, unsigned char output[20] );
 
+/**
+ * \brief	   SHA-1 process 64-byte blocks (weak, may be accelerated)
+ *
+ * \param ctx	   SHA-1 context
+ * \param data	   buffer holding the data
+ * \param blocks   number of 64-byte blocks in the buffer
+ */
+void sha1_process(sha1_context *ctx, const unsigned char *data,
+		  unsigned int blocks);
+
+/**
+ * \brief	   SHA-1 process 64-byte blocks in portable C
+ *
+ * This is the default sha1_process(), for use as a fallback by an
+ * accelerated version.
+ *
+ * \param ctx	   SHA-1 context
+ * \param data	   buffer holding the data
+ * \param blocks   number of 64-byte blocks in the buffer
+ */
+void sha1_process_sw(sha1_context *ctx, const unsigned char *data,
+		     unsigned int blocks);
+
 /**
  * \brief	   Output = SHA-1( input buffer )
  *
@@ -24,4 +24,29 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/**
+ * sha256_process() - Add 64-byte blocks to the digest
+ *
+ * This is weak, so that an architecture can provide an accelerated version.
+ *
+ * @ctx: SHA-256 context
+ * @data: Data to process
+ * @blocks: Number of 64-byte blocks in @data
+ */
+void sha256_process(sha256_context *ctx, const unsigned char *data,
+		    unsigned int blocks);
+
+/**
+ * sha256_process_sw() - Add 64-byte blocks to the digest, in portable C
+ *
+ * This is the default sha256_process(), for use as a fallback by an
+ * accelerated version.
+ *
+ * @ctx: SHA-256 context
+ * @data: Data to process
+ * @blocks: Number of 64-byte blocks in @data
+ */
+void sha256_process_sw(sha256_context *ctx, const unsigned char *data,
+		       unsigned int blocks);
+
 #endif /* _SHA256_H */
@@ -267,10 +267,23 @@ int usb_kbd_deregister(int force);
 /*
  * usb_init() - initialize the USB Controllers
  *
+ * If usb_init_async() has been called, this finishes what it started.
+ *
  * Returns: 0 if OK, -ENOENT if there are no USB devices
  */
 int usb_init(void);
 
+/*
+ * usb_init_async() - start initialising the USB Controllers
+ *
+ * This probes the controllers and powers on the ports of their root hubs,
+ * without waiting for devices to connect. A later call to usb_init() scans
+ * the ports, so the power-on and debounce delays can pass in the meantime.
+ *
+ * Returns: 0 if OK, -ENOENT if there are no USB controllers
+ */
+int usb_init_async(void);
+
 int usb_stop(void); /* stop the USB Controller */
 int usb_detect_change(void); /* detect if a USB device has been (un)plugged */
 
@@ -949,6 +962,33 @@ bool usb_device_has_child_on_port(struct usb_device *parent, int port);
 int usb_hub_probe(struct usb_device *dev, int ifnum);
 void usb_hub_reset(void);
 
+/**
+ * usb_hub_scan_defer() - leave the ports of new hubs to be scanned later
+ *
+ * While this is set, configuring a hub powers on its ports but does not wait
+ * for devices to connect to them. The ports are scanned later by
+ * usb_hub_scan_pending(), by which time their power-on and debounce delays
+ * may have passed.
+ *
+ * @defer:	true to leave ports for later, false to scan them straight away
+ */
+void usb_hub_scan_defer(bool defer);
+
+/**
+ * usb_hub_scan_pending() - scan the ports left by usb_hub_scan_defer()
+ *
+ * This waits until each port has a device or has timed out, enumerating the
+ * devices found, including the ports of any hubs among them.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int usb_hub_scan_pending(void);
+
+/**
+ * usb_hub_scan_cancel() - drop the ports left by usb_hub_scan_defer()
+ */
+void usb_hub_scan_cancel(void);
+
 /*
  * usb_find_usb2_hub_address_port() - Get hub address and port for TT setting
  *
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Boot-time workers, to run independent compute jobs (such as hashing the
+ * images to be booted) on the secondary CPUs while they are otherwise idle.
+ */
+
+#ifndef __worker_h
+#define __worker_h
+
+/**
+ * struct worker_job - a job to run on any CPU
+ *
+ * A job may run on a secondary CPU at the same time as other jobs, so it
+ * must only compute on memory which no other job touches. It must not call
+ * into drivers, the console, malloc() or schedule().
+ *
+ * @func: Function to call
+ * @arg: Argument to pass to @func
+ */
+struct worker_job {
+	void (*func)(void *arg);
+	void *arg;
+};
+
+#if CONFIG_IS_ENABLED(WORKER)
+
+/**
+ * worker_run() - run a set of jobs, using the secondary CPUs if available
+ *
+ * The boot CPU takes part in running the jobs, so this works (serially) even
+ * if no secondary CPU can be started. All jobs are finished on return.
+ *
+ * @jobs: Jobs to run
+ * @count: Number of jobs in @jobs
+ * Return: number of CPUs which ran jobs, including the boot CPU
+ */
+int worker_run(struct worker_job *jobs, int count);
+
+/**
+ * arch_worker_start() - start secondary CPUs running a function
+ *
+ * This is provided by the architecture; only sandbox does so at present.
+ *
+ * @func: Function for each CPU to call; it returns when there is no more work
+ * @arg: Argument to pass to @func
+ * @max: Maximum number of CPUs to start
+ * Return: number of CPUs started
+ */
+int arch_worker_start(void (*func)(void *arg), void *arg, int max);
+
+/**
+ * arch_worker_wait() - wait for the CPUs from arch_worker_start() to finish
+ *
+ * On return, all memory written by the secondary CPUs is visible to the boot
+ * CPU.
+ */
+void arch_worker_wait(void);
+
+#else
+
+static inline int worker_run(struct worker_job *jobs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		jobs[i].func(jobs[i].arg);
+
+	return 1;
+}
+
+#endif
+
+#endif
@@ -10,8 +10,11 @@
 
 #ifdef USE_HOSTCC
 #include <arpa/inet.h>
+#include <linux/compiler_attributes.h>
+#include <linux/kconfig.h>
 #else
 #include <efi_loader.h>
+#include <errno.h>
 #endif
 #include <compiler.h>
 #include <u-boot/crc.h>
@@ -82,7 +85,7 @@ static void __efi_runtime make_crc_table(void)
   }
   crc_table_empty = 0;
 }
-#elif !defined(CONFIG_ARM64_CRC32)
+#else
 /* ========================================================================
  * Table of CRC-32's of all single-byte values (made by make_crc_table)
  */
@@ -177,17 +180,14 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
-/* No ones complement version. JFFS2 (and other things ?)
- * don't use ones compliment in their CRC calculations.
+/*
+ * The crc32_...() helpers below work on the CRC register in little-endian
+ * byte order, i.e. the value passed to crc32_no_comp() after cpu_to_le32().
  */
-uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+static uint32_t __maybe_unused __efi_runtime crc32_table(uint32_t crc,
+							 const Bytef *buf,
+							 uInt len)
 {
-#ifdef CONFIG_ARM64_CRC32
-    crc = cpu_to_le32(crc);
-    while (len--)
-        crc = __builtin_aarch64_crc32b(crc, *buf++);
-    return le32_to_cpu(crc);
-#else
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
     size_t rem_len;
@@ -195,7 +195,6 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     if (crc_table_empty)
       make_crc_table();
 #endif
-    crc = cpu_to_le32(crc);
     /* Align it */
     if (((long)b) & 3 && len) {
 	 uint8_t *p = (uint8_t *)b;
@@ -224,11 +223,193 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 	 } while (--len);
     }
 
-    return le32_to_cpu(crc);
+    return crc;
+}
+
+#if CONFIG_IS_ENABLED(CRC32_SLICE_BY_8) && __BYTE_ORDER == __LITTLE_ENDIAN
+#define CRC32_SLICE_BY_8
+
+#include "crc32_slice.h"
+
+static uint32_t __efi_runtime crc32_slice8(uint32_t crc, const Bytef *buf,
+					   uInt len)
+{
+	const uint32_t (*t)[256] = crc_slice_table;
+	const uint32_t *tab = crc_table;
+	uint32_t lo, hi;
+
+#ifdef CONFIG_DYNAMIC_CRC_TABLE
+	if (crc_table_empty)
+		make_crc_table();
+#endif
+	while (len && ((uintptr_t)buf & 7)) {
+		DO_CRC(*buf++);
+		len--;
+	}
+	for (; len >= 8; len -= 8, buf += 8) {
+		lo = *(const uint32_t *)buf ^ crc;
+		hi = *(const uint32_t *)(buf + 4);
+		crc = t[6][lo & 0xff] ^ t[5][(lo >> 8) & 0xff] ^
+		      t[4][(lo >> 16) & 0xff] ^ t[3][lo >> 24] ^
+		      t[2][hi & 0xff] ^ t[1][(hi >> 8) & 0xff] ^
+		      t[0][(hi >> 16) & 0xff] ^ tab[hi >> 24];
+	}
+	while (len--)
+		DO_CRC(*buf++);
+
+	return crc;
+}
+#endif
+
+#ifdef CONFIG_ARM64_CRC32
+static uint32_t __efi_runtime crc32_arm64(uint32_t crc, const Bytef *buf,
+					  uInt len)
+{
+	while (len && ((uintptr_t)buf & 7)) {
+		crc = __builtin_aarch64_crc32b(crc, *buf++);
+		len--;
+	}
+	for (; len >= 8; len -= 8, buf += 8)
+		crc = __builtin_aarch64_crc32x(crc, *(const uint64_t *)buf);
+	while (len--)
+		crc = __builtin_aarch64_crc32b(crc, *buf++);
+
+	return crc;
+}
 #endif
+
+#if CONFIG_IS_ENABLED(CRC32_PCLMUL) && defined(__x86_64__)
+#define CRC32_PCLMUL
+
+typedef long long crc_v2di __attribute__((vector_size(16)));
+typedef long long crc_v2di_u __attribute__((vector_size(16), aligned(1)));
+
+static inline crc_v2di crc_load(const Bytef *buf)
+{
+	return *(const crc_v2di_u *)buf;
+}
+
+/* Multiply both halves of @val by x^n mod P, with the constants in @k */
+static inline __attribute__((target("pclmul")))
+crc_v2di crc_fold(crc_v2di val, crc_v2di k)
+{
+	return __builtin_ia32_pclmulqdq128(val, k, 0x00) ^
+	       __builtin_ia32_pclmulqdq128(val, k, 0x11);
+}
+
+/*
+ * Fold the data into a 128-bit remainder with carry-less multiplication, four
+ * blocks of 16 bytes at a time, as described in Intel's "Fast CRC Computation
+ * for Generic Polynomials Using PCLMULQDQ Instruction". The CRC of the
+ * remainder is the CRC of all data folded into it, so the final reduction is
+ * left to the table code.
+ */
+static uint32_t __attribute__((target("pclmul")))
+crc32_pclmul(uint32_t crc, const Bytef *buf, uInt len)
+{
+	/* x^(4 * 128 + 32 / - 32) and x^(128 + 32 / - 32) mod P, reflected */
+	const crc_v2di k1k2 = { 0x154442bd4, 0x1c6e41596 };
+	const crc_v2di k3k4 = { 0x1751997d0, 0x0ccaa009e };
+	crc_v2di x0, x1, x2, x3;
+
+	if (len < 64)
+		return crc32_table(crc, buf, len);
+
+	x0 = crc_load(buf) ^ (crc_v2di){ crc, 0 };
+	x1 = crc_load(buf + 16);
+	x2 = crc_load(buf + 32);
+	x3 = crc_load(buf + 48);
+	for (buf += 64, len -= 64; len >= 64; buf += 64, len -= 64) {
+		x0 = crc_fold(x0, k1k2) ^ crc_load(buf);
+		x1 = crc_fold(x1, k1k2) ^ crc_load(buf + 16);
+		x2 = crc_fold(x2, k1k2) ^ crc_load(buf + 32);
+		x3 = crc_fold(x3, k1k2) ^ crc_load(buf + 48);
+	}
+	x0 = crc_fold(x0, k3k4) ^ x1;
+	x0 = crc_fold(x0, k3k4) ^ x2;
+	x0 = crc_fold(x0, k3k4) ^ x3;
+	for (; len >= 16; buf += 16, len -= 16)
+		x0 = crc_fold(x0, k3k4) ^ crc_load(buf);
+
+	crc = crc32_table(0, (const Bytef *)&x0, sizeof(x0));
+
+	return crc32_table(crc, buf, len);
+}
+#endif
+
+/* No ones complement version. JFFS2 (and other things ?)
+ * don't use ones compliment in their CRC calculations.
+ */
+uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+{
+	crc = cpu_to_le32(crc);
+#if defined(CONFIG_ARM64_CRC32)
+	crc = crc32_arm64(crc, buf, len);
+#else
+#ifdef CRC32_PCLMUL
+	if (__builtin_cpu_supports("pclmul"))
+		crc = crc32_pclmul(crc, buf, len);
+	else
+#endif
+#ifdef CRC32_SLICE_BY_8
+		crc = crc32_slice8(crc, buf, len);
+#else
+		crc = crc32_table(crc, buf, len);
+#endif
+#endif
+
+	return le32_to_cpu(crc);
 }
 #undef DO_CRC
 
+#if !defined(USE_HOSTCC) && CONFIG_IS_ENABLED(UNIT_TEST)
+static const char *const crc32_impl_names[CRC32_IMPL_COUNT] = {
+	[CRC32_IMPL_TABLE]	= "table",
+	[CRC32_IMPL_SLICE_BY_8]	= "slice-by-8",
+	[CRC32_IMPL_ARM64]	= "arm64",
+	[CRC32_IMPL_PCLMUL]	= "pclmul",
+};
+
+const char *crc32_impl_name(enum crc32_impl impl)
+{
+	return impl < CRC32_IMPL_COUNT ? crc32_impl_names[impl] : NULL;
+}
+
+int crc32_impl(enum crc32_impl impl, uint32_t *crcp, const uint8_t *buf,
+	       uint len)
+{
+	uint32_t crc = cpu_to_le32(*crcp ^ 0xffffffff);
+
+	switch (impl) {
+	case CRC32_IMPL_TABLE:
+		crc = crc32_table(crc, buf, len);
+		break;
+#ifdef CRC32_SLICE_BY_8
+	case CRC32_IMPL_SLICE_BY_8:
+		crc = crc32_slice8(crc, buf, len);
+		break;
+#endif
+#ifdef CONFIG_ARM64_CRC32
+	case CRC32_IMPL_ARM64:
+		crc = crc32_arm64(crc, buf, len);
+		break;
+#endif
+#ifdef CRC32_PCLMUL
+	case CRC32_IMPL_PCLMUL:
+		if (!__builtin_cpu_supports("pclmul"))
+			return -ENOSYS;
+		crc = crc32_pclmul(crc, buf, len);
+		break;
+#endif
+	default:
+		return -ENOSYS;
+	}
+	*crcp = le32_to_cpu(crc) ^ 0xffffffff;
+
+	return 0;
+}
+#endif
+
 uint32_t __efi_runtime crc32(uint32_t crc, const Bytef *p, uInt len)
 {
      return crc32_no_comp(crc ^ 0xffffffffL, p, len) ^ 0xffffffffL;
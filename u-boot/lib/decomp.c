@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Streaming decompression
+ *
+ * The algorithms themselves live next to their one-shot versions, in
+ * gunzip.c, lz4_wrapper.c and zstd/zstd.c
+ */
+
+#include <decomp.h>
+#include <errno.h>
+#include <image.h>
+
+bool decomp_stream_supported(int comp)
+{
+	switch (comp) {
+	case IH_COMP_GZIP:
+		return CONFIG_IS_ENABLED(GZIP);
+	case IH_COMP_LZ4:
+		return CONFIG_IS_ENABLED(LZ4);
+	case IH_COMP_ZSTD:
+		return CONFIG_IS_ENABLED(ZSTD);
+	}
+
+	return false;
+}
+
+int decomp_stream_init(struct decomp_stream *ds, int comp)
+{
+	memset(ds, '\0', sizeof(*ds));
+	switch (comp) {
+	case IH_COMP_GZIP:
+		if (CONFIG_IS_ENABLED(GZIP))
+			return gzip_stream_init(ds);
+		break;
+	case IH_COMP_LZ4:
+		if (CONFIG_IS_ENABLED(LZ4))
+			return lz4_stream_init(ds);
+		break;
+	case IH_COMP_ZSTD:
+		if (CONFIG_IS_ENABLED(ZSTD))
+			return zstd_stream_init(ds);
+		break;
+	}
+
+	return -ENOSYS;
+}
+
+int decomp_stream_run(struct decomp_stream *ds)
+{
+	return ds->ops->run(ds);
+}
+
+void decomp_stream_end(struct decomp_stream *ds)
+{
+	if (ds->ops)
+		ds->ops->end(ds);
+	ds->ops = NULL;
+	ds->priv = NULL;
+}
@@ -30,6 +30,33 @@ static efi_uintn_t efi_tpl = TPL_APPLICATION;
 /* This list contains all the EFI objects our payload has access to */
 LIST_HEAD(efi_obj_list);
 
+#define EFI_HANDLE_HASH_BITS	6
+#define EFI_PROTOCOL_HASH_BITS	5
+
+/**
+ * struct efi_protocol_index - handlers of one protocol GUID
+ *
+ * @node:	node in efi_protocol_hash
+ * @guid:	GUID of the protocol
+ * @handlers:	handlers with this GUID, in the order of efi_obj_list
+ */
+struct efi_protocol_index {
+	struct hlist_node node;
+	efi_guid_t guid;
+	struct list_head handlers;
+};
+
+/* Hash table of all EFI objects, used to validate handles */
+static struct hlist_head efi_handle_hash[1 << EFI_HANDLE_HASH_BITS];
+
+/* Hash table of struct efi_protocol_index, one for each protocol GUID */
+static struct hlist_head efi_protocol_hash[1 << EFI_PROTOCOL_HASH_BITS];
+
+/* Sequence number for the next handle added */
+static ulong efi_handle_seq;
+
+static struct efi_lookup_stats efi_lookup_stats;
+
 /* List of all events */
 __efi_runtime_data LIST_HEAD(efi_events);
 
@@ -234,6 +261,8 @@ static efi_status_t efi_purge_handle(efi_handle_t handle)
 	}
 	/* The last protocol has been removed, delete the handle. */
 	list_del(&handle->link);
+	hlist_del(&handle->hash_node);
+	efi_lookup_stats.handles--;
 	free(handle);
 
 	return EFI_SUCCESS;
@@ -534,6 +563,83 @@ static efi_status_t EFIAPI efi_free_pool_ext(void *buffer)
 	return EFI_EXIT(r);
 }
 
+/**
+ * efi_handle_hash_head() - get the hash table bucket for a handle
+ *
+ * @handle:	handle, which need not be valid
+ * Return:	bucket in efi_handle_hash
+ */
+static struct hlist_head *efi_handle_hash_head(const void *handle)
+{
+	u32 val = (uintptr_t)handle >> 3;
+
+	return &efi_handle_hash[(val * 0x9e3779b9) >>
+				(32 - EFI_HANDLE_HASH_BITS)];
+}
+
+/**
+ * efi_protocol_index_find() - find the handlers of a protocol GUID
+ *
+ * @protocol:	GUID of the protocol
+ * @create:	true to add an empty entry if none exists yet
+ * Return:	index entry, or NULL if not found or out of memory
+ */
+static struct efi_protocol_index *efi_protocol_index_find(
+			const efi_guid_t *protocol, bool create)
+{
+	struct efi_protocol_index *idx;
+	struct hlist_head *head;
+	u32 val;
+
+	memcpy(&val, protocol->b, sizeof(val));
+	head = &efi_protocol_hash[(val * 0x9e3779b9) >>
+				  (32 - EFI_PROTOCOL_HASH_BITS)];
+	hlist_for_each_entry(idx, head, node) {
+		if (!guidcmp(&idx->guid, protocol))
+			return idx;
+	}
+	if (!create)
+		return NULL;
+
+	idx = malloc(sizeof(*idx));
+	if (!idx)
+		return NULL;
+	guidcpy(&idx->guid, protocol);
+	INIT_LIST_HEAD(&idx->handlers);
+	hlist_add_head(&idx->node, head);
+	efi_lookup_stats.protocols++;
+
+	return idx;
+}
+
+/**
+ * efi_protocol_index_add() - add a handler to the index of its GUID
+ *
+ * The handlers of each GUID are kept in the order of their handles in
+ * efi_obj_list, so that LocateHandle() returns them in the same order as a
+ * search of all handles would.
+ *
+ * @idx:	index entry for the GUID of the handler
+ * @handler:	handler to add
+ */
+static void efi_protocol_index_add(struct efi_protocol_index *idx,
+				   struct efi_handler *handler)
+{
+	struct efi_handler *pos;
+
+	/* Usually the handle is the newest one, so start from the end */
+	list_for_each_entry_reverse(pos, &idx->handlers, index_link) {
+		if (pos->handle->seq < handler->handle->seq)
+			break;
+	}
+	list_add(&handler->index_link, &pos->index_link);
+}
+
+void efi_get_lookup_stats(struct efi_lookup_stats *stats)
+{
+	*stats = efi_lookup_stats;
+}
+
 /**
  * efi_add_handle() - add a new handle to the object list
  *
@@ -548,6 +654,9 @@ void efi_add_handle(efi_handle_t handle)
 		return;
 	INIT_LIST_HEAD(&handle->protocols);
 	list_add_tail(&handle->link, &efi_obj_list);
+	handle->seq = efi_handle_seq++;
+	hlist_add_head(&handle->hash_node, efi_handle_hash_head(handle));
+	efi_lookup_stats.handles++;
 }
 
 /**
@@ -585,6 +694,7 @@ efi_status_t efi_search_protocol(const efi_handle_t handle,
 	struct efi_object *efiobj;
 	struct list_head *lhandle;
 
+	efi_lookup_stats.protocol_lookups++;
 	if (!handle || !protocol_guid)
 		return EFI_INVALID_PARAMETER;
 	efiobj = efi_search_obj(handle);
@@ -624,6 +734,7 @@ static efi_status_t efi_remove_protocol(const efi_handle_t handle,
 	if (handler->protocol_interface != protocol_interface)
 		return EFI_NOT_FOUND;
 	list_del(&handler->link);
+	list_del(&handler->index_link);
 	free(handler);
 	return EFI_SUCCESS;
 }
@@ -1113,10 +1224,13 @@ struct efi_object *efi_search_obj(const efi_handle_t handle)
 	if (!handle)
 		return NULL;
 
-	list_for_each_entry(efiobj, &efi_obj_list, link) {
+	efi_lookup_stats.handle_lookups++;
+	hlist_for_each_entry(efiobj, efi_handle_hash_head(handle), hash_node) {
 		if (efiobj == handle)
 			return efiobj;
 	}
+	efi_lookup_stats.handle_misses++;
+
 	return NULL;
 }
 
@@ -1171,6 +1285,7 @@ efi_status_t efi_add_protocol(const efi_handle_t handle,
 	struct efi_handler *handler;
 	efi_status_t ret;
 	struct efi_register_notify_event *event;
+	struct efi_protocol_index *idx;
 
 	efiobj = efi_search_obj(handle);
 	if (!efiobj)
@@ -1178,13 +1293,18 @@ efi_status_t efi_add_protocol(const efi_handle_t handle,
 	ret = efi_search_protocol(handle, protocol, NULL);
 	if (ret != EFI_NOT_FOUND)
 		return EFI_INVALID_PARAMETER;
+	idx = efi_protocol_index_find(protocol, true);
+	if (!idx)
+		return EFI_OUT_OF_RESOURCES;
 	handler = calloc(1, sizeof(struct efi_handler));
 	if (!handler)
 		return EFI_OUT_OF_RESOURCES;
 	memcpy((void *)&handler->guid, protocol, sizeof(efi_guid_t));
+	handler->handle = efiobj;
 	handler->protocol_interface = protocol_interface;
 	INIT_LIST_HEAD(&handler->open_infos);
 	list_add_tail(&handler->link, &efiobj->protocols);
+	efi_protocol_index_add(idx, handler);
 
 	/* Notify registered events */
 	list_for_each_entry(event, &efi_register_notify_events, link) {
@@ -1194,6 +1314,7 @@ efi_status_t efi_add_protocol(const efi_handle_t handle,
 			notif = calloc(1, sizeof(*notif));
 			if (!notif) {
 				list_del(&handler->link);
+				list_del(&handler->index_link);
 				free(handler);
 				return EFI_OUT_OF_RESOURCES;
 			}
@@ -1506,34 +1627,6 @@ out:
 	return EFI_EXIT(ret);
 }
 
-/**
- * efi_search() - determine if an EFI handle implements a protocol
- *
- * @search_type: selection criterion
- * @protocol:    GUID of the protocol
- * @handle:      handle
- *
- * See the documentation of the LocateHandle service in the UEFI specification.
- *
- * Return: 0 if the handle implements the protocol
- */
-static int efi_search(enum efi_locate_search_type search_type,
-		      const efi_guid_t *protocol, efi_handle_t handle)
-{
-	efi_status_t ret;
-
-	switch (search_type) {
-	case ALL_HANDLES:
-		return 0;
-	case BY_PROTOCOL:
-		ret = efi_search_protocol(handle, protocol, NULL);
-		return (ret != EFI_SUCCESS);
-	default:
-		/* Invalid search type */
-		return -1;
-	}
-}
-
 /**
  * efi_check_register_notify_event() - check if registration key is valid
  *
@@ -1578,6 +1671,8 @@ static efi_status_t efi_locate_handle(
 	efi_uintn_t size = 0;
 	struct efi_register_notify_event *event;
 	struct efi_protocol_notification *handle = NULL;
+	struct efi_protocol_index *idx = NULL;
+	struct efi_handler *handler;
 
 	/* Check parameters */
 	switch (search_type) {
@@ -1609,10 +1704,15 @@ static efi_status_t efi_locate_handle(
 		efiobj = handle->handle;
 		size += sizeof(void *);
 	} else {
-		list_for_each_entry(efiobj, &efi_obj_list, link) {
-			if (!efi_search(search_type, protocol, efiobj))
-				size += sizeof(void *);
+		if (search_type == BY_PROTOCOL) {
+			efi_lookup_stats.locates++;
+			idx = efi_protocol_index_find(protocol, false);
+			if (idx)
+				size = list_count_nodes(&idx->handlers);
+		} else {
+			size = list_count_nodes(&efi_obj_list);
 		}
+		size *= sizeof(void *);
 		if (size == 0)
 			return EFI_NOT_FOUND;
 	}
@@ -1635,11 +1735,12 @@ static efi_status_t efi_locate_handle(
 	if (search_type == BY_REGISTER_NOTIFY) {
 		*buffer = efiobj;
 		list_del(&handle->link);
+	} else if (idx) {
+		list_for_each_entry(handler, &idx->handlers, index_link)
+			*buffer++ = handler->handle;
 	} else {
-		list_for_each_entry(efiobj, &efi_obj_list, link) {
-			if (!efi_search(search_type, protocol, efiobj))
-				*buffer++ = efiobj;
-		}
+		list_for_each_entry(efiobj, &efi_obj_list, link)
+			*buffer++ = efiobj;
 	}
 
 	return EFI_SUCCESS;
@@ -2655,10 +2756,15 @@ static efi_status_t EFIAPI efi_locate_protocol(const efi_guid_t *protocol,
 		if (ret == EFI_SUCCESS)
 			goto found;
 	} else {
-		list_for_each_entry(efiobj, &efi_obj_list, link) {
-			ret = efi_search_protocol(efiobj, protocol, &handler);
-			if (ret == EFI_SUCCESS)
-				goto found;
+		struct efi_protocol_index *idx;
+
+		efi_lookup_stats.locates++;
+		idx = efi_protocol_index_find(protocol, false);
+		if (idx && !list_empty(&idx->handlers)) {
+			handler = list_first_entry(&idx->handlers,
+						   struct efi_handler,
+						   index_link);
+			goto found;
 		}
 	}
 not_found:
@@ -636,6 +636,116 @@ int fdtdec_check_fdt(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/**
+ * struct fdt_phandle_cache - offsets of the nodes in an FDT, by phandle
+ *
+ * @blob: FDT which the offsets are for, or NULL if the cache must be set up
+ * @size_dt_struct: Size of the FDT's structure block when the cache was set
+ *	up, since this changes when most modifications are made
+ * @count: Number of entries in @offsets, one more than the highest phandle,
+ *	or 0 if the phandles could not be cached
+ * @offsets: Node offset for each phandle, or -1 if none
+ * @hits: Number of lookups answered by the cache
+ * @misses: Number of lookups which searched the FDT
+ */
+struct fdt_phandle_cache {
+	const void *blob;
+	int size_dt_struct;
+	uint count;
+	int *offsets;
+	uint hits;
+	uint misses;
+};
+
+static struct fdt_phandle_cache fdt_phandle_cache;
+
+static int fdt_phandle_cache_build(struct fdt_phandle_cache *cache,
+				   const void *blob)
+{
+	uint max = 0, count = 0;
+	u32 phandle;
+	int offset;
+
+	free(cache->offsets);
+	cache->offsets = NULL;
+	cache->count = 0;
+	cache->blob = blob;
+	cache->size_dt_struct = fdt_size_dt_struct(blob);
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle) {
+			max = max(max, phandle);
+			count++;
+		}
+	}
+
+	/* Phandles are normally allocated in order, but may not be */
+	if (max > 2 * count + 64)
+		return -E2BIG;
+	cache->offsets = malloc((max + 1) * sizeof(int));
+	if (!cache->offsets)
+		return -ENOMEM;
+	memset(cache->offsets, 0xff, (max + 1) * sizeof(int));
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle && cache->offsets[phandle] < 0)
+			cache->offsets[phandle] = offset;
+	}
+	cache->count = max + 1;
+
+	return 0;
+}
+
+void fdtdec_phandle_cache_get_stats(uint *hitsp, uint *missesp)
+{
+	*hitsp = fdt_phandle_cache.hits;
+	*missesp = fdt_phandle_cache.misses;
+}
+#endif
+
+int fdtdec_node_offset_by_phandle(const void *blob, u32 phandle)
+{
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+	struct fdt_phandle_cache *cache = &fdt_phandle_cache;
+	int offset;
+
+	/* Before relocation the heap is small and the cache cannot be kept */
+	if (blob != gd->fdt_blob || !(gd->flags & GD_FLG_RELOC) ||
+	    !phandle || phandle == (u32)-1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	if ((cache->blob != blob ||
+	     cache->size_dt_struct != fdt_size_dt_struct(blob)) &&
+	    fdt_phandle_cache_build(cache, blob))
+		log_debug("Cannot cache phandles\n");
+
+	/*
+	 * Offsets move when the FDT is modified, so check that the node still
+	 * has the phandle. Phandles are unique, so this is enough.
+	 */
+	if (phandle < cache->count) {
+		offset = cache->offsets[phandle];
+		if (offset >= 0 && fdt_get_phandle(blob, offset) == phandle) {
+			cache->hits++;
+			return offset;
+		}
+	}
+	cache->misses++;
+
+	/* If the phandle is there after all, the cache is out of date */
+	offset = fdt_node_offset_by_phandle(blob, phandle);
+	if (offset >= 0 && cache->count)
+		cache->blob = NULL;
+
+	return offset;
+#else
+	return fdt_node_offset_by_phandle(blob, phandle);
+#endif
+}
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -646,7 +756,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -777,8 +887,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (node < 0) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1499,7 +1609,7 @@ int fdtdec_get_carveout(const void *blob, const char *node,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = fdtdec_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
@@ -7,7 +7,9 @@
 #include <blk.h>
 #include <command.h>
 #include <console.h>
+#include <decomp.h>
 #include <div64.h>
+#include <errno.h>
 #include <gzip.h>
 #include <image.h>
 #include <malloc.h>
@@ -307,3 +309,66 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return err;
 }
+
+#if CONFIG_IS_ENABLED(DECOMP_STREAM)
+static int gzip_stream_run(struct decomp_stream *ds)
+{
+	z_stream *s = ds->priv;
+	uInt in, out;
+	int r;
+
+	in = min_t(size_t, ds->avail_in, UINT_MAX);
+	out = min_t(size_t, ds->avail_out, UINT_MAX);
+	s->next_in = (Bytef *)ds->next_in;
+	s->avail_in = in;
+	s->next_out = ds->next_out;
+	s->avail_out = out;
+	r = inflate(s, Z_NO_FLUSH);
+	decomp_stream_consume(ds, in - s->avail_in);
+	decomp_stream_produce(ds, out - s->avail_out);
+
+	switch (r) {
+	case Z_STREAM_END:
+		return 1;
+	case Z_OK:
+	case Z_BUF_ERROR:
+		return 0;
+	case Z_MEM_ERROR:
+		return -ENOMEM;
+	default:
+		return -EINVAL;
+	}
+}
+
+static void gzip_stream_end(struct decomp_stream *ds)
+{
+	inflateEnd(ds->priv);
+	free(ds->priv);
+}
+
+static const struct decomp_ops gzip_stream_ops = {
+	.run	= gzip_stream_run,
+	.end	= gzip_stream_end,
+};
+
+int gzip_stream_init(struct decomp_stream *ds)
+{
+	z_stream *s;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	s->zalloc = gzalloc;
+	s->zfree = gzfree;
+
+	/* Let zlib parse the gzip header and check the CRC and length */
+	if (inflateInit2(s, 16 + MAX_WBITS) != Z_OK) {
+		free(s);
+		return -ENOMEM;
+	}
+	ds->ops = &gzip_stream_ops;
+	ds->priv = s;
+
+	return 0;
+}
+#endif
@@ -49,83 +49,206 @@
 
 static void default_log(const char *ignored, char *response) {}
 
-static lbaint_t write_sparse_chunk_raw(struct sparse_storage *info,
-				       lbaint_t blk, lbaint_t blkcnt,
-				       void *data,
-				       char *response)
+/**
+ * struct sparse_out - blocks waiting to be written to the storage
+ *
+ * The data of adjacent RAW and FILL chunks is gathered in one buffer, so that
+ * the storage sees a few large writes rather than one or more per chunk.
+ *
+ * @info: Storage to write to
+ * @response: Response for errors, passed to @info->mssg
+ * @buf: Buffer for @buf_blks blocks, aligned for DMA
+ * @buf_blks: Size of @buf in blocks
+ * @blk: Block where the data in @buf is to be written
+ * @count: Number of blocks in @buf
+ * @fill_blks: Number of blocks at the start of @buf which hold @fill_val, so
+ *	a later fill with the same value need not set them again
+ * @fill_val: Value in the first @fill_blks blocks of @buf
+ */
+struct sparse_out {
+	struct sparse_storage *info;
+	char *response;
+	void *buf;
+	lbaint_t buf_blks;
+	lbaint_t blk;
+	lbaint_t count;
+	lbaint_t fill_blks;
+	u32 fill_val;
+};
+
+/* Write @blkcnt blocks at the current position, returning 0 if OK */
+static int sparse_write(struct sparse_out *out, lbaint_t blkcnt,
+			const void *data)
+{
+	struct sparse_storage *info = out->info;
+	lbaint_t write_blks;
+
+	/* write_blks might be > blkcnt due to NAND bad-blocks */
+	write_blks = info->write(info, out->blk, blkcnt, data);
+	if (IS_ERR_VALUE(write_blks)) {
+		printf("%s: Write failed, block #" LBAFU " [" LBAFU "] (%lld)\n",
+		       __func__, out->blk, blkcnt, (long long)write_blks);
+		info->mssg("flash write failure", out->response);
+		return -1;
+	} else if (write_blks < blkcnt) {
+		printf("%s: Write failed, block #" LBAFU " [" LBAFU "]\n",
+		       __func__, out->blk, blkcnt);
+		info->mssg("flash write failure(incomplete)", out->response);
+		return -1;
+	}
+	out->blk += write_blks;
+
+	return 0;
+}
+
+static int sparse_flush(struct sparse_out *out)
 {
-	lbaint_t n = blkcnt, write_blks, blks = 0;
-	lbaint_t aligned_buf_blks = FASTBOOT_MAX_BLK_WRITE;
-	uint32_t *aligned_buf = NULL;
+	int ret;
 
-	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF)) {
-		write_blks = info->write(info, blk, n, data);
-		if (write_blks < n)
-			goto write_fail;
+	if (!out->count)
+		return 0;
+	ret = sparse_write(out, out->count, out->buf);
+	out->count = 0;
 
-		return write_blks;
+	return ret;
+}
+
+/* Note that the blocks from @start on no longer hold the fill value */
+static void sparse_buf_used(struct sparse_out *out, lbaint_t start)
+{
+	if (out->fill_blks > start)
+		out->fill_blks = start;
+}
+
+static int sparse_raw(struct sparse_out *out, const void *data,
+		      lbaint_t blkcnt)
+{
+	lbaint_t blksz = out->info->blksz;
+	lbaint_t n;
+
+	/* Large aligned chunks are written from where they are */
+	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF) ||
+	    (IS_ALIGNED((ulong)data, ARCH_DMA_MINALIGN) &&
+	     blkcnt >= out->buf_blks)) {
+		if (sparse_flush(out))
+			return -1;
+		return sparse_write(out, blkcnt, data);
 	}
 
-	aligned_buf = memalign(ARCH_DMA_MINALIGN, info->blksz * aligned_buf_blks);
-	if (!aligned_buf) {
-		info->mssg("Malloc failed for: CHUNK_TYPE_RAW", response);
-		return -ENOMEM;
+	while (blkcnt) {
+		n = min(blkcnt, out->buf_blks - out->count);
+		sparse_buf_used(out, out->count);
+		memcpy(out->buf + out->count * blksz, data, n * blksz);
+		out->count += n;
+		data += n * blksz;
+		blkcnt -= n;
+		if (out->count == out->buf_blks && sparse_flush(out))
+			return -1;
 	}
 
-	while (blkcnt > 0) {
-		n = min(aligned_buf_blks, blkcnt);
-		memcpy(aligned_buf, data, n * info->blksz);
+	return 0;
+}
 
-		/* write_blks might be > n due to NAND bad-blocks */
-		write_blks = info->write(info, blk + blks, n, aligned_buf);
-		if (write_blks < n) {
-			free(aligned_buf);
-			goto write_fail;
+static int sparse_fill(struct sparse_out *out, u32 fill_val, lbaint_t blkcnt)
+{
+	lbaint_t blksz = out->info->blksz;
+	lbaint_t n, i;
+	u32 *ptr;
+
+	while (blkcnt) {
+		n = min(blkcnt, out->buf_blks - out->count);
+		if (fill_val != out->fill_val ||
+		    out->count + n > out->fill_blks) {
+			ptr = out->buf + out->count * blksz;
+			for (i = 0; i < n * blksz / sizeof(u32); i++)
+				ptr[i] = fill_val;
+			if (fill_val == out->fill_val &&
+			    out->count <= out->fill_blks) {
+				out->fill_blks = out->count + n;
+			} else if (!out->count) {
+				out->fill_val = fill_val;
+				out->fill_blks = n;
+			} else {
+				sparse_buf_used(out, out->count);
+			}
 		}
-
-		blks += write_blks;
-		data += n * info->blksz;
+		out->count += n;
 		blkcnt -= n;
+		if (out->count == out->buf_blks && sparse_flush(out))
+			return -1;
 	}
 
-	free(aligned_buf);
-	return blks;
+	return 0;
+}
 
-write_fail:
-	if (IS_ERR_VALUE(write_blks)) {
-		printf("%s: Write failed, block #" LBAFU " [" LBAFU "] (%lld)\n",
-		       __func__, blk + blks, n, (long long)write_blks);
-		info->mssg("flash write failure", response);
-		return write_blks;
+/**
+ * sparse_erase() - erase the whole erase groups within some blocks
+ *
+ * @out: Output state
+ * @blkcnt: Number of blocks following those waiting in the buffer
+ * @zero: true to fill the blocks around the erase groups with zeroes; if
+ *	false they are left alone and nothing may be waiting in the buffer
+ * Return: 0 if OK, -1 on error
+ */
+static int sparse_erase(struct sparse_out *out, lbaint_t blkcnt, bool zero)
+{
+	struct sparse_storage *info = out->info;
+	u32 grp = info->erase_grp;
+	lbaint_t head, mid, erased;
+	u64 pos, n;
+
+	/* eMMC erase groups need not be a power of two */
+	pos = out->blk + out->count;
+	head = do_div(pos, grp);
+	if (head)
+		head = grp - head;
+	if (head >= blkcnt)
+		head = blkcnt;
+	n = blkcnt - head;
+	mid = blkcnt - head - do_div(n, grp);
+	if (zero) {
+		if (sparse_fill(out, 0, head) || sparse_flush(out))
+			return -1;
+	} else {
+		out->blk += head;
 	}
 
-	/* write_blks < n */
-	printf("%s: Write failed, block #" LBAFU " [" LBAFU "]\n",
-	       __func__, blk + blks, n);
-	info->mssg("flash write failure(incomplete)", response);
-	return -1;
+	if (mid) {
+		erased = info->erase(info, out->blk, mid);
+		if (IS_ERR_VALUE(erased) || erased < mid) {
+			printf("%s: Erase failed, block #" LBAFU " [" LBAFU "]\n",
+			       __func__, out->blk, mid);
+			info->mssg("flash erase failure", out->response);
+			return -1;
+		}
+		out->blk += mid;
+	}
+
+	if (zero)
+		return sparse_fill(out, 0, blkcnt - head - mid);
+	out->blk += blkcnt - head - mid;
+
+	return 0;
 }
 
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
-	lbaint_t blk;
+	struct sparse_out out = {
+		.info = info,
+		.response = response,
+		.buf_blks = FASTBOOT_MAX_BLK_WRITE,
+	};
 	lbaint_t blkcnt;
-	lbaint_t blks;
 	uint64_t bytes_written = 0;
 	unsigned int chunk;
 	unsigned int offset;
 	uint64_t chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	int ret = -1;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -164,10 +287,16 @@ int write_sparse_image(struct sparse_storage *info,
 		return -1;
 	}
 
+	out.buf = memalign(ARCH_DMA_MINALIGN, info->blksz * out.buf_blks);
+	if (!out.buf) {
+		info->mssg("Malloc failed for sparse image buffer", response);
+		return -1;
+	}
+
 	puts("Flashing Sparse Image\n");
 
 	/* Start processing chunks */
-	blk = info->start;
+	out.blk = info->start;
 	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
 		/* Read and skip over chunk header */
 		chunk_header = (chunk_header_t *)data;
@@ -197,24 +326,22 @@ int write_sparse_image(struct sparse_storage *info,
 			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
 				info->mssg("Bogus chunk size for chunk type Raw",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			if (blk + blkcnt > info->start + info->size) {
+			if (out.blk + out.count + blkcnt >
+			    info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			blks = write_sparse_chunk_raw(info, blk, blkcnt,
-						      data, response);
-			if (IS_ERR_VALUE(blks))
-				return -1;
+			if (sparse_raw(&out, data, blkcnt))
+				goto out;
 
-			blk += blks;
 			bytes_written += ((u64)blkcnt) * info->blksz;
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -224,65 +351,46 @@ int write_sparse_image(struct sparse_storage *info,
 			if (chunk_header->total_sz !=
 			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
 				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
+				goto out;
 			}
 
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
+			if (out.blk + out.count + blkcnt >
+			    info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
+			/* Zeroes may be written by erasing, if that is faster */
+			if (!fill_val && info->erase && info->erase_zero &&
+			    blkcnt >= info->erase_grp) {
+				if (sparse_erase(&out, blkcnt, true))
+					goto out;
+			} else if (sparse_fill(&out, fill_val, blkcnt)) {
+				goto out;
 			}
 			bytes_written += ((u64)blkcnt) * info->blksz;
 			total_blocks += DIV_ROUND_UP_ULL(chunk_data_sz,
 							 sparse_header->blk_sz);
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
+			if (sparse_flush(&out))
+				goto out;
+			if (IS_ENABLED(CONFIG_IMAGE_SPARSE_DISCARD) &&
+			    info->erase && out.blk + blkcnt <=
+			    info->start + info->size) {
+				if (sparse_erase(&out, blkcnt, false))
+					goto out;
+			} else {
+				out.blk += info->reserve(info, out.blk, blkcnt);
+			}
 			total_blocks += chunk_header->chunk_sz;
 			break;
 
@@ -291,7 +399,7 @@ int write_sparse_image(struct sparse_storage *info,
 			    sparse_header->chunk_hdr_sz + sizeof(uint32_t)) {
 				info->mssg("Bogus chunk size for chunk type CRC32",
 					   response);
-				return -1;
+				goto out;
 			}
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -301,9 +409,11 @@ int write_sparse_image(struct sparse_storage *info,
 			printf("%s: Unknown chunk type: %x\n", __func__,
 			       chunk_header->chunk_type);
 			info->mssg("Unknown chunk type", response);
-			return -1;
+			goto out;
 		}
 	}
+	if (sparse_flush(&out))
+		goto out;
 
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
@@ -311,8 +421,11 @@ int write_sparse_image(struct sparse_storage *info,
 
 	if (total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
-		return -1;
+		goto out;
 	}
+	ret = 0;
+out:
+	free(out.buf);
 
-	return 0;
+	return ret;
 }
@@ -4,7 +4,11 @@
  */
 
 #include <compiler.h>
+#include <decomp.h>
+#include <errno.h>
 #include <image.h>
+#include <malloc.h>
+#include <worker.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 #include <asm/unaligned.h>
@@ -15,6 +19,187 @@
 
 #define LZ4F_BLOCKUNCOMPRESSED_FLAG 0x80000000U
 
+/**
+ * ulz4fn_header() - parse the header of an LZ4 frame
+ *
+ * @src: Start of the frame
+ * @srcn: Length of source data
+ * @has_block_checksum: Returns whether each block is followed by a checksum
+ * @block_max: Returns the maximum size of a block, if not NULL
+ * Return: length of the header, or -ve error as for ulz4fn()
+ */
+static int ulz4fn_header(const void *src, size_t srcn, int *has_block_checksum,
+			 u32 *block_max)
+{
+	const void *in = src;
+	u32 magic;
+	u8 flags, version, independent_blocks, has_content_size;
+	u8 block_desc;
+
+	if (srcn < sizeof(u32) + 3*sizeof(u8))
+		return -EINVAL;	/* input overrun */
+
+	magic = get_unaligned_le32(in);
+	in += sizeof(u32);
+	flags = *(u8 *)in;
+	in += sizeof(u8);
+	block_desc = *(u8 *)in;
+	in += sizeof(u8);
+
+	version = (flags >> 6) & 0x3;
+	independent_blocks = (flags >> 5) & 0x1;
+	*has_block_checksum = (flags >> 4) & 0x1;
+	has_content_size = (flags >> 3) & 0x1;
+
+	/* We assume there's always only a single, standard frame. */
+	if (magic != LZ4F_MAGIC || version != 1)
+		return -EPROTONOSUPPORT;	/* unknown format */
+	if ((flags & 0x03) || (block_desc & 0x8f))
+		return -EINVAL;	/* reserved bits must be zero */
+	if (!independent_blocks)
+		return -EPROTONOSUPPORT; /* we can't support this yet */
+
+	if (has_content_size) {
+		if (srcn < sizeof(u32) + 3*sizeof(u8) + sizeof(u64))
+			return -EINVAL;	/* input overrun */
+		in += sizeof(u64);
+	}
+	/* Header checksum byte */
+	in += sizeof(u8);
+
+	if (block_max)
+		*block_max = 1 << (8 + 2 * (block_desc >> 4));
+
+	return in - src;
+}
+
+#if CONFIG_IS_ENABLED(DECOMP_PARALLEL)
+/**
+ * struct ulz4fn_block - a block being decompressed by a boot-time worker
+ *
+ * @in: Block data
+ * @block_header: Block header
+ * @out: Where to write the uncompressed data
+ * @size: Space at @out
+ * @ret: Returns the uncompressed size, or -ve on error
+ */
+struct ulz4fn_block {
+	const void *in;
+	u32 block_header;
+	void *out;
+	int size;
+	int ret;
+};
+
+static void ulz4fn_block_job(void *arg)
+{
+	struct ulz4fn_block *blk = arg;
+	u32 block_size = blk->block_header & ~LZ4F_BLOCKUNCOMPRESSED_FLAG;
+
+	if (blk->block_header & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+		blk->ret = block_size <= blk->size ? block_size : -ENOBUFS;
+		if (blk->ret > 0)
+			memcpy(blk->out, blk->in, block_size);
+	} else {
+		/* constant folding essential, do not touch params! */
+		blk->ret = LZ4_decompress_generic(blk->in, blk->out, block_size,
+						  blk->size, endOnInputSize,
+						  decode_full_block, noDict,
+						  blk->out, NULL, 0);
+	}
+}
+
+/**
+ * ulz4fn_parallel() - decompress the blocks of a frame at the same time
+ *
+ * Every block but the last is expected to fill a whole block, so the output
+ * offset of each block is known in advance. If that turns out to be wrong,
+ * or the data is corrupt, the caller goes back to decompressing the blocks
+ * one by one, which also reports any error.
+ *
+ * Return: 0 if OK, -EAGAIN if the caller must decompress the frame itself
+ */
+static int ulz4fn_parallel(const void *src, size_t srcn, void *dst,
+			   size_t *dstn)
+{
+	const void *end = dst + *dstn;
+	struct ulz4fn_block *blks;
+	struct worker_job *jobs;
+	int has_block_checksum;
+	const void *in;
+	int i, count, ret;
+	u32 block_max;
+
+	/* Blocks must not overwrite input which is still to be read */
+	if (dst < src + srcn && src < end)
+		return -EAGAIN;
+
+	ret = ulz4fn_header(src, srcn, &has_block_checksum, &block_max);
+	if (ret < 0)
+		return -EAGAIN;
+
+	for (count = 0, in = src + ret; ; count++) {
+		u32 block_size;
+
+		if (in - src + sizeof(u32) > srcn)
+			return -EAGAIN;
+		block_size = get_unaligned_le32(in) &
+			~LZ4F_BLOCKUNCOMPRESSED_FLAG;
+		if (!block_size)
+			break;
+		in += sizeof(u32) + block_size;
+		if (has_block_checksum)
+			in += sizeof(u32);
+		if (in - src > srcn)
+			return -EAGAIN;
+	}
+	if (count < 2 || (size_t)(count - 1) * block_max >= *dstn)
+		return -EAGAIN;
+
+	blks = calloc(count, sizeof(*blks));
+	jobs = calloc(count, sizeof(*jobs));
+	if (!blks || !jobs) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	for (i = 0, in = src + ret; i < count; i++) {
+		blks[i].block_header = get_unaligned_le32(in);
+		blks[i].in = in + sizeof(u32);
+		blks[i].out = dst + (size_t)i * block_max;
+		blks[i].size = min((size_t)block_max,
+				   (size_t)(end - blks[i].out));
+		jobs[i].func = ulz4fn_block_job;
+		jobs[i].arg = &blks[i];
+		in = blks[i].in + (blks[i].block_header &
+				   ~LZ4F_BLOCKUNCOMPRESSED_FLAG);
+		if (has_block_checksum)
+			in += sizeof(u32);
+	}
+	worker_run(jobs, count);
+
+	ret = -EAGAIN;
+	for (i = 0; i < count; i++) {
+		if (blks[i].ret < 0 ||
+		    (i < count - 1 && blks[i].ret != block_max))
+			goto out;
+	}
+	*dstn = (size_t)(count - 1) * block_max + blks[count - 1].ret;
+	ret = 0;
+out:
+	free(blks);
+	free(jobs);
+
+	return ret;
+}
+#else
+static int ulz4fn_parallel(const void *src, size_t srcn, void *dst,
+			   size_t *dstn)
+{
+	return -EAGAIN;
+}
+#endif
+
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
 	const void *end = dst + *dstn;
@@ -22,44 +207,18 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	void *out = dst;
 	int has_block_checksum;
 	int ret;
-	*dstn = 0;
 
-	{ /* With in-place decompression the header may become invalid later. */
-		u32 magic;
-		u8 flags, version, independent_blocks, has_content_size;
-		u8 block_desc;
-
-		if (srcn < sizeof(u32) + 3*sizeof(u8))
-			return -EINVAL;	/* input overrun */
-
-		magic = get_unaligned_le32(in);
-		in += sizeof(u32);
-		flags = *(u8 *)in;
-		in += sizeof(u8);
-		block_desc = *(u8 *)in;
-		in += sizeof(u8);
-
-		version = (flags >> 6) & 0x3;
-		independent_blocks = (flags >> 5) & 0x1;
-		has_block_checksum = (flags >> 4) & 0x1;
-		has_content_size = (flags >> 3) & 0x1;
-
-		/* We assume there's always only a single, standard frame. */
-		if (magic != LZ4F_MAGIC || version != 1)
-			return -EPROTONOSUPPORT;	/* unknown format */
-		if ((flags & 0x03) || (block_desc & 0x8f))
-			return -EINVAL;	/* reserved bits must be zero */
-		if (!independent_blocks)
-			return -EPROTONOSUPPORT; /* we can't support this yet */
-
-		if (has_content_size) {
-			if (srcn < sizeof(u32) + 3*sizeof(u8) + sizeof(u64))
-				return -EINVAL;	/* input overrun */
-			in += sizeof(u64);
-		}
-		/* Header checksum byte */
-		in += sizeof(u8);
+	if (CONFIG_IS_ENABLED(DECOMP_PARALLEL)) {
+		ret = ulz4fn_parallel(src, srcn, dst, dstn);
+		if (ret != -EAGAIN)
+			return ret;
 	}
+	*dstn = 0;
+
+	ret = ulz4fn_header(src, srcn, &has_block_checksum, NULL);
+	if (ret < 0)
+		return ret;
+	in += ret;
 
 	while (1) {
 		u32 block_header, block_size;
@@ -106,3 +265,246 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+#if CONFIG_IS_ENABLED(DECOMP_STREAM)
+enum lz4_stream_state {
+	LZ4S_FRAME,		/* reading the frame header */
+	LZ4S_SKIP,		/* skipping bytes, then going to @next */
+	LZ4S_BLOCK_HDR,		/* reading a block header */
+	LZ4S_RAW,		/* copying an uncompressed block */
+	LZ4S_BLOCK,		/* reading a compressed block */
+	LZ4S_DRAIN,		/* writing out a decompressed block */
+	LZ4S_DONE,
+};
+
+/**
+ * struct lz4_stream - state of an LZ4 frame being decompressed
+ *
+ * @state: Current state
+ * @next: State to go to after skipping
+ * @hdr: Frame or block header being read
+ * @have: Number of bytes collected in @hdr or @in_buf
+ * @skip: Number of bytes left to skip
+ * @block_max: Maximum size of a block, from the frame header
+ * @block_size: Size of the current block, or what is left of it for LZ4S_RAW
+ * @block_checksum: true if each block is followed by a checksum
+ * @content_checksum: true if the frame ends with a checksum
+ * @in_buf: Buffer for a compressed block split across input pieces
+ * @out_buf: Buffer for a decompressed block when the output window is small
+ * @out_pos: Position of the next byte to write out of @out_buf
+ * @out_len: Number of bytes in @out_buf
+ */
+struct lz4_stream {
+	enum lz4_stream_state state;
+	enum lz4_stream_state next;
+	u8 hdr[6];
+	size_t have;
+	size_t skip;
+	u32 block_max;
+	u32 block_size;
+	bool block_checksum;
+	bool content_checksum;
+	u8 *in_buf;
+	u8 *out_buf;
+	u32 out_pos;
+	u32 out_len;
+};
+
+/* Collect @len bytes in @buf; returns true when they are all there */
+static bool lz4_stream_gather(struct decomp_stream *ds, struct lz4_stream *ls,
+			      u8 *buf, size_t len)
+{
+	size_t n = min(len - ls->have, ds->avail_in);
+
+	memcpy(buf + ls->have, ds->next_in, n);
+	decomp_stream_consume(ds, n);
+	ls->have += n;
+	if (ls->have < len)
+		return false;
+	ls->have = 0;
+
+	return true;
+}
+
+static void lz4_stream_skip(struct lz4_stream *ls, size_t len,
+			    enum lz4_stream_state next)
+{
+	ls->skip = len;
+	ls->next = next;
+	ls->state = LZ4S_SKIP;
+}
+
+static int lz4_stream_frame(struct lz4_stream *ls)
+{
+	u8 flags = ls->hdr[4], block_desc = ls->hdr[5];
+
+	if (get_unaligned_le32(ls->hdr) != LZ4F_MAGIC ||
+	    (flags >> 6) != 1)
+		return -EPROTONOSUPPORT;
+	if ((flags & 0x03) || (block_desc & 0x8f) || block_desc < 0x40)
+		return -EINVAL;
+	if (!(flags & 0x20))
+		return -EPROTONOSUPPORT;	/* dependent blocks */
+
+	ls->block_checksum = flags & 0x10;
+	ls->content_checksum = flags & 0x04;
+	ls->block_max = 1 << (8 + 2 * (block_desc >> 4));
+
+	/* Skip the content size, if present, and the header checksum */
+	lz4_stream_skip(ls, (flags & 0x08 ? sizeof(u64) : 0) + 1,
+			LZ4S_BLOCK_HDR);
+
+	return 0;
+}
+
+static int lz4_stream_block(struct decomp_stream *ds, struct lz4_stream *ls)
+{
+	const u8 *src;
+	u8 *dst;
+	int ret;
+
+	/* Use the input and output in place when possible */
+	if (!ls->have && ds->avail_in >= ls->block_size) {
+		src = ds->next_in;
+		decomp_stream_consume(ds, ls->block_size);
+	} else {
+		if (!ls->in_buf) {
+			ls->in_buf = malloc(ls->block_max);
+			if (!ls->in_buf)
+				return -ENOMEM;
+		}
+		if (!lz4_stream_gather(ds, ls, ls->in_buf, ls->block_size))
+			return 0;
+		src = ls->in_buf;
+	}
+
+	if (ds->avail_out >= ls->block_max) {
+		dst = ds->next_out;
+	} else {
+		if (!ls->out_buf) {
+			ls->out_buf = malloc(ls->block_max);
+			if (!ls->out_buf)
+				return -ENOMEM;
+		}
+		dst = ls->out_buf;
+	}
+
+	ret = LZ4_decompress_generic(src, dst, ls->block_size, ls->block_max,
+				     endOnInputSize, decode_full_block, noDict,
+				     dst, NULL, 0);
+	if (ret < 0)
+		return -EPROTO;
+
+	if (dst == ds->next_out) {
+		decomp_stream_produce(ds, ret);
+		lz4_stream_skip(ls, ls->block_checksum ? sizeof(u32) : 0,
+				LZ4S_BLOCK_HDR);
+	} else {
+		ls->out_pos = 0;
+		ls->out_len = ret;
+		ls->state = LZ4S_DRAIN;
+	}
+
+	return 1;
+}
+
+static int lz4_stream_run(struct decomp_stream *ds)
+{
+	struct lz4_stream *ls = ds->priv;
+	size_t n;
+	u32 hdr;
+	int ret;
+
+	while (1) {
+		switch (ls->state) {
+		case LZ4S_FRAME:
+			if (!lz4_stream_gather(ds, ls, ls->hdr, 6))
+				return 0;
+			ret = lz4_stream_frame(ls);
+			if (ret)
+				return ret;
+			break;
+		case LZ4S_SKIP:
+			n = min(ls->skip, ds->avail_in);
+			decomp_stream_consume(ds, n);
+			ls->skip -= n;
+			if (ls->skip)
+				return 0;
+			ls->state = ls->next;
+			break;
+		case LZ4S_BLOCK_HDR:
+			if (!lz4_stream_gather(ds, ls, ls->hdr, sizeof(u32)))
+				return 0;
+			hdr = get_unaligned_le32(ls->hdr);
+			ls->block_size = hdr & ~LZ4F_BLOCKUNCOMPRESSED_FLAG;
+			if (!ls->block_size)
+				lz4_stream_skip(ls, ls->content_checksum ?
+						sizeof(u32) : 0, LZ4S_DONE);
+			else if (ls->block_size > ls->block_max)
+				return -EINVAL;
+			else if (hdr & LZ4F_BLOCKUNCOMPRESSED_FLAG)
+				ls->state = LZ4S_RAW;
+			else
+				ls->state = LZ4S_BLOCK;
+			break;
+		case LZ4S_RAW:
+			n = min3((size_t)ls->block_size, ds->avail_in,
+				 ds->avail_out);
+			memcpy(ds->next_out, ds->next_in, n);
+			decomp_stream_consume(ds, n);
+			decomp_stream_produce(ds, n);
+			ls->block_size -= n;
+			if (ls->block_size)
+				return 0;
+			lz4_stream_skip(ls, ls->block_checksum ? sizeof(u32) : 0,
+					LZ4S_BLOCK_HDR);
+			break;
+		case LZ4S_BLOCK:
+			ret = lz4_stream_block(ds, ls);
+			if (ret <= 0)
+				return ret;
+			break;
+		case LZ4S_DRAIN:
+			n = min((size_t)(ls->out_len - ls->out_pos),
+				ds->avail_out);
+			memcpy(ds->next_out, ls->out_buf + ls->out_pos, n);
+			decomp_stream_produce(ds, n);
+			ls->out_pos += n;
+			if (ls->out_pos < ls->out_len)
+				return 0;
+			lz4_stream_skip(ls, ls->block_checksum ? sizeof(u32) : 0,
+					LZ4S_BLOCK_HDR);
+			break;
+		case LZ4S_DONE:
+			return 1;
+		}
+	}
+}
+
+static void lz4_stream_end(struct decomp_stream *ds)
+{
+	struct lz4_stream *ls = ds->priv;
+
+	free(ls->in_buf);
+	free(ls->out_buf);
+	free(ls);
+}
+
+static const struct decomp_ops lz4_stream_ops = {
+	.run	= lz4_stream_run,
+	.end	= lz4_stream_end,
+};
+
+int lz4_stream_init(struct decomp_stream *ds)
+{
+	struct lz4_stream *ls;
+
+	ls = calloc(1, sizeof(*ls));
+	if (!ls)
+		return -ENOMEM;
+	ds->ops = &lz4_stream_ops;
+	ds->priv = ls;
+
+	return 0;
+}
+#endif
@@ -312,6 +312,13 @@ int unflatten_device_tree(const void *blob, struct device_node **mynodes)
 		      be32_to_cpup(mem + size));
 		return -ENOSPC;
 	}
+	if (CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)) {
+		int ret;
+
+		ret = of_phandle_cache_build(*mynodes);
+		if (ret)
+			return ret;
+	}
 
 	debug(" <- unflatten_device_tree()\n");
 
@@ -340,6 +347,8 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 
 void of_live_free(struct device_node *root)
 {
+	if (CONFIG_IS_ENABLED(OF_PHANDLE_CACHE))
+		of_phandle_cache_free(root);
 	/* the tree is stored as a contiguous block of memory */
 	free(root);
 }
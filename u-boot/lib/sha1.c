@@ -218,18 +218,21 @@ static void __maybe_unused sha1_process_one(sha1_context *ctx, const unsigned ch
 	ctx->state[4] += E;
 }
 
-__weak void sha1_process(sha1_context *ctx, const unsigned char *data,
-			 unsigned int blocks)
+void sha1_process_sw(sha1_context *ctx, const unsigned char *data,
+		     unsigned int blocks)
 {
-	if (!blocks)
-		return;
-
 	while (blocks--) {
 		sha1_process_one(ctx, data);
 		data += 64;
 	}
 }
 
+__weak void sha1_process(sha1_context *ctx, const unsigned char *data,
+			 unsigned int blocks)
+{
+	sha1_process_sw(ctx, data, blocks);
+}
+
 /*
  * SHA-1 process buffer
  */
@@ -12,6 +12,62 @@
 
 #ifndef ASMINF
 
+/*
+ * U-Boot: copy a match of len bytes from dist bytes back in the output, which
+ * it may overlap. This copies eight or sixteen bytes at a time, finishing with
+ * an eight-byte copy which ends exactly at the end of the match, so nothing is
+ * written beyond it. A short distance is first repeated until it is at least
+ * eight bytes, since a pattern also recurs at any multiple of its distance.
+ */
+local unsigned char FAR *inffast_copy(unsigned char FAR *out, unsigned dist,
+                                      unsigned len)
+{
+    unsigned char FAR *end = out + len;
+    unsigned char FAR *from;
+    unsigned step;
+
+    if (dist == 1) {
+        memset(out, out[-1], len);
+        return end;
+    }
+    if (dist < 8) {
+        step = (8 + dist - 1) / dist * dist;
+        from = out - dist;
+        for (len = step - dist; len && out < end; len--)
+            *out++ = *from++;
+        dist = step;
+        len = end - out;
+    }
+    if (len < 8) {
+        from = out - dist;
+        while (out < end)
+            *out++ = *from++;
+        return end;
+    }
+
+    from = out - dist;
+    if (dist >= 16) {
+        while (len >= 16) {
+            put_unaligned(get_unaligned((u64 *)from), (u64 *)out);
+            put_unaligned(get_unaligned((u64 *)(from + 8)), (u64 *)(out + 8));
+            from += 16;
+            out += 16;
+            len -= 16;
+        }
+    }
+    while (len >= 8) {
+        put_unaligned(get_unaligned((u64 *)from), (u64 *)out);
+        from += 8;
+        out += 8;
+        len -= 8;
+    }
+    if (len)
+        put_unaligned(get_unaligned((u64 *)(end - dist - 8)),
+                      (u64 *)(end - 8));
+
+    return end;
+}
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -23,7 +79,7 @@
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
+        strm->avail_in >= INFLATE_FAST_MIN_IN
         strm->avail_out >= 258
         start >= strm->avail_out
         state->bits < 8
@@ -39,8 +95,9 @@
     - The maximum input bits used by a length/distance pair is 15 bits for the
       length code, 5 bits for the length extra, 15 bits for the distance code,
       and 13 bits for the distance extra.  This totals 48 bits, or six bytes.
-      Therefore if strm->avail_in >= 6, then there is enough input to avoid
-      checking for available input while decoding.
+      U-Boot: the bit buffer is refilled to at least 56 bits at the start of
+      each loop by reading eight bytes at once, so strm->avail_in >= 8 is
+      needed to avoid checking for available input while decoding.
 
     - The maximum bytes that a single length/distance pair can output is 258
       bytes, which is the maximum length that can be coded.  inflate_fast()
@@ -64,7 +121,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     unsigned whave;             /* valid bytes in the window */
     unsigned wnext;             /* window write index */
     unsigned char FAR *window;  /* allocated sliding window, if wsize != 0 */
-    unsigned long hold;         /* local strm->hold */
+    u64 hold;                   /* local strm->hold */
     unsigned bits;              /* local strm->bits */
     code const FAR *lcode;      /* local strm->lencode */
     code const FAR *dcode;      /* local strm->distcode */
@@ -80,14 +137,14 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in;
-    last = in + (strm->avail_in - 5);
-    if (in > last && strm->avail_in > 5) {
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_IN - 1));
+    if (in > last && strm->avail_in > INFLATE_FAST_MIN_IN - 1) {
         /*
          * overflow detected, limit strm->avail_in to the
          * max. possible size and recalculate last
          */
 	strm->avail_in = 0xffffffff - (uintptr_t)in;
-        last = in + (strm->avail_in - 5);
+        last = in + (strm->avail_in - (INFLATE_FAST_MIN_IN - 1));
     }
     out = strm->next_out;
     beg = out - (start - strm->avail_out);
@@ -109,12 +166,13 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
-        if (bits < 15) {
-            hold += (unsigned long)(*in++) << bits;
-            bits += 8;
-            hold += (unsigned long)(*in++) << bits;
-            bits += 8;
-        }
+        /*
+         * Refill without branching: bits above the count may hold part of
+         * the next byte, which is ORed in again unchanged next time
+         */
+        hold |= get_unaligned_le64(in) << bits;
+        in += (63 - bits) >> 3;
+        bits |= 56;
         here = lcode[hold & lmask];
       dolen:
         op = (unsigned)(here.bits);
@@ -131,21 +189,11 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
             len = (unsigned)(here.val);
             op &= 15;                           /* number of extra bits */
             if (op) {
-                if (bits < op) {
-                    hold += (unsigned long)(*in++) << bits;
-                    bits += 8;
-                }
                 len += (unsigned)hold & ((1U << op) - 1);
                 hold >>= op;
                 bits -= op;
             }
             Tracevv((stderr, "inflate:         length %u\n", len));
-            if (bits < 15) {
-                hold += (unsigned long)(*in++) << bits;
-                bits += 8;
-                hold += (unsigned long)(*in++) << bits;
-                bits += 8;
-            }
             here = dcode[hold & dmask];
           dodist:
             op = (unsigned)(here.bits);
@@ -155,14 +203,6 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
             if (op & 16) {                      /* distance base */
                 dist = (unsigned)(here.val);
                 op &= 15;                       /* number of extra bits */
-                if (bits < op) {
-                    hold += (unsigned long)(*in++) << bits;
-                    bits += 8;
-                    if (bits < op) {
-                        hold += (unsigned long)(*in++) << bits;
-                        bits += 8;
-                    }
-                }
                 dist += (unsigned)hold & ((1U << op) - 1);
 #ifdef INFLATE_STRICT
                 if (dist > dmax) {
@@ -236,47 +276,7 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                     }
                 }
                 else {
-		    unsigned short *sout;
-		    unsigned long loops;
-
-                    from = out - dist;          /* copy direct from output */
-                    /* minimum length is three */
-		    /* Align out addr */
-		    if (!((long)(out - 1) & 1)) {
-			*out++ = *from++;
-			len--;
-		    }
-		    sout = (unsigned short *)out;
-		    if (dist > 2 ) {
-			unsigned short *sfrom;
-
-			sfrom = (unsigned short *)from;
-			loops = len >> 1;
-			do
-			    *sout++ = get_unaligned(sfrom++);
-			while (--loops);
-			out = (unsigned char *)sout;
-			from = (unsigned char *)sfrom;
-		    } else { /* dist == 1 or dist == 2 */
-			unsigned short pat16;
-
-			pat16 = *(sout - 1);
-			if (dist == 1)
-#if defined(__BIG_ENDIAN)
-			    pat16 = (pat16 & 0xff) | ((pat16 & 0xff ) << 8);
-#elif defined(__LITTLE_ENDIAN)
-			    pat16 = (pat16 & 0xff00) | ((pat16 & 0xff00 ) >> 8);
-#else
-#error __BIG_ENDIAN nor __LITTLE_ENDIAN is defined
-#endif
-			loops = len >> 1;
-			do
-			    *sout++ = pat16;
-			while (--loops);
-			out = (unsigned char *)sout;
-		    }
-		    if (len & 1)
-			*out++ = *from++;
+                    out = inffast_copy(out, dist, len);
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
@@ -314,7 +314,9 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
     /* update state and return */
     strm->next_in = in;
     strm->next_out = out;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_IN - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_IN - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
                                  257 + (end - out) : 257 - (out - end));
     state->hold = hold;
@@ -334,6 +336,9 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
    - Swapping window/direct else
    - Larger unrolled copy loops (three is about right)
    - Moving len -= 3 statement into middle of loop
+
+   U-Boot: on current 32- and 64-bit CPUs the wide bit buffer and the
+   word-sized match copies are faster than the byte-wise code above was.
  */
 
 #endif /* !ASMINF */
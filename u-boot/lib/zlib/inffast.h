@@ -8,4 +8,7 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/* U-Boot: inflate_fast() reads the input eight bytes at a time */
+#define INFLATE_FAST_MIN_IN	8
+
 void inflate_fast OF((z_streamp strm, unsigned start));
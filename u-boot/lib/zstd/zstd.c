@@ -6,24 +6,214 @@
 #define LOG_CATEGORY	LOGC_BOOT
 
 #include <abuf.h>
+#include <decomp.h>
 #include <log.h>
 #include <malloc.h>
+#include <worker.h>
 #include <linux/errno.h>
 #include <linux/zstd.h>
+#include <asm/unaligned.h>
+
+/**
+ * struct zstd_frame - a frame within a compressed image
+ *
+ * @in: Frame data
+ * @in_size: Size of the frame data
+ * @out: Where to write the uncompressed data, when decompressing in parallel
+ * @out_size: Uncompressed size, or ZSTD_CONTENTSIZE_UNKNOWN
+ * @ret: Returns the result of zstd_decompress_dctx()
+ */
+struct zstd_frame {
+	const void *in;
+	size_t in_size;
+	void *out;
+	unsigned long long out_size;
+	size_t ret;
+};
+
+/**
+ * zstd_index_frames() - find the frames in a compressed image
+ *
+ * Skippable frames are left out. Anything after the last frame which does not
+ * start with a frame magic number is ignored.
+ *
+ * @in: Compressed data
+ * @frames: Returns the frames, or NULL to just count them
+ * Return: number of frames, or -EINVAL if the data is corrupt
+ */
+static int zstd_index_frames(struct abuf *in, struct zstd_frame *frames)
+{
+	const void *ptr = abuf_data(in);
+	size_t left = abuf_size(in);
+	zstd_frame_header fh;
+	int count = 0;
+	size_t len;
+
+	do {
+		/*
+		 * Find out how large the frame actually is, there may be junk
+		 * at the end of the frame that zstd_decompress_dctx() can't
+		 * handle.
+		 */
+		len = zstd_find_frame_compressed_size(ptr, left);
+		if (zstd_is_error(len)) {
+			log_err("%s: failed to detect compressed size: %d\n",
+				__func__, zstd_get_error_code(len));
+			return -EINVAL;
+		}
+		if (zstd_is_error(zstd_get_frame_header(&fh, ptr, len)))
+			return -EINVAL;
+		if (fh.frameType == ZSTD_frame) {
+			if (frames) {
+				frames[count].in = ptr;
+				frames[count].in_size = len;
+				frames[count].out_size = fh.frameContentSize;
+			}
+			count++;
+		}
+		ptr += len;
+		left -= len;
+	} while (left >= sizeof(u32) &&
+		 (get_unaligned_le32(ptr) == ZSTD_MAGICNUMBER ||
+		  (get_unaligned_le32(ptr) & ZSTD_MAGIC_SKIPPABLE_MASK) ==
+		  ZSTD_MAGIC_SKIPPABLE_START));
+
+	return count;
+}
+
+#if CONFIG_IS_ENABLED(DECOMP_PARALLEL)
+/**
+ * struct zstd_par_job - frames decompressed by one boot-time worker
+ *
+ * @ctx: Decompression context for this job
+ * @frames: All frames
+ * @first: First frame to decompress
+ * @step: Distance to the next frame to decompress
+ * @count: Number of frames in @frames
+ */
+struct zstd_par_job {
+	zstd_dctx *ctx;
+	struct zstd_frame *frames;
+	int first;
+	int step;
+	int count;
+};
+
+static void zstd_par_func(void *arg)
+{
+	struct zstd_par_job *job = arg;
+	struct zstd_frame *frame;
+	int i;
+
+	for (i = job->first; i < job->count; i += job->step) {
+		frame = &job->frames[i];
+		frame->ret = zstd_decompress_dctx(job->ctx, frame->out,
+						  frame->out_size, frame->in,
+						  frame->in_size);
+	}
+}
+
+/**
+ * zstd_decompress_parallel() - decompress the frames at the same time
+ *
+ * This needs the uncompressed size of every frame, so that the output offset
+ * of each is known in advance. If anything goes wrong, the caller decompresses
+ * the frames one by one, which also reports any error.
+ *
+ * Return: uncompressed size, or -EAGAIN if the caller must decompress the
+ * frames itself
+ */
+static int zstd_decompress_parallel(struct abuf *in, struct abuf *out,
+				    struct zstd_frame *frames, int count)
+{
+	struct zstd_par_job jobs[CONFIG_WORKER_MAX + 1];
+	struct worker_job wjobs[CONFIG_WORKER_MAX + 1];
+	void *workspace;
+	size_t wsize;
+	ulong pos;
+	int i, njobs, ret;
+
+	if (count < 2 || (abuf_data(out) < abuf_data(in) + abuf_size(in) &&
+			  abuf_data(in) < abuf_data(out) + abuf_size(out)))
+		return -EAGAIN;
+
+	for (i = 0, pos = 0; i < count; i++) {
+		if (frames[i].out_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+		    frames[i].out_size > abuf_size(out) - pos)
+			return -EAGAIN;
+		frames[i].out = abuf_data(out) + pos;
+		pos += frames[i].out_size;
+	}
+
+	njobs = min(count, CONFIG_WORKER_MAX + 1);
+	wsize = ALIGN(zstd_dctx_workspace_bound(), sizeof(u64));
+	workspace = malloc(wsize * njobs);
+	if (!workspace)
+		return -EAGAIN;
+
+	for (i = 0; i < njobs; i++) {
+		jobs[i].ctx = zstd_init_dctx(workspace + wsize * i, wsize);
+		if (!jobs[i].ctx) {
+			ret = -EAGAIN;
+			goto do_free;
+		}
+		jobs[i].frames = frames;
+		jobs[i].first = i;
+		jobs[i].step = njobs;
+		jobs[i].count = count;
+		wjobs[i].func = zstd_par_func;
+		wjobs[i].arg = &jobs[i];
+	}
+	worker_run(wjobs, njobs);
+
+	ret = pos;
+	for (i = 0; i < count; i++) {
+		if (frames[i].ret != frames[i].out_size)
+			ret = -EAGAIN;
+	}
+do_free:
+	free(workspace);
+
+	return ret;
+}
+#else
+static int zstd_decompress_parallel(struct abuf *in, struct abuf *out,
+				    struct zstd_frame *frames, int count)
+{
+	return -EAGAIN;
+}
+#endif
 
 int zstd_decompress(struct abuf *in, struct abuf *out)
 {
+	struct zstd_frame *frames;
 	zstd_dctx *ctx;
 	size_t wsize, len;
 	void *workspace;
-	int ret;
+	int i, count, ret;
+	ulong pos;
+
+	count = zstd_index_frames(in, NULL);
+	if (count <= 0)
+		return count;	/* 0 if there are only skippable frames */
+	frames = calloc(count, sizeof(*frames));
+	if (!frames)
+		return -ENOMEM;
+	zstd_index_frames(in, frames);
+
+	if (CONFIG_IS_ENABLED(DECOMP_PARALLEL)) {
+		ret = zstd_decompress_parallel(in, out, frames, count);
+		if (ret != -EAGAIN)
+			goto free_frames;
+	}
 
 	wsize = zstd_dctx_workspace_bound();
 	workspace = malloc(wsize);
 	if (!workspace) {
 		debug("%s: cannot allocate workspace of size %zu\n", __func__,
 			wsize);
-		return -ENOMEM;
+		ret = -ENOMEM;
+		goto free_frames;
 	}
 
 	ctx = zstd_init_dctx(workspace, wsize);
@@ -33,29 +223,189 @@ int zstd_decompress(struct abuf *in, struct abuf *out)
 		goto do_free;
 	}
 
-	/*
-	 * Find out how large the frame actually is, there may be junk at
-	 * the end of the frame that zstd_decompress_dctx() can't handle.
-	 */
-	len = zstd_find_frame_compressed_size(abuf_data(in), abuf_size(in));
-	if (zstd_is_error(len)) {
-		log_err("%s: failed to detect compressed size: %d\n", __func__,
-			zstd_get_error_code(len));
-		ret = -EINVAL;
-		goto do_free;
+	for (i = 0, pos = 0; i < count; i++) {
+		len = zstd_decompress_dctx(ctx, abuf_data(out) + pos,
+					   abuf_size(out) - pos, frames[i].in,
+					   frames[i].in_size);
+		if (zstd_is_error(len)) {
+			log_err("%s: failed to decompress: %d\n", __func__,
+				zstd_get_error_code(len));
+			ret = -EINVAL;
+			goto do_free;
+		}
+		pos += len;
 	}
 
-	len = zstd_decompress_dctx(ctx, abuf_data(out), abuf_size(out),
-				   abuf_data(in), len);
-	if (zstd_is_error(len)) {
-		log_err("%s: failed to decompress: %d\n", __func__,
-			zstd_get_error_code(len));
-		ret = -EINVAL;
-		goto do_free;
-	}
-
-	ret = len;
+	ret = pos;
 do_free:
 	free(workspace);
+free_frames:
+	free(frames);
 	return ret;
 }
+
+#if CONFIG_IS_ENABLED(DECOMP_STREAM)
+/**
+ * struct zstd_stream - state of zstd frames being decompressed
+ *
+ * The window size is only known once the frame header has been read, so the
+ * header is collected first and then passed to the decoder. This is done for
+ * each frame, since another frame may follow.
+ *
+ * @dstream: Decoder, or NULL if no frame header has been read yet
+ * @workspace: Memory for @dstream
+ * @window: Window size which @dstream was set up for
+ * @started: true if the header of the current frame has been read
+ * @hdr: Start of the frame
+ * @have: Number of bytes in @hdr
+ * @pos: Number of bytes in @hdr passed to the decoder
+ */
+struct zstd_stream {
+	zstd_dstream *dstream;
+	void *workspace;
+	unsigned long long window;
+	bool started;
+	u8 hdr[ZSTD_FRAMEHEADERSIZE_MAX];
+	size_t have;
+	size_t pos;
+};
+
+/* Returns 1 if the decoder is ready, 0 if more input is needed */
+static int zstd_stream_start(struct decomp_stream *ds, struct zstd_stream *zs)
+{
+	zstd_frame_header fh;
+	size_t n, wsize;
+	u32 magic;
+
+	n = min(sizeof(zs->hdr) - zs->have, ds->avail_in);
+	memcpy(zs->hdr + zs->have, ds->next_in, n);
+	decomp_stream_consume(ds, n);
+	zs->have += n;
+
+	/* After the first frame, anything but another frame is trailing data */
+	if (zs->dstream) {
+		if (zs->have < sizeof(u32))
+			return ds->in_end ? -ENODATA : 0;
+		magic = get_unaligned_le32(zs->hdr);
+		if (magic != ZSTD_MAGICNUMBER &&
+		    (magic & ZSTD_MAGIC_SKIPPABLE_MASK) !=
+		    ZSTD_MAGIC_SKIPPABLE_START)
+			return -ENODATA;
+	}
+
+	n = zstd_get_frame_header(&fh, zs->hdr, zs->have);
+	if (zstd_is_error(n) ||
+	    (fh.frameType != ZSTD_frame && !zs->dstream) ||
+	    fh.windowSize > 1ULL << ZSTD_WINDOWLOG_LIMIT_DEFAULT) {
+		log_debug("bad frame header: %zx\n", n);
+		return -EINVAL;
+	}
+	if (n)
+		return 0;
+	zs->started = true;
+
+	if (zs->dstream && fh.windowSize <= zs->window) {
+		if (zstd_is_error(zstd_reset_dstream(zs->dstream)))
+			return -EINVAL;
+		return 1;
+	}
+
+	free(zs->workspace);
+	zs->dstream = NULL;
+	wsize = zstd_dstream_workspace_bound(fh.windowSize);
+	zs->workspace = malloc(wsize);
+	if (!zs->workspace)
+		return -ENOMEM;
+	zs->dstream = zstd_init_dstream(fh.windowSize, zs->workspace, wsize);
+	if (!zs->dstream)
+		return -EINVAL;
+	zs->window = fh.windowSize;
+
+	return 1;
+}
+
+static int zstd_stream_run(struct decomp_stream *ds)
+{
+	struct zstd_stream *zs = ds->priv;
+	zstd_in_buffer in;
+	zstd_out_buffer out;
+	bool from_hdr;
+	size_t ret;
+	int err;
+
+	while (1) {
+		if (!zs->started) {
+			err = zstd_stream_start(ds, zs);
+			if (err == -ENODATA)
+				return 1;
+			if (err <= 0)
+				return err;
+		}
+
+		/* Pass on the bytes collected to read the frame header first */
+		from_hdr = zs->pos < zs->have;
+		if (from_hdr) {
+			in.src = zs->hdr;
+			in.size = zs->have;
+			in.pos = zs->pos;
+		} else {
+			in.src = ds->next_in;
+			in.size = ds->avail_in;
+			in.pos = 0;
+		}
+		out.dst = ds->next_out;
+		out.size = ds->avail_out;
+		out.pos = 0;
+		ret = zstd_decompress_stream(zs->dstream, &out, &in);
+		decomp_stream_produce(ds, out.pos);
+		if (from_hdr)
+			zs->pos = in.pos;
+		else
+			decomp_stream_consume(ds, in.pos);
+		if (zstd_is_error(ret))
+			goto err;
+		if (ret) {
+			if (!from_hdr || zs->pos < zs->have)
+				return 0;
+			continue;
+		}
+
+		/* End of frame; keep any collected bytes which follow it */
+		memmove(zs->hdr, zs->hdr + zs->pos, zs->have - zs->pos);
+		zs->have -= zs->pos;
+		zs->pos = 0;
+		zs->started = false;
+	}
+
+err:
+	log_debug("failed to decompress: %d\n", zstd_get_error_code(ret));
+
+	return -EINVAL;
+}
+
+static void zstd_stream_end(struct decomp_stream *ds)
+{
+	struct zstd_stream *zs = ds->priv;
+
+	free(zs->workspace);
+	free(zs);
+}
+
+static const struct decomp_ops zstd_stream_ops = {
+	.run	= zstd_stream_run,
+	.end	= zstd_stream_end,
+};
+
+int zstd_stream_init(struct decomp_stream *ds)
+{
+	struct zstd_stream *zs;
+
+	zs = calloc(1, sizeof(*zs));
+	if (!zs)
+		return -ENOMEM;
+	ds->ops = &zstd_stream_ops;
+	ds->priv = zs;
+
+	return 0;
+}
+#endif
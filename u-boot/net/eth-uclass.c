@@ -423,6 +423,46 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+/*
+ * Receive up to ETH_PACKETS_BATCH_RECV packets in as few driver calls as
+ * possible, then process them all before giving the buffers back.
+ */
+static int eth_rx_batch(struct udevice *dev)
+{
+	struct eth_ops *ops = eth_get_ops(dev);
+	uchar *packets[ETH_PACKETS_BATCH_RECV];
+	int lengths[ETH_PACKETS_BATCH_RECV];
+	int flags = ETH_RECV_CHECK_DEVICE;
+	int count = 0;
+	int ret, i;
+
+	do {
+		ret = ops->recv_batch(dev, flags, packets + count,
+				      lengths + count,
+				      ETH_PACKETS_BATCH_RECV - count);
+		flags = 0;
+		if (ret <= 0)
+			break;
+		count += ret;
+	} while (count < ETH_PACKETS_BATCH_RECV);
+
+	for (i = 0; i < count; i++)
+		if (lengths[i] > 0)
+			net_process_received_packet(packets[i], lengths[i]);
+
+	if (ops->free_pkt) {
+		for (i = 0; i < count; i++)
+			ops->free_pkt(dev, packets[i], lengths[i]);
+	}
+
+	if (ret == -EAGAIN || ret > 0)
+		ret = 0;
+	if (ret < 0)
+		debug("%s: recv_batch() returned error %d\n", __func__, ret);
+
+	return ret;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -438,6 +478,9 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	if (eth_get_ops(current)->recv_batch)
+		return eth_rx_batch(current);
+
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
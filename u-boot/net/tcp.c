@@ -39,19 +39,22 @@ static u32 tcp_ack_edge;
 static int tcp_activity_count;
 
 /*
- * Search for TCP_SACK and review the comments before the code section
- * TCP_SACK is the number of packets at the front of the stream
+ * Received data beyond tcp_ack_edge, as a sorted list of hills. The
+ * application stores every segment in its final place as it arrives, so
+ * only the edges need to be kept here.
  */
-
-enum pkt_state {PKT, NOPKT};
-struct sack_r {
-	struct sack_edges se;
-	enum pkt_state st;
-};
-
-static struct sack_r edge_a[TCP_SACK];
-static unsigned int sack_idx;
-static unsigned int prev_len;
+static struct sack_edges tcp_rx_hills[TCP_SACK];
+static unsigned int tcp_rx_hill_cnt;
+/* Hill holding the most recently received segment, reported first */
+static unsigned int tcp_rx_hill_last;
+/* In order segments received since the last ACK we sent */
+static unsigned int tcp_rx_unacked;
+/* The next ACK must not be delayed */
+static bool tcp_rx_ack_now;
+
+/* Options the peer agreed to in its SYN ACK */
+static bool tcp_rx_scaled;
+static bool tcp_rx_sack;
 
 /*
  * TCP lengths are stored as a rounded up number of 32 bit words.
@@ -63,6 +66,12 @@ static unsigned int prev_len;
 #define SHIFT_TO_TCPHDRLEN_FIELD(x) ((x) << 4)
 #define GET_TCP_HDR_LEN_IN_BYTES(x) ((x) >> 2)
 
+/* Sequence number comparison, modulo 2^32 */
+#define TCP_SEQ_LT(a, b) ((s32)((a) - (b)) < 0)
+#define TCP_SEQ_LE(a, b) ((s32)((a) - (b)) <= 0)
+
+#define TCP_RX_WINDOW	CONFIG_PROT_TCP_RX_WINDOW
+
 /* TCP connection state */
 static enum tcp_state current_tcp_state;
 
@@ -146,6 +155,40 @@ u16 tcp_set_pseudo_header(uchar *pkt, struct in_addr src, struct in_addr dest,
 	return compute_ip_checksum(pkt + PSEUDO_PAD_SIZE, checksum_len);
 }
 
+/**
+ * tcp_rx_scale() - get the window scale we offer in our SYN
+ *
+ * Return: smallest shift that fits TCP_RX_WINDOW into the 16 bit field
+ */
+static u8 tcp_rx_scale(void)
+{
+	u8 scale = 0;
+
+	while ((TCP_RX_WINDOW >> scale) > 0xffff)
+		scale++;
+
+	return scale;
+}
+
+/**
+ * tcp_rx_window() - get the value of the window field of a packet
+ * @action: TCP flags of the packet
+ *
+ * Received data goes straight to the application, which stores it in its
+ * final place, so the window is not limited by the Ethernet receive
+ * buffers. The window in a SYN is never scaled, and neither is it unless
+ * the peer agreed to scaling in its SYN ACK (RFC 7323).
+ *
+ * Return: window, in the units the peer expects
+ */
+static u16 tcp_rx_window(u8 action)
+{
+	if (!(action & TCP_SYN) && tcp_rx_scaled)
+		return TCP_RX_WINDOW >> tcp_rx_scale();
+
+	return min(TCP_RX_WINDOW, 0xffff);
+}
+
 /**
  * net_set_ack_options() - set TCP options in acknowledge packets
  * @b: the packet
@@ -164,7 +207,7 @@ int net_set_ack_options(union tcp_build_pkt *b)
 	b->sack.sack_v.len = 0;
 
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
-		if (tcp_lost.len > TCP_OPT_LEN_2) {
+		if (tcp_rx_sack && tcp_lost.len > TCP_OPT_LEN_2) {
 			debug_cond(DEBUG_DEV_PKT, "TCP ack opt lost.len %x\n",
 				   tcp_lost.len);
 			b->sack.sack_v.len = tcp_lost.len;
@@ -186,9 +229,9 @@ int net_set_ack_options(union tcp_build_pkt *b)
 			b->sack.sack_v.hill[3].r = TCP_O_NOP;
 		}
 
-		b->sack.hdr.tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(ROUND_TCPHDR_LEN(TCP_HDR_SIZE +
-										 TCP_TSOPT_SIZE +
-										 tcp_lost.len));
+		b->sack.hdr.tcp_hlen =
+			SHIFT_TO_TCPHDRLEN_FIELD(ROUND_TCPHDR_LEN(TCP_HDR_SIZE + TCP_TSOPT_SIZE +
+								  b->sack.sack_v.len));
 	} else {
 		b->sack.sack_v.kind = 0;
 		b->sack.hdr.tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(ROUND_TCPHDR_LEN(TCP_HDR_SIZE +
@@ -211,6 +254,8 @@ void net_set_syn_options(union tcp_build_pkt *b)
 {
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
 		tcp_lost.len = 0;
+	tcp_rx_scaled = false;
+	tcp_rx_sack = false;
 
 	b->ip.hdr.tcp_hlen = 0xa0;
 
@@ -218,7 +263,7 @@ void net_set_syn_options(union tcp_build_pkt *b)
 	b->ip.mss.len = TCP_OPT_LEN_4;
 	b->ip.mss.mss = htons(TCP_MSS);
 	b->ip.scale.kind = TCP_O_SCL;
-	b->ip.scale.scale = TCP_SCALE;
+	b->ip.scale.scale = tcp_rx_scale();
 	b->ip.scale.len = TCP_OPT_LEN_3;
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
 		b->ip.sack_p.kind = TCP_P_SACK;
@@ -318,6 +363,10 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	tcp_len	= pkt_len - IP_HDR_SIZE;
 
 	tcp_ack_edge = tcp_ack_num;
+	if (b->ip.hdr.tcp_flags & TCP_ACK) {
+		tcp_rx_unacked = 0;
+		tcp_rx_ack_now = false;
+	}
 	/* TCP Header */
 	b->ip.hdr.tcp_ack = htonl(tcp_ack_edge);
 	b->ip.hdr.tcp_src = htons(sport);
@@ -339,7 +388,7 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	 * it is, then the u-boot tftp or nfs kernel netboot should be
 	 * considered.
 	 */
-	b->ip.hdr.tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	b->ip.hdr.tcp_win = htons(tcp_rx_window(b->ip.hdr.tcp_flags));
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -354,111 +403,137 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 }
 
 /**
- * tcp_hole() - Selective Acknowledgment (Essential for fast stream transfer)
- * @tcp_seq_num: TCP sequence start number
- * @len: the length of sequence numbers
+ * tcp_sack_update() - fill in the SACK blocks of our next ACK
+ *
+ * RFC 2018: the first block reports the most recently received segment,
+ * the others as many of the remaining hills as fit.
  */
-void tcp_hole(u32 tcp_seq_num, u32 len)
+static void tcp_sack_update(void)
 {
-	u32 idx_sack, sack_in;
-	u32 sack_end = TCP_SACK - 1;
-	u32 hill = 0;
-	enum pkt_state expect = PKT;
-	u32 seq = tcp_seq_num - tcp_seq_init;
-	u32 hol_l = tcp_ack_edge - tcp_seq_init;
-	u32 hol_r = 0;
-
-	/* Place new seq number in correct place in receive array */
-	if (prev_len == 0)
-		prev_len = len;
-
-	idx_sack = sack_idx + ((tcp_seq_num - tcp_ack_edge) / prev_len);
-	if (idx_sack < TCP_SACK) {
-		edge_a[idx_sack].se.l = tcp_seq_num;
-		edge_a[idx_sack].se.r = tcp_seq_num + len;
-		edge_a[idx_sack].st = PKT;
+	unsigned int i, n = 0;
 
-		/*
-		 * The fin (last) packet is not the same length as data
-		 * packets, and if it's length is recorded and used for
-		 *  array index calculation, calculation breaks.
-		 */
-		if (prev_len < len)
-			prev_len = len;
+	if (!IS_ENABLED(CONFIG_PROT_TCP_SACK))
+		return;
+
+	if (tcp_rx_hill_cnt)
+		tcp_lost.hill[n++] = tcp_rx_hills[tcp_rx_hill_last];
+	for (i = 0; i < tcp_rx_hill_cnt && n < TCP_SACK_HILLS - 1; i++) {
+		if (i != tcp_rx_hill_last)
+			tcp_lost.hill[n++] = tcp_rx_hills[i];
 	}
+	tcp_lost.len = TCP_OPT_LEN_2 + n * TCP_OPT_LEN_8;
+}
 
-	debug_cond(DEBUG_DEV_PKT,
-		   "TCP 1 seq %d, edg %d, len %d, sack_idx %d, sack_end %d\n",
-		    seq, hol_l, len, sack_idx, sack_end);
+/**
+ * tcp_hole() - track received data and the holes in it
+ * @tcp_seq_num: sequence number of the segment, moved forward past any
+ *		 part which had been received already
+ * @len: length of the segment, reduced to match
+ *
+ * Segments received in order move tcp_ack_edge forward, along with any
+ * hills they join up with. Others are merged into the hills, which are
+ * reported back to the sender as SACK blocks. A segment beyond the receive
+ * window, or needing a hill when there is no room left, is dropped by
+ * setting @len to zero.
+ */
+static void tcp_hole(u32 *tcp_seq_num, int *len)
+{
+	u32 l = *tcp_seq_num;
+	u32 r = l + *len;
+	unsigned int i, j;
 
-	/* Right edge of contiguous stream, is the left edge of first hill */
-	hol_l = tcp_seq_num - tcp_seq_init;
-	hol_r = hol_l + len;
+	debug_cond(DEBUG_DEV_PKT, "TCP hole seq %u, len %d, edge %u, hills %u\n",
+		   l - tcp_seq_init, *len, tcp_ack_edge - tcp_seq_init,
+		   tcp_rx_hill_cnt);
 
-	if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
-		tcp_lost.len = TCP_OPT_LEN_2;
+	if (TCP_SEQ_LT(tcp_ack_edge + TCP_RX_WINDOW, r)) {
+		*len = 0;
+		tcp_rx_ack_now = true;
+		return;
+	}
 
-	debug_cond(DEBUG_DEV_PKT,
-		   "TCP 1 in %d, seq %d, pkt_l %d, pkt_r %d, sack_idx %d, sack_end %d\n",
-		   idx_sack, seq, hol_l, hol_r, sack_idx, sack_end);
-
-	for (sack_in = sack_idx; sack_in < sack_end && hill < TCP_SACK_HILLS;
-	     sack_in++)  {
-		switch (expect) {
-		case NOPKT:
-			switch (edge_a[sack_in].st) {
-			case NOPKT:
-				debug_cond(DEBUG_INT_STATE, "N");
-				break;
-			case PKT:
-				debug_cond(DEBUG_INT_STATE, "n");
-				if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
-					tcp_lost.hill[hill].l =
-						edge_a[sack_in].se.l;
-					tcp_lost.hill[hill].r =
-						edge_a[sack_in].se.r;
-				}
-				expect = PKT;
-				break;
-			}
-			break;
-		case PKT:
-			switch (edge_a[sack_in].st) {
-			case NOPKT:
-				debug_cond(DEBUG_INT_STATE, "p");
-				if (sack_in > sack_idx &&
-				    hill < TCP_SACK_HILLS) {
-					hill++;
-					if (IS_ENABLED(CONFIG_PROT_TCP_SACK))
-						tcp_lost.len += TCP_OPT_LEN_8;
-				}
-				expect = NOPKT;
-				break;
-			case PKT:
-				debug_cond(DEBUG_INT_STATE, "P");
-
-				if (tcp_ack_edge == edge_a[sack_in].se.l) {
-					tcp_ack_edge = edge_a[sack_in].se.r;
-					edge_a[sack_in].st = NOPKT;
-					sack_idx++;
-				} else {
-					if (IS_ENABLED(CONFIG_PROT_TCP_SACK) &&
-					    hill < TCP_SACK_HILLS)
-						tcp_lost.hill[hill].r =
-							edge_a[sack_in].se.r;
-				if (IS_ENABLED(CONFIG_PROT_TCP_SACK) &&
-				    sack_in == sack_end - 1)
-					tcp_lost.hill[hill].r =
-						edge_a[sack_in].se.r;
-				}
-				break;
-			}
-			break;
+	/* Data we already have is resent when an ACK got lost: ACK again */
+	if (TCP_SEQ_LE(r, tcp_ack_edge)) {
+		*len = 0;
+		tcp_rx_ack_now = true;
+		return;
+	}
+	if (TCP_SEQ_LT(l, tcp_ack_edge))
+		l = tcp_ack_edge;
+	*tcp_seq_num = l;
+	*len = r - l;
+
+	if (l == tcp_ack_edge) {
+		tcp_ack_edge = r;
+		while (tcp_rx_hill_cnt &&
+		       TCP_SEQ_LE(tcp_rx_hills[0].l, tcp_ack_edge)) {
+			if (TCP_SEQ_LT(tcp_ack_edge, tcp_rx_hills[0].r))
+				tcp_ack_edge = tcp_rx_hills[0].r;
+			tcp_rx_hill_cnt--;
+			memmove(&tcp_rx_hills[0], &tcp_rx_hills[1],
+				tcp_rx_hill_cnt * sizeof(*tcp_rx_hills));
+			tcp_rx_ack_now = true;
+		}
+		tcp_rx_hill_last = 0;
+		if (tcp_rx_hill_cnt)
+			tcp_rx_ack_now = true;
+		tcp_rx_unacked++;
+		tcp_sack_update();
+		return;
+	}
+
+	/* Out of order: find the hills this segment touches */
+	for (i = 0; i < tcp_rx_hill_cnt &&
+	     TCP_SEQ_LT(tcp_rx_hills[i].r, l); i++)
+		;
+	for (j = i; j < tcp_rx_hill_cnt &&
+	     TCP_SEQ_LE(tcp_rx_hills[j].l, r); j++) {
+		if (TCP_SEQ_LT(tcp_rx_hills[j].l, l))
+			l = tcp_rx_hills[j].l;
+		if (TCP_SEQ_LT(r, tcp_rx_hills[j].r))
+			r = tcp_rx_hills[j].r;
+	}
+
+	if (i == j) {
+		if (tcp_rx_hill_cnt == TCP_SACK) {
+			*len = 0;
+			tcp_rx_ack_now = true;
+			return;
 		}
+		memmove(&tcp_rx_hills[i + 1], &tcp_rx_hills[i],
+			(tcp_rx_hill_cnt - i) * sizeof(*tcp_rx_hills));
+		tcp_rx_hill_cnt++;
+	} else if (j > i + 1) {
+		memmove(&tcp_rx_hills[i + 1], &tcp_rx_hills[j],
+			(tcp_rx_hill_cnt - j) * sizeof(*tcp_rx_hills));
+		tcp_rx_hill_cnt -= j - i - 1;
 	}
-	debug_cond(DEBUG_INT_STATE, "\n");
-	if (!IS_ENABLED(CONFIG_PROT_TCP_SACK) || tcp_lost.len <= TCP_OPT_LEN_2)
-		sack_idx = 0;
+	tcp_rx_hills[i].l = l;
+	tcp_rx_hills[i].r = r;
+	tcp_rx_hill_last = i;
+	tcp_rx_ack_now = true;
+	tcp_sack_update();
+}
+
+/**
+ * tcp_ack_can_wait() - check whether the ACK of received data may be delayed
+ *
+ * Return: true if everything has been received in order and fewer than two
+ *	   segments are waiting for an ACK (RFC 5681)
+ */
+bool tcp_ack_can_wait(void)
+{
+	return !tcp_rx_ack_now && tcp_rx_unacked < 2;
+}
+
+/**
+ * tcp_get_ack_edge() - get the sequence number we acknowledge
+ *
+ * Return: the first sequence number not yet received in order
+ */
+u32 tcp_get_ack_edge(void)
+{
+	return tcp_ack_edge;
 }
 
 /**
@@ -475,39 +550,44 @@ void tcp_parse_options(uchar *o, int o_len)
 	 * NOPs are options with a zero length, and thus are special.
 	 * All other options have length fields.
 	 */
-	for (p = o; p < (o + o_len); p = p + p[1]) {
-		if (!p[1])
-			return; /* Finished processing options */
+	while (p < o + o_len) {
+		if (p[0] == TCP_O_END)
+			return;
+		if (p[0] == TCP_1_NOP) {
+			p++;
+			continue;
+		}
+		if (p + 1 >= o + o_len || p[1] < TCP_OPT_LEN_2)
+			return; /* Malformed */
 
 		switch (p[0]) {
-		case TCP_O_END:
-			return;
-		case TCP_O_MSS:
 		case TCP_O_SCL:
+			/* Only valid in the SYN ACK answering our own SYN */
+			if (current_tcp_state == TCP_SYN_SENT)
+				tcp_rx_scaled = true;
+			break;
 		case TCP_P_SACK:
-		case TCP_V_SACK:
+			if (current_tcp_state == TCP_SYN_SENT)
+				tcp_rx_sack = true;
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
 			rmt_timestamp = tsopt->t_snd;
-			return;
+			break;
 		}
-
-		/* Process optional NOPs */
-		if (p[0] == TCP_O_NOP)
-			p++;
+		p += p[1];
 	}
 }
 
-static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
+static u8 tcp_state_machine(u8 tcp_flags, u32 *tcp_seq_num, int *payload_len)
 {
+	u32 tcp_fin_seq = *tcp_seq_num + *payload_len;
 	u8 tcp_fin = tcp_flags & TCP_FIN;
 	u8 tcp_syn = tcp_flags & TCP_SYN;
 	u8 tcp_rst = tcp_flags & TCP_RST;
 	u8 tcp_push = tcp_flags & TCP_PUSH;
 	u8 tcp_ack = tcp_flags & TCP_ACK;
 	u8 action = TCP_DATA;
-	int i;
 
 	/*
 	 * tcp_flags are examined to determine TX action in a given state
@@ -532,8 +612,8 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 		debug_cond(DEBUG_INT_STATE, "TCP CLOSED %x\n", tcp_flags);
 		if (tcp_syn) {
 			action = TCP_SYN | TCP_ACK;
-			tcp_seq_init = tcp_seq_num;
-			tcp_ack_edge = tcp_seq_num + 1;
+			tcp_seq_init = *tcp_seq_num;
+			tcp_ack_edge = *tcp_seq_num + 1;
 			current_tcp_state = TCP_SYN_RECEIVED;
 		} else if (tcp_ack || tcp_fin) {
 			action = TCP_DATA;
@@ -542,21 +622,22 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 	case TCP_SYN_RECEIVED:
 	case TCP_SYN_SENT:
 		debug_cond(DEBUG_INT_STATE, "TCP_SYN_SENT | TCP_SYN_RECEIVED %x, %u\n",
-			   tcp_flags, tcp_seq_num);
+			   tcp_flags, *tcp_seq_num);
 		if (tcp_fin) {
 			action = action | TCP_PUSH;
 			current_tcp_state = TCP_CLOSE_WAIT;
 		} else if (tcp_ack || (tcp_syn && tcp_ack)) {
 			action |= TCP_ACK;
-			tcp_seq_init = tcp_seq_num;
-			tcp_ack_edge = tcp_seq_num + 1;
-			sack_idx = 0;
-			edge_a[sack_idx].se.l = tcp_ack_edge;
-			edge_a[sack_idx].se.r = tcp_ack_edge;
-			prev_len = 0;
+			/* The final ACK of a passive open carries no SYN */
+			if (tcp_syn) {
+				tcp_seq_init = *tcp_seq_num;
+				tcp_ack_edge = *tcp_seq_num + 1;
+			}
+			tcp_rx_hill_cnt = 0;
+			tcp_rx_unacked = 0;
+			tcp_rx_ack_now = false;
+			tcp_lost.len = TCP_OPT_LEN_2;
 			current_tcp_state = TCP_ESTABLISHED;
-			for (i = 0; i < TCP_SACK; i++)
-				edge_a[i].st = NOPKT;
 
 			if (tcp_syn && tcp_ack)
 				action |= TCP_PUSH;
@@ -566,14 +647,12 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 		break;
 	case TCP_ESTABLISHED:
 		debug_cond(DEBUG_INT_STATE, "TCP_ESTABLISHED %x\n", tcp_flags);
-		if (payload_len > 0) {
+		if (*payload_len > 0)
 			tcp_hole(tcp_seq_num, payload_len);
-			tcp_fin = TCP_DATA;  /* cause standalone FIN */
-		}
 
-		if ((tcp_fin) &&
-		    (!IS_ENABLED(CONFIG_PROT_TCP_SACK) ||
-		     tcp_lost.len <= TCP_OPT_LEN_2)) {
+		/* A FIN counts only once all data before it is in */
+		if (tcp_fin && tcp_fin_seq == tcp_ack_edge) {
+			tcp_ack_edge++;
 			action = action | TCP_FIN | TCP_PUSH | TCP_ACK;
 			current_tcp_state = TCP_CLOSE_WAIT;
 		} else if (tcp_ack) {
@@ -640,7 +719,8 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	u16 tcp_rx_xsum = b->ip.hdr.ip_sum;
 	u8  tcp_action = TCP_DATA;
 	u32 tcp_seq_num, tcp_ack_num;
-	int tcp_hdr_len, payload_len;
+	int tcp_hdr_len, payload_len, rx_len;
+	uchar *payload;
 
 	/* Verify IP header */
 	debug_cond(DEBUG_DEV_PKT,
@@ -682,9 +762,14 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	tcp_seq_num = ntohl(b->ip.hdr.tcp_seq);
 	tcp_ack_num = ntohl(b->ip.hdr.tcp_ack);
 
-	/* Packets are not ordered. Send to app as received. */
+	/*
+	 * Segments are passed on in the order received, less any part
+	 * the app has been given already.
+	 */
+	rx_len = payload_len;
 	tcp_action = tcp_state_machine(b->ip.hdr.tcp_flags,
-				       tcp_seq_num, payload_len);
+				       &tcp_seq_num, &payload_len);
+	payload = (uchar *)b + pkt_len - payload_len;
 
 	tcp_activity_count++;
 	if (tcp_activity_count > TCP_ACTIVITY) {
@@ -692,12 +777,17 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 		tcp_activity_count = 0;
 	}
 
-	if ((tcp_action & TCP_PUSH) || payload_len > 0) {
+	if (rx_len > 0 && !payload_len && !(tcp_action & TCP_PUSH)) {
+		/* Duplicate or dropped: tell the server where we are */
+		net_send_tcp_packet(0, ntohs(b->ip.hdr.tcp_src),
+				    ntohs(b->ip.hdr.tcp_dst), TCP_ACK,
+				    tcp_ack_num, tcp_ack_edge);
+	} else if ((tcp_action & TCP_PUSH) || payload_len > 0) {
 		debug_cond(DEBUG_DEV_PKT,
 			   "TCP Notify (action=%x, Seq=%u,Ack=%u,Pay%d)\n",
 			   tcp_action, tcp_seq_num, tcp_ack_num, payload_len);
 
-		(*tcp_packet_handler) ((uchar *)b + pkt_len - payload_len, b->ip.hdr.tcp_dst,
+		(*tcp_packet_handler) (payload, b->ip.hdr.tcp_dst,
 				       b->ip.hdr.ip_src, b->ip.hdr.tcp_src, tcp_seq_num,
 				       tcp_ack_num, tcp_action, payload_len);
 
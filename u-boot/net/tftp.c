@@ -573,6 +573,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 					dectoul((char *)pkt + i + 11, NULL);
 				debug("windowsize = %s, %d\n",
 				      (char *)pkt + i + 11, tftp_windowsize);
+				if (!tftp_windowsize ||
+				    tftp_windowsize > tftp_window_size_option) {
+					printf("Invalid window size(=%d)\n",
+					       tftp_windowsize);
+					tftp_state = STATE_INVALID_OPTION;
+				}
 			}
 		}
 
@@ -593,17 +599,28 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 
 		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
+			short ahead = ntohs(*(__be16 *)pkt) -
+				      (ushort)(tftp_cur_block + 1);
+
 			debug("Received unexpected block: %d, expected: %d\n",
 			      ntohs(*(__be16 *)pkt),
 			      (ushort)(tftp_cur_block + 1));
 			/*
-			 * Only ACK if the block count received is greater than
-			 * the expected block count, otherwise skip ACK.
-			 * (required to properly handle the server retransmitting
-			 *  the window)
+			 * A block we already have. If it is the last one we
+			 * received, the server is resending the window because
+			 * our ACK got lost: ACK it again rather than waiting
+			 * for our own timeout. Earlier blocks of a resent
+			 * window are simply skipped.
 			 */
-			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0)
+			if (ahead < 0) {
+				if (ntohs(*(__be16 *)pkt) ==
+				    (ushort)tftp_cur_block) {
+					tftp_send();
+					tftp_next_ack = (ushort)(tftp_cur_block +
+								 tftp_windowsize);
+				}
 				break;
+			}
 			/*
 			 * If one packet is dropped most likely
 			 * all other buffers in the window
@@ -710,6 +727,12 @@ static void tftp_timeout_handler(void)
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
+		/* The server restarts its window after the block we ACKed */
+		if (tftp_state == STATE_DATA && !tftp_put_active) {
+			tftp_last_nack = tftp_cur_block;
+			tftp_next_ack = (ushort)(tftp_cur_block +
+						 tftp_windowsize);
+		}
 	}
 }
 
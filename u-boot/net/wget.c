@@ -30,26 +30,12 @@ static const char linefeed[] = "\r\n";
 static struct in_addr web_server_ip;
 static int our_port;
 static int wget_timeout_count;
+static bool wget_ack_pending;
 
-struct pkt_qd {
-	uchar *pkt;
-	unsigned int tcp_seq_num;
-	unsigned int len;
-};
-
-/*
- * This is a control structure for out of order packets received.
- * The actual packet bufers are in the kernel space, and are
- * expected to be overwritten by the downloaded image.
- */
-#define PKTQ_SZ (PKTBUFSRX / 4)
-static struct pkt_qd pkt_q[PKTQ_SZ];
-static int pkt_q_idx;
 static unsigned long content_length;
 static unsigned int packets;
 
 static unsigned int initial_data_seq_num;
-static unsigned int next_data_seq_num;
 
 static enum  wget_state current_wget_state;
 
@@ -61,8 +47,6 @@ static enum net_loop_state wget_loop_state;
 /* Timeout retry parameters */
 static u8 retry_action;			/* actions for TCP retry */
 static unsigned int retry_tcp_ack_num;	/* TCP retry acknowledge number*/
-static unsigned int retry_tcp_seq_num;	/* TCP retry sequence number */
-static int retry_len;			/* TCP retry length */
 
 static ulong wget_load_size;
 
@@ -134,12 +118,12 @@ static inline int store_block(uchar *src, unsigned int offset, unsigned int len)
 static void wget_send_stored(void)
 {
 	u8 action = retry_action;
-	int len = retry_len;
-	unsigned int tcp_ack_num = retry_tcp_seq_num + (len == 0 ? 1 : len);
+	unsigned int tcp_ack_num = tcp_get_ack_edge();
 	unsigned int tcp_seq_num = retry_tcp_ack_num;
 	unsigned int server_port;
 	uchar *ptr, *offset;
 
+	wget_ack_pending = false;
 	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
 
 	switch (current_wget_state) {
@@ -151,7 +135,6 @@ static void wget_send_stored(void)
 		packets = 0;
 		break;
 	case WGET_CONNECTING:
-		pkt_q_idx = 0;
 		net_send_tcp_packet(0, server_port, our_port, action,
 				    tcp_seq_num, tcp_ack_num);
 
@@ -185,8 +168,6 @@ static void wget_send(u8 action, unsigned int tcp_seq_num,
 {
 	retry_action = action;
 	retry_tcp_ack_num = tcp_ack_num;
-	retry_tcp_seq_num = tcp_seq_num;
-	retry_len = len;
 
 	wget_send_stored();
 }
@@ -211,6 +192,13 @@ void wget_success(u8 action, unsigned int tcp_seq_num,
  */
 static void wget_timeout_handler(void)
 {
+	if (wget_ack_pending) {
+		/* Delayed ACK: nothing was lost */
+		net_set_timeout_handler(wget_timeout, wget_timeout_handler);
+		wget_send_stored();
+		return;
+	}
+
 	if (++wget_timeout_count > WGET_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
 		wget_send(TCP_RST, 0, 0, 0);
@@ -224,116 +212,95 @@ static void wget_timeout_handler(void)
 	}
 }
 
-#define PKT_QUEUE_OFFSET 0x20000
-#define PKT_QUEUE_PACKET_SIZE 0x800
-
 static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 			   u8 action, unsigned int tcp_ack_num, unsigned int len)
 {
-	uchar *pkt_in_q;
 	char *pos;
 	int hlen, i;
-	uchar *ptr1;
-
-	pkt[len] = '\0';
-	pos = strstr((char *)pkt, http_eom);
+	uchar *ptr;
 
-	if (!pos) {
+	if (tcp_seq_num != initial_data_seq_num) {
+		/*
+		 * Data from beyond the header arrived first; keep it where it
+		 * would go if the header were part of the file
+		 */
 		debug_cond(DEBUG_WGET,
 			   "wget: Connected, data before Header %p\n", pkt);
-		pkt_in_q = (void *)image_load_addr + PKT_QUEUE_OFFSET +
-			(pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
+		if (store_block(pkt, tcp_seq_num - initial_data_seq_num, len)) {
+			wget_loop_state = NETLOOP_FAIL;
+			wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+		wget_send(action, tcp_seq_num, tcp_ack_num, len);
+		return;
+	}
 
-		ptr1 = map_sysmem((phys_addr_t)pkt_in_q, len);
-		memcpy(ptr1, pkt, len);
-		unmap_sysmem(ptr1);
+	pkt[len] = '\0';
+	pos = strstr((char *)pkt, http_eom);
+	if (!pos) {
+		wget_loop_state = NETLOOP_FAIL;
+		wget_fail("HTTP header not in the first segment\n",
+			  tcp_seq_num, tcp_ack_num, action);
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
 
-		pkt_q[pkt_q_idx].pkt = pkt_in_q;
-		pkt_q[pkt_q_idx].tcp_seq_num = tcp_seq_num;
-		pkt_q[pkt_q_idx].len = len;
-		pkt_q_idx++;
+	debug_cond(DEBUG_WGET, "wget: Connected HTTP Header %p\n", pkt);
+	/* sizeof(http_eom) - 1 is the string length of (http_eom) */
+	hlen = pos - (char *)pkt + sizeof(http_eom) - 1;
+	pos = strstr((char *)pkt, linefeed);
+	if (pos > 0)
+		i = pos - (char *)pkt;
+	else
+		i = hlen;
+	printf("%.*s", i,  pkt);
 
-		if (pkt_q_idx >= PKTQ_SZ) {
-			printf("wget: Fatal error, queue overrun!\n");
-			net_set_state(NETLOOP_FAIL);
+	current_wget_state = WGET_TRANSFERRING;
 
-			return;
-		}
-	} else {
-		debug_cond(DEBUG_WGET, "wget: Connected HTTP Header %p\n", pkt);
-		/* sizeof(http_eom) - 1 is the string length of (http_eom) */
-		hlen = pos - (char *)pkt + sizeof(http_eom) - 1;
-		pos = strstr((char *)pkt, linefeed);
-		if (pos > 0)
-			i = pos - (char *)pkt;
-		else
-			i = hlen;
-		printf("%.*s", i,  pkt);
-
-		current_wget_state = WGET_TRANSFERRING;
-
-		initial_data_seq_num = tcp_seq_num + hlen;
-		next_data_seq_num    = tcp_seq_num + len;
-
-		if (strstr((char *)pkt, http_ok) == 0) {
-			debug_cond(DEBUG_WGET,
-				   "wget: Connected Bad Xfer\n");
-			wget_loop_state = NETLOOP_FAIL;
-			wget_send(action, tcp_seq_num, tcp_ack_num, len);
-		} else {
-			debug_cond(DEBUG_WGET,
-				   "wget: Connctd pkt %p  hlen %x\n",
-				   pkt, hlen);
+	if (strstr((char *)pkt, http_ok) == 0) {
+		debug_cond(DEBUG_WGET,
+			   "wget: Connected Bad Xfer\n");
+		wget_loop_state = NETLOOP_FAIL;
+		wget_send(action, tcp_seq_num, tcp_ack_num, len);
+		return;
+	}
 
-			pos = strstr((char *)pkt, content_len);
-			if (!pos) {
-				content_length = -1;
-			} else {
-				pos += sizeof(content_len) + 2;
-				strict_strtoul(pos, 10, &content_length);
-				debug_cond(DEBUG_WGET,
-					   "wget: Connected Len %lu\n",
-					   content_length);
-			}
+	debug_cond(DEBUG_WGET, "wget: Connctd pkt %p  hlen %x\n", pkt, hlen);
+	/* The whole body may come with the header, before the FIN */
+	wget_loop_state = NETLOOP_SUCCESS;
 
-			net_boot_file_size = 0;
+	pos = strstr((char *)pkt, content_len);
+	if (!pos) {
+		content_length = -1;
+	} else {
+		pos += sizeof(content_len) + 2;
+		strict_strtoul(pos, 10, &content_length);
+		debug_cond(DEBUG_WGET,
+			   "wget: Connected Len %lu\n",
+			   content_length);
+	}
 
-			if (len > hlen) {
-				if (store_block(pkt + hlen, 0, len - hlen) != 0) {
-					wget_loop_state = NETLOOP_FAIL;
-					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
-					net_set_state(NETLOOP_FAIL);
-					return;
-				}
-			}
+	/* Move any early data down over the space left for the header */
+	if (net_boot_file_size > hlen) {
+		net_boot_file_size -= hlen;
+		ptr = map_sysmem(image_load_addr, net_boot_file_size + hlen);
+		memmove(ptr, ptr + hlen, net_boot_file_size);
+		unmap_sysmem(ptr);
+	} else {
+		net_boot_file_size = 0;
+	}
+	initial_data_seq_num += hlen;
 
-			debug_cond(DEBUG_WGET,
-				   "wget: Connected Pkt %p hlen %x\n",
-				   pkt, hlen);
-
-			for (i = 0; i < pkt_q_idx; i++) {
-				int err;
-
-				ptr1 = map_sysmem(
-					(phys_addr_t)(pkt_q[i].pkt),
-					pkt_q[i].len);
-				err = store_block(ptr1,
-					  pkt_q[i].tcp_seq_num -
-					  initial_data_seq_num,
-					  pkt_q[i].len);
-				unmap_sysmem(ptr1);
-				debug_cond(DEBUG_WGET,
-					   "wget: Connctd pkt Q %p len %x\n",
-					   pkt_q[i].pkt, pkt_q[i].len);
-				if (err) {
-					wget_loop_state = NETLOOP_FAIL;
-					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
-					net_set_state(NETLOOP_FAIL);
-					return;
-				}
-			}
+	if (len > hlen) {
+		if (store_block(pkt + hlen, 0, len - hlen) != 0) {
+			wget_loop_state = NETLOOP_FAIL;
+			wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
+			net_set_state(NETLOOP_FAIL);
+			return;
 		}
 	}
+
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
 }
 
@@ -373,6 +340,8 @@ static void wget_handler(uchar *pkt, u16 dport,
 			if (wget_tcp_state == TCP_ESTABLISHED) {
 				debug_cond(DEBUG_WGET,
 					   "wget: Cting, send, len=%x\n", len);
+				initial_data_seq_num = tcp_seq_num + 1;
+				net_boot_file_size = 0;
 				wget_send(action, tcp_seq_num, tcp_ack_num,
 					  len);
 			} else {
@@ -397,12 +366,6 @@ static void wget_handler(uchar *pkt, u16 dport,
 			   "wget: Transferring, seq=%x, ack=%x,len=%x\n",
 			   tcp_seq_num, tcp_ack_num, len);
 
-		if (next_data_seq_num != tcp_seq_num) {
-			debug_cond(DEBUG_WGET, "wget: seq=%x packet was lost\n", next_data_seq_num);
-			return;
-		}
-		next_data_seq_num = tcp_seq_num + len;
-
 		if (store_block(pkt, tcp_seq_num - initial_data_seq_num, len) != 0) {
 			wget_fail("wget: store error\n",
 				  tcp_seq_num, tcp_ack_num, action);
@@ -422,9 +385,17 @@ static void wget_handler(uchar *pkt, u16 dport,
 			net_set_state(NETLOOP_FAIL);
 			break;
 		case TCP_ESTABLISHED:
-			wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num,
-				  len);
 			wget_loop_state = NETLOOP_SUCCESS;
+			if (!tcp_ack_can_wait()) {
+				wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num,
+					  len);
+				break;
+			}
+			retry_action = TCP_ACK;
+			retry_tcp_ack_num = tcp_ack_num;
+			wget_ack_pending = true;
+			net_set_timeout_handler(WGET_ACK_DELAY,
+						wget_timeout_handler);
 			break;
 		case TCP_CLOSE_WAIT:     /* End of transfer */
 			current_wget_state = WGET_TRANSFERRED;
@@ -392,6 +392,43 @@ static int bootdev_test_hunter(struct unit_test_state *uts)
 }
 BOOTSTD_TEST(bootdev_test_hunter, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
 
+/* Check starting a hunter and finishing it later */
+static int bootdev_test_hunt_start(struct unit_test_state *uts)
+{
+	struct bootstd_priv *std;
+
+	usb_started = false;
+	test_set_skip_delays(true);
+
+	/* get access to the used hunters */
+	ut_assertok(bootstd_get_priv(&std));
+
+	console_record_reset_enable();
+	ut_assertok(bootdev_hunt_start("usb", true));
+	ut_assert_nextline("Starting hunt with: usb");
+	ut_assert_nextline(
+		"Bus usb@1: scanning bus usb@1 for devices... in the background");
+	ut_assert_console_end();
+	ut_assert(!usb_started);
+	ut_asserteq(0, std->hunters_used);
+	ut_asserteq(BIT(8), std->hunters_started);
+
+	/* USB is the only hunter which can be started, and it already is */
+	ut_assertok(bootdev_hunt_start(NULL, true));
+	ut_assert_console_end();
+
+	/* hunting finishes the scan */
+	ut_assertok(bootdev_hunt("usb1", false));
+	ut_assert_nextline("Bus usb@1: 5 USB Device(s) found");
+	ut_assert_console_end();
+	ut_assert(usb_started);
+	ut_asserteq(BIT(8), std->hunters_used);
+	ut_asserteq(0, std->hunters_started);
+
+	return 0;
+}
+BOOTSTD_TEST(bootdev_test_hunt_start, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
+
 /* Check 'bootdev hunt' command */
 static int bootdev_test_cmd_hunt(struct unit_test_state *uts)
 {
@@ -6,7 +6,11 @@
  */
 
 #include <bootm.h>
+#include <command.h>
+#include <image.h>
+#include <mapmem.h>
 #include <asm/global_data.h>
+#include <u-boot/sha1.h>
 #include <test/suites.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -17,6 +21,12 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	BUF_SIZE	= 1024,
+
+	FIT_ADDR	= 0x100000,
+	FIT_SIZE	= 0x2000,
+	KERNEL_ADDR	= 0x200000,
+	KERNEL_SIZE	= 0x1000,
+	FW_SIZE		= 0x100,
 };
 
 #define CONSOLE_STR	"console=/dev/ttyS0"
@@ -238,6 +248,174 @@ static int bootm_test_subst_both(struct unit_test_state *uts)
 }
 BOOTM_TEST(bootm_test_subst_both, 0);
 
+/*
+ * Add a firmware image protected by a hash. Its data is inside the FIT, or
+ * with @pos, at that offset from the start of the FIT. It is loaded to @load
+ * if not 0.
+ */
+static int bootm_test_add_fw(struct unit_test_state *uts, void *fit,
+			     const char *name, const u8 *data, int pos,
+			     ulong load)
+{
+	u8 value[SHA1_SUM_LEN];
+
+	sha1_csum(data, FW_SIZE, value);
+	ut_assertok(fdt_begin_node(fit, name));
+	if (pos) {
+		ut_assertok(fdt_property_u32(fit, FIT_DATA_POSITION_PROP, pos));
+		ut_assertok(fdt_property_u32(fit, FIT_DATA_SIZE_PROP, FW_SIZE));
+	} else {
+		ut_assertok(fdt_property(fit, FIT_DATA_PROP, data, FW_SIZE));
+	}
+	ut_assertok(fdt_property_string(fit, FIT_TYPE_PROP, "firmware"));
+	ut_assertok(fdt_property_string(fit, FIT_ARCH_PROP,
+					genimg_get_arch_short_name(IH_ARCH_DEFAULT)));
+	ut_assertok(fdt_property_string(fit, FIT_COMP_PROP, "none"));
+	if (load)
+		ut_assertok(fdt_property_u32(fit, FIT_LOAD_PROP, load));
+	ut_assertok(fdt_begin_node(fit, "hash-1"));
+	ut_assertok(fdt_property_string(fit, FIT_ALGO_PROP, "sha1"));
+	ut_assertok(fdt_property(fit, FIT_VALUE_PROP, value, sizeof(value)));
+	ut_assertok(fdt_end_node(fit)); /* hash-1 */
+	ut_assertok(fdt_end_node(fit));
+
+	return 0;
+}
+
+/*
+ * Create a FIT with a kernel protected by a hash, which may be bad. With
+ * @overlap, the configuration also has two firmware images, the first of
+ * which is loaded over the data of the second.
+ */
+static int bootm_test_make_fit(struct unit_test_state *uts, bool bad,
+			       bool overlap)
+{
+	u8 value[SHA1_SUM_LEN], fw1[FW_SIZE];
+	void *fit, *data;
+	u8 *fw2;
+	int i;
+
+	fit = map_sysmem(FIT_ADDR, FIT_SIZE);
+	ut_assertok(fdt_create(fit, FIT_SIZE));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_property_u32(fit, FIT_TIMESTAMP_PROP, 0));
+	ut_assertok(fdt_property_string(fit, FIT_DESC_PROP, "bootm test"));
+
+	ut_assertok(fdt_begin_node(fit, "images"));
+	ut_assertok(fdt_begin_node(fit, "kernel"));
+	ut_assertok(fdt_property_placeholder(fit, FIT_DATA_PROP, KERNEL_SIZE,
+					     &data));
+	for (i = 0; i < KERNEL_SIZE; i++)
+		((u8 *)data)[i] = i;
+	sha1_csum(data, KERNEL_SIZE, value);
+	if (bad)
+		value[0] ^= 1;
+	ut_assertok(fdt_property_string(fit, FIT_TYPE_PROP, "kernel"));
+	ut_assertok(fdt_property_string(fit, FIT_ARCH_PROP,
+					genimg_get_arch_short_name(IH_ARCH_DEFAULT)));
+	ut_assertok(fdt_property_string(fit, FIT_OS_PROP, "linux"));
+	ut_assertok(fdt_property_string(fit, FIT_COMP_PROP, "none"));
+	ut_assertok(fdt_property_u32(fit, FIT_LOAD_PROP, KERNEL_ADDR));
+	ut_assertok(fdt_property_u32(fit, FIT_ENTRY_PROP, KERNEL_ADDR));
+	ut_assertok(fdt_begin_node(fit, "hash-1"));
+	ut_assertok(fdt_property_string(fit, FIT_ALGO_PROP, "sha1"));
+	ut_assertok(fdt_property(fit, FIT_VALUE_PROP, value, sizeof(value)));
+	ut_assertok(fdt_end_node(fit)); /* hash-1 */
+	ut_assertok(fdt_end_node(fit)); /* kernel */
+
+	if (overlap) {
+		/* The second image is outside the FIT, where the first loads */
+		fw2 = map_sysmem(FIT_ADDR + FIT_SIZE, FW_SIZE);
+		memset(fw2, 0xaa, FW_SIZE);
+		ut_assertok(bootm_test_add_fw(uts, fit, "fw-2", fw2, FIT_SIZE,
+					      0));
+		unmap_sysmem(fw2);
+
+		memset(fw1, 0x55, FW_SIZE);
+		ut_assertok(bootm_test_add_fw(uts, fit, "fw-1", fw1, 0,
+					      FIT_ADDR + FIT_SIZE));
+	}
+	ut_assertok(fdt_end_node(fit)); /* images */
+
+	ut_assertok(fdt_begin_node(fit, "configurations"));
+	ut_assertok(fdt_property_string(fit, FIT_DEFAULT_PROP, "conf-1"));
+	ut_assertok(fdt_begin_node(fit, "conf-1"));
+	ut_assertok(fdt_property_string(fit, FIT_KERNEL_PROP, "kernel"));
+	if (overlap)
+		ut_assertok(fdt_property(fit, FIT_LOADABLE_PROP, "fw-1\0fw-2",
+					 10));
+	ut_assertok(fdt_end_node(fit)); /* conf-1 */
+	ut_assertok(fdt_end_node(fit)); /* configurations */
+
+	ut_assertok(fdt_end_node(fit)); /* root */
+	ut_assertok(fdt_finish(fit));
+	unmap_sysmem(fit);
+
+	return 0;
+}
+
+/* Test that the hashes of a FIT kernel are checked however it is loaded */
+static int bootm_test_fit_hash(struct unit_test_state *uts)
+{
+	const int states = BOOTM_STATE_START | BOOTM_STATE_FINDOS |
+		BOOTM_STATE_LOADOS;
+	struct bootm_info bmi;
+	char cmd[30];
+	u8 *kernel;
+
+	if (!CONFIG_IS_ENABLED(FIT_STREAM_LOAD))
+		return -EAGAIN;
+
+	/* Finding and loading the OS together checks the hashes while loading */
+	ut_assertok(bootm_test_make_fit(uts, false, false));
+	kernel = map_sysmem(KERNEL_ADDR, KERNEL_SIZE);
+	memset(kernel, '\0', KERNEL_SIZE);
+	snprintf(cmd, sizeof(cmd), "%x", FIT_ADDR);
+	bootm_init(&bmi);
+	bmi.addr_img = cmd;
+	ut_assertok(bootm_run_states(&bmi, states));
+	ut_assert_skip_to_line("   Verifying Hash Integrity while loading ... sha1+ OK");
+	ut_asserteq(0x10, kernel[0x10]);
+	unmap_sysmem(kernel);
+
+	ut_assertok(bootm_test_make_fit(uts, true, false));
+	ut_assert(bootm_run_states(&bmi, states));
+	ut_assert_skip_to_line("Bad Data Hash");
+
+	/* Running the states one at a time must not skip the check */
+	snprintf(cmd, sizeof(cmd), "bootm start %x", FIT_ADDR);
+	ut_asserteq(1, run_command(cmd, 0));
+	ut_assert_skip_to_line("Bad Data Hash");
+	ut_asserteq(1, run_command("bootm findos", 0));
+	ut_asserteq(1, run_command("bootm prep", 0));
+	ut_asserteq(1, run_command("bootm go", 0));
+	ut_assert(ut_check_skip_to_linen(uts, "## Transferring control"));
+
+	return 0;
+}
+BOOTM_TEST(bootm_test_fit_hash, UT_TESTF_CONSOLE_REC);
+
+/* Test that an image is checked again if another is loaded over it */
+static int bootm_test_fit_overlap(struct unit_test_state *uts)
+{
+	char cmd[30];
+
+	snprintf(cmd, sizeof(cmd), "bootm start %x", FIT_ADDR);
+	ut_assertok(bootm_test_make_fit(uts, false, false));
+	ut_assertok(run_command(cmd, 0));
+	ut_assert_skip_to_line("   Verifying Hash Integrity ... sha1+ OK");
+
+	ut_assertok(bootm_test_make_fit(uts, false, true));
+	ut_asserteq(1, run_command(cmd, 0));
+	ut_assert_skip_to_linen("   Loading loadables from");
+	ut_assert_skip_to_line("   Trying 'fw-2' loadables subimage");
+	ut_assert_skip_to_line("Bad Data Hash");
+
+	return 0;
+}
+BOOTM_TEST(bootm_test_fit_overlap, UT_TESTF_CONSOLE_REC);
+
 int do_ut_bootm(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	struct unit_test *tests = UNIT_TEST_SUITE_START(bootm_test);
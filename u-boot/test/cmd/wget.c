@@ -12,10 +12,12 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net/tcp.h>
 #include <net/wget.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -203,3 +205,341 @@ static int net_test_wget(struct unit_test_state *uts)
 }
 
 LIB_TEST(net_test_wget, 0);
+
+/*
+ * A server which sends the body out of order: the segment after a hole,
+ * the same segment again and then the last one with the FIN, before it
+ * fills the holes. One segment goes out for each packet from the client,
+ * and every one of them is answered at once, as all but the first are out
+ * of order or close a hole.
+ */
+enum {
+	RO_SEG		= 1024,
+	RO_BODY		= 4 * RO_SEG,
+	RO_MAX_ACKS	= 16,
+};
+
+static const char ro_header[] = "HTTP/1.1 200 OK\r\n"
+	"Content-Length: 4096\r\n\r\n";
+
+/* Segments of the body in the order they are sent, after the header */
+static const struct {
+	int seg;
+	u8 flags;
+} ro_script[] = {
+	{ 1, TCP_ACK },
+	{ 1, TCP_ACK },
+	{ 3, TCP_ACK | TCP_FIN },
+	{ 0, TCP_ACK },
+	{ 2, TCP_ACK },
+};
+
+/**
+ * struct ro_ack - an ACK received from the client
+ *
+ * @ack: sequence number acknowledged
+ * @win: window field
+ * @nsack: number of SACK blocks
+ * @sack: SACK blocks, in the order sent
+ */
+struct ro_ack {
+	u32 ack;
+	u16 win;
+	int nsack;
+	struct sack_edges sack[TCP_SACK_HILLS];
+};
+
+/**
+ * struct ro_server - state of the fake server
+ *
+ * @step: number of segments sent, including the header; -1 before the GET
+ * @fin_sent: the FIN has been sent again after the client got all the data
+ * @syn_win: window field of the client's SYN
+ * @syn_scale: window scale offered in the client's SYN, -1 if none
+ * @syn_sack: the client's SYN permitted SACK
+ * @nacks: number of ACKs recorded in @acks
+ * @acks: ACKs the client sent after the GET
+ */
+static struct ro_server {
+	int step;
+	bool fin_sent;
+	u16 syn_win;
+	int syn_scale;
+	bool syn_sack;
+	int nacks;
+	struct ro_ack acks[RO_MAX_ACKS];
+} ro_srv;
+
+static u8 ro_body(int i)
+{
+	return i * 7 + i / RO_SEG;
+}
+
+static u32 ro_data_seq(int off)
+{
+	return 1 + strlen(ro_header) + off;
+}
+
+/* Queue a segment from the server in reply to the client's @packet */
+static int sb_tcp_reply(struct udevice *dev, void *packet, u8 flags, u32 seq,
+			u32 ack, const u8 *opt, int opt_len, const u8 *data,
+			int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_send;
+	struct ip_tcp_hdr *tcp_send;
+	int pkt_len;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return 0;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	tcp_send = (void *)eth_send + ETHER_HDR_SIZE;
+	tcp_send->tcp_src = tcp->tcp_dst;
+	tcp_send->tcp_dst = tcp->tcp_src;
+	tcp_send->tcp_seq = htonl(seq);
+	tcp_send->tcp_ack = htonl(ack);
+	tcp_send->tcp_hlen =
+		SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE + opt_len));
+	tcp_send->tcp_flags = flags;
+	tcp_send->tcp_win = htons(0xffff);
+	tcp_send->tcp_ugr = 0;
+	memcpy((void *)tcp_send + IP_TCP_HDR_SIZE, opt, opt_len);
+	memcpy((void *)tcp_send + IP_TCP_HDR_SIZE + opt_len, data, len);
+
+	pkt_len = IP_TCP_HDR_SIZE + opt_len + len;
+	tcp_send->tcp_xsum = 0;
+	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
+						   tcp->ip_src, tcp->ip_dst,
+						   pkt_len - IP_HDR_SIZE,
+						   pkt_len);
+	net_set_ip_header((uchar *)tcp_send, tcp->ip_src, tcp->ip_dst,
+			  pkt_len, IPPROTO_TCP);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE + pkt_len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+/* Record the options of the client's SYN, or the SACK blocks of an ACK */
+static void sb_ro_parse_options(const u8 *p, int len, struct ro_ack *ack)
+{
+	const u8 *end = p + len;
+	int i;
+
+	while (p < end && *p != TCP_O_END) {
+		if (*p == TCP_1_NOP) {
+			p++;
+			continue;
+		}
+		if (p + 1 >= end || p[1] < TCP_OPT_LEN_2)
+			return;
+		switch (p[0]) {
+		case TCP_O_SCL:
+			ro_srv.syn_scale = p[2];
+			break;
+		case TCP_P_SACK:
+			ro_srv.syn_sack = true;
+			break;
+		case TCP_V_SACK:
+			if (!ack)
+				break;
+			ack->nsack = (p[1] - TCP_OPT_LEN_2) / TCP_SACK_SIZE;
+			for (i = 0; i < ack->nsack && i < TCP_SACK_HILLS; i++) {
+				ack->sack[i].l = get_unaligned_be32(p + 2 + i * 8);
+				ack->sack[i].r = get_unaligned_be32(p + 6 + i * 8);
+			}
+			break;
+		}
+		p += p[1];
+	}
+}
+
+/* Send the next segment of the body, as given by ro_script[] */
+static int sb_ro_send_next(struct udevice *dev, void *packet, u32 ack)
+{
+	int seg, off;
+	u8 buf[RO_SEG];
+
+	if (!ro_srv.step++)
+		return sb_tcp_reply(dev, packet, TCP_ACK | TCP_PUSH, 1, ack,
+				    NULL, 0, (const u8 *)ro_header,
+				    strlen(ro_header));
+
+	seg = ro_script[ro_srv.step - 2].seg;
+	for (off = 0; off < RO_SEG; off++)
+		buf[off] = ro_body(seg * RO_SEG + off);
+
+	return sb_tcp_reply(dev, packet, ro_script[ro_srv.step - 2].flags,
+			    ro_data_seq(seg * RO_SEG), ack, NULL, 0, buf,
+			    RO_SEG);
+}
+
+static int sb_ro_handler(struct udevice *dev, void *packet, unsigned int len)
+{
+	/* MSS, window scale 0 and SACK permitted */
+	static const u8 syn_opts[] = {
+		TCP_O_MSS, TCP_OPT_LEN_4, TCP_MSS >> 8, TCP_MSS & 0xff,
+		TCP_1_NOP, TCP_O_SCL, TCP_OPT_LEN_3, 0,
+		TCP_P_SACK, TCP_OPT_LEN_2, TCP_1_NOP, TCP_1_NOP,
+	};
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	int hlen, payload_len;
+	struct ro_ack *ack;
+	u32 seq, ack_num;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP)
+		return -EPROTONOSUPPORT;
+
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	payload_len = ntohs(tcp->ip_len) - IP_HDR_SIZE - hlen;
+	seq = ntohl(tcp->tcp_seq);
+	ack_num = ntohl(tcp->tcp_ack);
+
+	if (tcp->tcp_flags == TCP_SYN) {
+		ro_srv.syn_win = ntohs(tcp->tcp_win);
+		sb_ro_parse_options((u8 *)tcp + IP_TCP_HDR_SIZE,
+				    hlen - TCP_HDR_SIZE, NULL);
+		return sb_tcp_reply(dev, packet, TCP_SYN | TCP_ACK, 0, seq + 1,
+				    syn_opts, sizeof(syn_opts), NULL, 0);
+	}
+	if (!(tcp->tcp_flags & TCP_ACK) || tcp->tcp_flags & TCP_RST)
+		return 0;
+
+	/* The client's FIN, which ends the transfer */
+	if (tcp->tcp_flags & TCP_FIN)
+		return sb_tcp_reply(dev, packet, TCP_ACK,
+				    ro_data_seq(RO_BODY) + 1, seq + 1, NULL, 0,
+				    NULL, 0);
+
+	/* The GET starts the transfer */
+	if (ro_srv.step < 0) {
+		if (!payload_len)
+			return 0;
+		ro_srv.step = 0;
+		return sb_ro_send_next(dev, packet, seq + payload_len);
+	}
+
+	if (ro_srv.nacks < RO_MAX_ACKS) {
+		ack = &ro_srv.acks[ro_srv.nacks++];
+		ack->ack = ack_num;
+		ack->win = ntohs(tcp->tcp_win);
+		ack->nsack = 0;
+		sb_ro_parse_options((u8 *)tcp + IP_TCP_HDR_SIZE,
+				    hlen - TCP_HDR_SIZE, ack);
+	}
+
+	if (ro_srv.step <= ARRAY_SIZE(ro_script))
+		return sb_ro_send_next(dev, packet, seq);
+
+	/* The first FIN was ahead of a hole, so send it again */
+	if (ack_num == ro_data_seq(RO_BODY) && !ro_srv.fin_sent) {
+		ro_srv.fin_sent = true;
+		return sb_tcp_reply(dev, packet, TCP_ACK | TCP_FIN,
+				    ro_data_seq(RO_BODY), seq, NULL, 0, NULL,
+				    0);
+	}
+
+	return 0;
+}
+
+/* Check the ACK at *@posp, or a later one, against @ack and @sack */
+static int ro_find_ack(struct unit_test_state *uts, int *posp, u32 ack,
+		       int nsack, const struct sack_edges *sack)
+{
+	struct ro_ack *rx;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_PROT_TCP_SACK))
+		nsack = 0;
+	for (; *posp < ro_srv.nacks; ++*posp) {
+		rx = &ro_srv.acks[*posp];
+		if (rx->ack != ack || rx->nsack != nsack)
+			continue;
+		for (i = 0; i < nsack; i++) {
+			if (rx->sack[i].l != sack[i].l ||
+			    rx->sack[i].r != sack[i].r)
+				break;
+		}
+		if (i == nsack) {
+			++*posp;
+			return 0;
+		}
+	}
+	ut_reportf("no ACK of %u with %d SACK blocks", ack, nsack);
+
+	return -ENOENT;
+}
+
+/* Reassemble a body sent out of order, with a duplicate and an early FIN */
+static int net_test_wget_reorder(struct unit_test_state *uts)
+{
+	const struct sack_edges seg[] = {
+		{ ro_data_seq(0), ro_data_seq(RO_SEG) },
+		{ ro_data_seq(RO_SEG), ro_data_seq(2 * RO_SEG) },
+		{ ro_data_seq(2 * RO_SEG), ro_data_seq(3 * RO_SEG) },
+		{ ro_data_seq(3 * RO_SEG), ro_data_seq(4 * RO_SEG) },
+	};
+	const struct sack_edges hills[] = { seg[3], seg[1] };
+	uint rx_window = CONFIG_PROT_TCP_RX_WINDOW;
+	int scale, pos, i;
+	u8 *buf;
+
+	memset(&ro_srv, '\0', sizeof(ro_srv));
+	ro_srv.step = -1;
+	ro_srv.syn_scale = -1;
+	sandbox_eth_set_tx_handler(0, sb_ro_handler);
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x20000");
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/index.html", 0));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	/* The whole body is in place */
+	ut_asserteq(RO_BODY, env_get_hex("filesize", 0));
+	buf = map_sysmem(0x20000, RO_BODY);
+	for (i = 0; i < RO_BODY; i++) {
+		if (buf[i] != ro_body(i))
+			break;
+	}
+	unmap_sysmem(buf);
+	ut_asserteq(RO_BODY, i);
+
+	/* The SYN offers a scaled window, which later ACKs use */
+	for (scale = 0; rx_window >> scale > 0xffff; scale++)
+		;
+	ut_asserteq(scale, ro_srv.syn_scale);
+	ut_asserteq(min(rx_window, 0xffffU), ro_srv.syn_win);
+	ut_asserteq(IS_ENABLED(CONFIG_PROT_TCP_SACK), ro_srv.syn_sack);
+	for (i = 0; i < ro_srv.nacks; i++)
+		ut_asserteq(rx_window >> scale, ro_srv.acks[i].win);
+
+	/*
+	 * Out-of-order data is reported with the most recent block first; the
+	 * FIN is not acknowledged until the server sends it again
+	 */
+	pos = 0;
+	ut_assertok(ro_find_ack(uts, &pos, seg[0].l, 0, NULL));
+	ut_assertok(ro_find_ack(uts, &pos, seg[0].l, 1, &seg[1]));
+	ut_assertok(ro_find_ack(uts, &pos, seg[0].l, 1, &seg[1]));
+	ut_assertok(ro_find_ack(uts, &pos, seg[0].l, 2, hills));
+	ut_assertok(ro_find_ack(uts, &pos, seg[2].l, 1, &seg[3]));
+	ut_assertok(ro_find_ack(uts, &pos, seg[3].r, 0, NULL));
+	ut_assert(ro_srv.fin_sent);
+
+	return 0;
+}
+
+LIB_TEST(net_test_wget_reorder, 0);
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the ring of DFU buffers, using the RAM back end
+ */
+
+#include <dfu.h>
+#include <env.h>
+#include <mapmem.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+
+enum {
+	RAM_ADDR	= 0x100000,
+	BUF_SIZE	= 0x100,
+	BLK_SIZE	= 0x40,
+	RAM_SIZE	= (2 * CONFIG_DFU_BUF_COUNT + 1) * BUF_SIZE,
+};
+
+/* Number of full buffers at which dfu_write_pending() writes one out */
+#define HIGH_WATER	min_t(int, CONFIG_DFU_BUF_HIGH_WATER, \
+			      CONFIG_DFU_BUF_COUNT - 1)
+
+static u8 dfu_test_src[RAM_SIZE];
+
+/* Set up one RAM entity of @size bytes with small buffers */
+static int dfu_test_setup(struct unit_test_state *uts, ulong size,
+			  struct dfu_entity **dfup)
+{
+	char alt[40];
+	u8 *ram;
+	int i;
+
+	for (i = 0; i < RAM_SIZE; i++)
+		dfu_test_src[i] = i * 7 + i / BUF_SIZE;
+	ram = map_sysmem(RAM_ADDR, RAM_SIZE);
+	memset(ram, '\0', RAM_SIZE);
+	unmap_sysmem(ram);
+
+	snprintf(alt, sizeof(alt), "%#x", BUF_SIZE);
+	ut_assertok(env_set("dfu_bufsiz", alt));
+	dfu_free_buf();
+	snprintf(alt, sizeof(alt), "img ram %x %lx", RAM_ADDR, size);
+	ut_assertok(dfu_config_entities(alt, "ram", "0"));
+	*dfup = dfu_get_entity(0);
+	ut_assertnonnull(*dfup);
+
+	return 0;
+}
+
+static void dfu_test_cleanup(void)
+{
+	dfu_free_entities();
+	env_set("dfu_bufsiz", NULL);
+}
+
+/* Send the host's blocks for buffer @buf, which fills it */
+static int dfu_test_fill(struct unit_test_state *uts, struct dfu_entity *dfu,
+			 int buf)
+{
+	int i, blk;
+
+	for (i = 0; i < BUF_SIZE / BLK_SIZE; i++) {
+		blk = buf * BUF_SIZE / BLK_SIZE + i;
+		ut_assertok(dfu_write(dfu, dfu_test_src + blk * BLK_SIZE,
+				      BLK_SIZE, blk));
+	}
+
+	return 0;
+}
+
+/* Check that the first @len bytes are written, and nothing after them */
+static int dfu_test_check(struct unit_test_state *uts, ulong len)
+{
+	u8 *ram = map_sysmem(RAM_ADDR, RAM_SIZE);
+
+	ut_asserteq_mem(dfu_test_src, ram, len);
+	ut_assertnull(memchr_inv(ram + len, '\0', RAM_SIZE - len));
+	unmap_sysmem(ram);
+
+	return 0;
+}
+
+/* Full buffers wait until the high-water mark, then wrap around the ring */
+static int common_test_dfu_ring(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	int i, buf;
+
+	ut_assertok(dfu_test_setup(uts, RAM_SIZE, &dfu));
+
+	/* Nothing is written until HIGH_WATER buffers are waiting */
+	for (buf = 0; buf < HIGH_WATER; buf++) {
+		ut_assertok(dfu_test_check(uts, 0));
+		ut_assertok(dfu_test_fill(uts, dfu, buf));
+		ut_assertok(dfu_write_pending());
+	}
+	ut_assertok(dfu_test_check(uts, BUF_SIZE));
+
+	/* Below the mark again, so nothing more is written */
+	ut_assertok(dfu_write_pending());
+	ut_assertok(dfu_test_check(uts, BUF_SIZE));
+
+	/*
+	 * Go round the ring without dfu_write_pending(); once it is full the
+	 * oldest buffer is written each time the next one fills
+	 */
+	for (i = 0; i < CONFIG_DFU_BUF_COUNT; i++)
+		ut_assertok(dfu_test_fill(uts, dfu, buf++));
+	ut_assertok(dfu_test_check(uts, (HIGH_WATER + 1) * BUF_SIZE));
+
+	/* A short last block, then the flush writes out everything */
+	ut_assertok(dfu_write(dfu, dfu_test_src + buf * BUF_SIZE, BLK_SIZE,
+			      buf * BUF_SIZE / BLK_SIZE));
+	ut_assertok(dfu_flush(dfu, NULL, 0, 0));
+	ut_assertok(dfu_test_check(uts, buf * BUF_SIZE + BLK_SIZE));
+	ut_assertok(dfu_get_write_error());
+
+	dfu_test_cleanup();
+
+	return 0;
+}
+COMMON_TEST(common_test_dfu_ring, 0);
+
+/* A failed write between transfers is kept for the host to see */
+static int common_test_dfu_ring_error(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	int buf;
+
+	/* Only the first buffer fits; the RAM back end rejects the next */
+	ut_assertok(dfu_test_setup(uts, BUF_SIZE - 1, &dfu));
+	for (buf = 0; buf < HIGH_WATER + 1; buf++)
+		ut_assertok(dfu_test_fill(uts, dfu, buf));
+	ut_assertok(dfu_write_pending());
+	ut_assertok(dfu_get_write_error());
+
+	ut_asserteq(-EINVAL, dfu_write_pending());
+	ut_asserteq(-EINVAL, dfu_get_write_error());
+	ut_assertok(dfu_get_write_error());
+
+	dfu_test_cleanup();
+
+	return 0;
+}
+COMMON_TEST(common_test_dfu_ring_error, 0);
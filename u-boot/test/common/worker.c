@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for boot-time workers
+ */
+
+#include <worker.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define WORKER_TEST_JOBS	64
+#define WORKER_TEST_LOOPS	100000
+
+/**
+ * struct worker_test - state for one test job
+ *
+ * @seed: Value to start from
+ * @result: Result of the calculation
+ * @runs: Number of times the job ran
+ */
+struct worker_test {
+	u32 seed;
+	u32 result;
+	int runs;
+};
+
+static u32 worker_test_calc(u32 val)
+{
+	int i;
+
+	for (i = 0; i < WORKER_TEST_LOOPS; i++)
+		ut_rand(&val);
+
+	return val;
+}
+
+static void worker_test_job(void *arg)
+{
+	struct worker_test *test = arg;
+
+	test->result = worker_test_calc(test->seed);
+	test->runs++;
+}
+
+/* Test that every job runs exactly once and its results are visible */
+static int common_test_worker_run(struct unit_test_state *uts)
+{
+	struct worker_test tests[WORKER_TEST_JOBS];
+	struct worker_job jobs[WORKER_TEST_JOBS];
+	int i, cpus;
+
+	for (i = 0; i < WORKER_TEST_JOBS; i++) {
+		tests[i].seed = i;
+		tests[i].result = 0;
+		tests[i].runs = 0;
+		jobs[i].func = worker_test_job;
+		jobs[i].arg = &tests[i];
+	}
+
+	ut_asserteq(1, worker_run(jobs, 0));
+	ut_asserteq(1, worker_run(jobs, 1));
+	ut_asserteq(1, tests[0].runs);
+	ut_asserteq(worker_test_calc(0), tests[0].result);
+
+	tests[0].runs = 0;
+	cpus = worker_run(jobs, WORKER_TEST_JOBS);
+	ut_assert(cpus >= 1 && cpus <= CONFIG_WORKER_MAX + 1);
+	for (i = 0; i < WORKER_TEST_JOBS; i++) {
+		ut_asserteq(1, tests[i].runs);
+		ut_asserteq(worker_test_calc(i), tests[i].result);
+	}
+
+	return 0;
+}
+COMMON_TEST(common_test_worker_run, 0);
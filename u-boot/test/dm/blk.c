@@ -334,3 +334,77 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the block-cache hash table, partial hits, eviction and readahead */
+static int dm_test_blkcache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	static char buf[32 * 512], out[16 * 512];
+	int i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i * 7 + (i >> 9);
+
+	/* four entries of 8 blocks, no readahead */
+	blkcache_configure(8, 0x4000, 0);
+
+	/* blocks 4-11 span two entries */
+	blkcache_fill(UCLASS_HOST, 0, 4, 8, 512, buf);
+	ut_asserteq(8, blkcache_read(UCLASS_HOST, 0, 4, 8, 512, out));
+	ut_asserteq_mem(buf, out, 8 * 512);
+
+	/* only the cached prefix of blocks 8-15 is returned */
+	memset(out, '\0', sizeof(out));
+	ut_asserteq(4, blkcache_read(UCLASS_HOST, 0, 8, 8, 512, out));
+	ut_asserteq_mem(buf + 4 * 512, out, 4 * 512);
+
+	/* other devices and block sizes do not match */
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 1, 4, 1, 512, out));
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 4, 1, 1024, out));
+
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.partial_hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(0x2000, stats.bytes);
+
+	/* reads larger than half the cache are not cached */
+	blkcache_fill(UCLASS_HOST, 0, 64, 17, 512, buf);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 64, 1, 512, out));
+
+	/* filling a fifth entry evicts the least-recently used one */
+	blkcache_fill(UCLASS_HOST, 0, 16, 16, 512, buf);
+	blkcache_fill(UCLASS_HOST, 0, 32, 8, 512, buf);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 4, 1, 512, out));
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 0, 8, 1, 512, out));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.evictions);
+	ut_asserteq(4, stats.entries);
+
+	/* writes drop everything cached for the device */
+	blkcache_invalidate(UCLASS_HOST, 0);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.bytes);
+
+	/* readahead starts at one entry and doubles while sequential */
+	blkcache_configure(8, 0x4000, 32);
+	ut_asserteq(0, blkcache_readahead(UCLASS_HOST, 0, 50, 1, 512));
+	ut_asserteq(8, blkcache_readahead(UCLASS_HOST, 0, 51, 1, 512));
+	ut_asserteq(15, blkcache_readahead(UCLASS_HOST, 0, 60, 1, 512));
+	ut_asserteq(0, blkcache_readahead(UCLASS_HOST, 0, 200, 1, 512));
+
+	blkcache_fill_readahead(UCLASS_HOST, 0, 0, 8, 8, 512, buf);
+	ut_asserteq(8, blkcache_read(UCLASS_HOST, 0, 8, 8, 512, out));
+	ut_asserteq_mem(buf + 8 * 512, out, 8 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(8, stats.ra_blocks);
+	ut_asserteq(1, stats.ra_hits);
+
+	blkcache_configure(8, CONFIG_BLOCK_CACHE_SIZE,
+			   CONFIG_BLOCK_CACHE_READAHEAD);
+
+	return 0;
+}
+DM_TEST(dm_test_blkcache, 0);
@@ -12,6 +12,7 @@
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -1247,6 +1248,52 @@ static int dm_test_get_stats(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_get_stats, UT_TESTF_SCAN_FDT);
 
+/* Find the driver for a compatible string by checking every driver in turn */
+static struct driver *find_compat_slow(const char *compat,
+				       const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *drv;
+
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (id = drv->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat)) {
+				*idp = id;
+				return drv;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Test that each compatible string finds the first driver which has it */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *found_id, *slow_id;
+	struct driver *drv;
+
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (id = drv->of_match; id && id->compatible; id++) {
+			ut_asserteq_ptr(find_compat_slow(id->compatible,
+							 &slow_id),
+					lists_driver_lookup_compat(id->compatible,
+								   &found_id));
+			ut_asserteq_ptr(slow_id, found_id);
+		}
+	}
+
+	ut_assertnull(lists_driver_lookup_compat("sandbox,no-such-driver",
+						 &found_id));
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
+
 /* Test uclass_find_device_by_name() */
 static int dm_test_uclass_find_device(struct unit_test_state *uts)
 {
@@ -1352,3 +1399,75 @@ static int dm_test_dev_get_mem(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dev_get_mem, UT_TESTF_SCAN_FDT);
+
+/* Find the first device in a uclass with a node, by checking each in turn */
+static struct udevice *find_node_slow(struct uclass *uc, ofnode node)
+{
+	struct udevice *dev;
+
+	uclass_foreach_dev(dev, uc) {
+		if (ofnode_equal(dev_ofnode(dev), node))
+			return dev;
+	}
+
+	return NULL;
+}
+
+static struct udevice *find_phandle_slow(struct uclass *uc, uint phandle)
+{
+	struct udevice *dev;
+
+	uclass_foreach_dev(dev, uc) {
+		if (dev_read_phandle(dev) == phandle)
+			return dev;
+	}
+
+	return NULL;
+}
+
+/* Test finding devices by node and phandle, and that unbinding is noticed */
+static int dm_test_uclass_node_index(struct unit_test_state *uts)
+{
+	struct udevice *dev, *found;
+	enum uclass_id id;
+	struct uclass *uc;
+	uint phandle;
+	ofnode node;
+
+	list_for_each_entry(uc, gd->uclass_root, sibling_node) {
+		id = uc->uc_drv->id;
+		uclass_foreach_dev(dev, uc) {
+			if (!dev_has_ofnode(dev))
+				continue;
+			ut_assertok(uclass_find_device_by_ofnode(id,
+								 dev_ofnode(dev),
+								 &found));
+			ut_asserteq_ptr(find_node_slow(uc, dev_ofnode(dev)),
+					found);
+
+			phandle = dev_read_phandle(dev);
+			if (!phandle)
+				continue;
+			ut_assertok(uclass_find_device_by_phandle_id(id, phandle,
+								     &found));
+			ut_asserteq_ptr(find_phandle_slow(uc, phandle), found);
+		}
+	}
+
+	/* A device which is unbound can no longer be found */
+	ut_assertok(uclass_get_device_by_name(UCLASS_GPIO, "base-gpios",
+					      &dev));
+	node = dev_ofnode(dev);
+	phandle = dev_read_phandle(dev);
+	ut_assert(phandle);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_ofnode(UCLASS_GPIO, node, &found));
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_phandle_id(UCLASS_GPIO, phandle,
+						     &found));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_node_index, UT_TESTF_SCAN_FDT);
@@ -446,6 +446,55 @@ static int dm_test_net_retry(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_net_retry, UT_TESTF_SCAN_FDT);
 
+static int batch_arp_replies;
+
+static int sb_count_arp_reply(struct udevice *dev, void *packet,
+			      unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP &&
+	    ntohs(arp->ar_op) == ARPOP_REPLY)
+		batch_arp_replies++;
+
+	return 0;
+}
+
+/* All packets waiting in the driver are processed by a single eth_rx() */
+static int dm_test_eth_rx_batch(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+	int i;
+
+	ut_assertok(net_init());
+	net_ip = string_to_ip("1.1.2.2");
+	env_set("ethact", "eth@10002000");
+	ut_assertok(eth_init());
+	dev = eth_get_dev();
+	ut_asserteq_str("eth@10002000", dev->name);
+	priv = dev_get_priv(dev);
+	priv->fake_host_ipaddr = string_to_ip("1.1.2.3");
+	sandbox_eth_set_tx_handler(0, sb_count_arp_reply);
+
+	for (i = 0; i < PKTBUFSRX; i++)
+		ut_assertok(sandbox_eth_recv_arp_req(dev));
+	ut_asserteq(-EOVERFLOW, sandbox_eth_recv_arp_req(dev));
+
+	batch_arp_replies = 0;
+	ut_assertok(eth_rx());
+	ut_asserteq(PKTBUFSRX, batch_arp_replies);
+	ut_asserteq(0, priv->recv_packets);
+	ut_asserteq(0, priv->recv_batched);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	eth_halt();
+
+	return 0;
+}
+DM_TEST(dm_test_eth_rx_batch, UT_TESTF_SCAN_FDT);
+
 static int sb_check_arp_reply(struct udevice *dev, void *packet,
 			      unsigned int len)
 {
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the ext4 lookup and extent cache
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <fs.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandbox_host.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+enum {
+	FILE_ADDR	= 0x100000,
+	PREALLOC_SIZE	= 0x4000,
+};
+
+static const char hello[] = "hello world\n";
+
+/* Select the whole of @desc as the filesystem for the next fs_*() call */
+static int ext4_test_set(struct unit_test_state *uts, struct blk_desc *desc)
+{
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+
+	return 0;
+}
+
+/* Find the sector holding @name, as the file system is not asked */
+static int ext4_test_find(struct unit_test_state *uts, struct blk_desc *desc,
+			  const char *name, lbaint_t *sectp, u8 *buf, int *offp)
+{
+	int len = strlen(name);
+	lbaint_t sect;
+	int i;
+
+	for (sect = 0; sect < desc->lba; sect++) {
+		ut_asserteq(1, blk_dread(desc, sect, 1, buf));
+		for (i = 0; i <= desc->blksz - len; i++) {
+			if (!memcmp(buf + i, name, len)) {
+				*sectp = sect;
+				*offp = i;
+				return 0;
+			}
+		}
+	}
+	ut_reportf("'%s' not found", name);
+
+	return -ENOENT;
+}
+
+/*
+ * The image is made by test_ut_dm_init() with 'hello.txt', and 'prealloc'
+ * whose extent is allocated but unwritten, over blocks which held the data of
+ * a deleted file. The test changes it, so works on a copy.
+ */
+static int dm_test_ext4_cache(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	char fname[256];
+	loff_t size, actual;
+	u8 sectbuf[512];
+	lbaint_t sect;
+	void *img;
+	int img_size, off;
+	u8 *buf;
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "4MB.ext4.img"));
+	ut_assertok(os_read_file(fname, &img, &img_size));
+	strlcat(fname, ".tmp", sizeof(fname));
+	ut_assertok(os_write_file(fname, img, img_size));
+	os_free(img);
+	ut_assertok(host_create_device("ext4", true, 512, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+	buf = map_sysmem(FILE_ADDR, PREALLOC_SIZE);
+
+	/* The same lookup twice, the second time from the cache */
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_size("/hello.txt", &size));
+	ut_asserteq(sizeof(hello) - 1, size);
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_size("/hello.txt", &size));
+	ut_asserteq(sizeof(hello) - 1, size);
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_read("/hello.txt", FILE_ADDR, 0, 0, &actual));
+	ut_asserteq(sizeof(hello) - 1, actual);
+	ut_asserteq_mem(hello, buf, actual);
+
+	/* A missing file is remembered, but not once it has been written */
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assert(fs_size("/new", &size));
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assert(fs_size("/new", &size));
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_write("/new", FILE_ADDR, 0, sizeof(hello) - 1,
+			     &actual));
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_size("/new", &size));
+	ut_asserteq(sizeof(hello) - 1, size);
+
+	/* An unwritten extent reads as zeroes, whatever is on the disk */
+	memset(buf, 0xff, PREALLOC_SIZE);
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_read("/prealloc", FILE_ADDR, 0, 0, &actual));
+	ut_asserteq(PREALLOC_SIZE, actual);
+	ut_assertnull(memchr_inv(buf, '\0', PREALLOC_SIZE));
+
+	/*
+	 * Rename 'hello.txt' by writing the directory block directly, as
+	 * 'mmc write' or fastboot would; the cached lookup must not survive
+	 */
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_size("/hello.txt", &size));
+	ut_assertok(ext4_test_find(uts, desc, "hello.txt", &sect, sectbuf,
+				   &off));
+	sectbuf[off] = 'j';
+	ut_asserteq(1, blk_dwrite(desc, sect, 1, sectbuf));
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assert(fs_size("/hello.txt", &size));
+	ut_assertok(ext4_test_set(uts, desc));
+	ut_assertok(fs_size("/jello.txt", &size));
+	ut_asserteq(sizeof(hello) - 1, size);
+
+	unmap_sysmem(buf);
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	os_unlink(fname);
+
+	return 0;
+}
+DM_TEST(dm_test_ext4_cache, UT_TESTF_SCAN_FDT);
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing to a FAT filesystem through the FAT cache
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <fat.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandbox_host.h>
+#include <asm/unaligned.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/*
+ * A FAT12 volume whose FAT is 7 sectors long, so it takes one full cache
+ * window and one of a single sector. Each FAT fills its sectors exactly, so
+ * the last cluster's entry is in the last two bytes of the FAT.
+ */
+enum {
+	SECT_SIZE	= 512,
+	FAT_SECTS	= 7,
+	ROOT_SECTS	= 1,
+	CLUSTERS	= FAT_SECTS * SECT_SIZE * 2 / 3 - 2,
+	DATA_SECT	= 1 + 2 * FAT_SECTS + ROOT_SECTS,
+	TOTAL_SECTS	= DATA_SECT + CLUSTERS,
+	FILE_ADDR	= 0x100000,
+	/* The allocator starts at cluster 3, so the file ends at the last */
+	FILE_SIZE	= (CLUSTERS - 1) * SECT_SIZE,
+};
+
+static int fat_test_make_image(struct unit_test_state *uts, const char *fname)
+{
+	volume_info *vi;
+	boot_sector *bs;
+	u8 *img;
+	int i;
+
+	img = calloc(TOTAL_SECTS, SECT_SIZE);
+	ut_assertnonnull(img);
+	bs = (boot_sector *)img;
+	memcpy(bs->system_id, "mkfs.fat", sizeof(bs->system_id));
+	put_unaligned_le16(SECT_SIZE, bs->sector_size);
+	bs->cluster_size = 1;
+	bs->reserved = cpu_to_le16(1);
+	bs->fats = 2;
+	put_unaligned_le16(ROOT_SECTS * SECT_SIZE / sizeof(dir_entry),
+			   bs->dir_entries);
+	put_unaligned_le16(TOTAL_SECTS, bs->sectors);
+	bs->media = 0xf8;
+	bs->fat_length = cpu_to_le16(FAT_SECTS);
+	vi = (volume_info *)&bs->fat32_length;
+	vi->ext_boot_sign = 0x29;
+	memcpy(vi->volume_label, "NO NAME    ", sizeof(vi->volume_label));
+	memcpy(vi->fs_type, "FAT12   ", sizeof(vi->fs_type));
+	img[510] = 0x55;
+	img[511] = 0xaa;
+
+	/* Media type and end-of-chain in the first two entries of each FAT */
+	for (i = 0; i < 2; i++) {
+		u8 *fat = img + (1 + i * FAT_SECTS) * SECT_SIZE;
+
+		fat[0] = 0xf8;
+		fat[1] = 0xff;
+		fat[2] = 0xff;
+	}
+
+	ut_assertok(os_write_file(fname, img, TOTAL_SECTS * SECT_SIZE));
+	free(img);
+
+	return 0;
+}
+
+/* Fill a FAT12 volume, which updates both cache windows and the last entry */
+static int dm_test_fat_write_fat12(struct unit_test_state *uts)
+{
+	u8 fat1[SECT_SIZE], fat2[SECT_SIZE], root[SECT_SIZE];
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	char fname[256];
+	loff_t actual;
+	u8 *buf;
+	int i, ret;
+
+	/* The image is made here, so it need not exist yet */
+	ret = os_persistent_file(fname, sizeof(fname), "fat12.img");
+	ut_assert(!ret || ret == -ENOENT);
+	ut_assertok(fat_test_make_image(uts, fname));
+	ut_assertok(host_create_device("fat12", true, SECT_SIZE, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	buf = map_sysmem(FILE_ADDR, FILE_SIZE);
+	for (i = 0; i < FILE_SIZE; i++)
+		buf[i] = i * 7 + i / SECT_SIZE;
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write("/fill", FILE_ADDR, 0, FILE_SIZE, &actual));
+	ut_asserteq(FILE_SIZE, actual);
+
+	/* Both copies of the FAT agree, also in the sector after the window */
+	for (i = 0; i < FAT_SECTS; i++) {
+		ut_asserteq(1, blk_dread(desc, 1 + i, 1, fat1));
+		ut_asserteq(1, blk_dread(desc, 1 + FAT_SECTS + i, 1, fat2));
+		ut_asserteq_mem(fat1, fat2, SECT_SIZE);
+	}
+
+	/*
+	 * The last cluster ends the chain, and the root directory still has
+	 * the long-name entry followed by the short one
+	 */
+	ut_asserteq(0xff, fat1[SECT_SIZE - 2]);
+	ut_asserteq(0xf, fat1[SECT_SIZE - 1] & 0xf);
+	ut_asserteq(1, blk_dread(desc, 1 + 2 * FAT_SECTS, 1, root));
+	ut_asserteq_mem("FILL~1     ", root + sizeof(dir_entry), 11);
+
+	/* Read it back through a fresh mount */
+	memset(buf, '\0', FILE_SIZE);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_read("/fill", FILE_ADDR, 0, 0, &actual));
+	ut_asserteq(FILE_SIZE, actual);
+	for (i = 0; i < FILE_SIZE; i++) {
+		if (buf[i] != (u8)(i * 7 + i / SECT_SIZE))
+			break;
+	}
+	ut_asserteq(FILE_SIZE, i);
+	unmap_sysmem(buf);
+
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	os_unlink(fname);
+
+	return 0;
+}
+DM_TEST(dm_test_fat_write_fat12, UT_TESTF_SCAN_FDT);
@@ -89,7 +89,7 @@ int get_oftree(struct unit_test_state *uts, void *fdt, oftree *treep)
 void free_oftree(oftree tree)
 {
 	if (of_live_active())
-		free(tree.np);
+		of_live_free(tree.np);
 }
 
 /* test ofnode_device_is_compatible() */
@@ -152,6 +152,57 @@ static int dm_test_ofnode_get_by_phandle_ot(struct unit_test_state *uts)
 DM_TEST(dm_test_ofnode_get_by_phandle_ot,
 	UT_TESTF_SCAN_FDT | UT_TESTF_OTHER_FDT);
 
+/* test that phandle lookups use the cache, and that it keeps up with changes */
+static int dm_test_ofnode_phandle_cache(struct unit_test_state *uts)
+{
+	struct dm_stats stats;
+	uint phandle, hits;
+	ofnode node;
+
+	node = ofnode_path("/pinctrl-gpio/base-gpios");
+	phandle = ofnode_read_u32_default(node, "phandle", 0);
+	ut_assert(phandle);
+
+	dm_get_mem(&stats);
+	hits = stats.phandle_hits;
+	ut_assert(ofnode_equal(node, ofnode_get_by_phandle(phandle)));
+	dm_get_mem(&stats);
+	ut_asserteq(hits + 1, stats.phandle_hits);
+	ut_assert(!ofnode_valid(ofnode_get_by_phandle(0x1000000)));
+
+	/* Changes to the live tree are not undone, so only change the FDT */
+	if (!of_live_active()) {
+		/* This moves every node in the FDT along */
+		ut_assertok(ofnode_write_string(ofnode_root(), "cache-test",
+						"moves the nodes"));
+		node = ofnode_path("/pinctrl-gpio/base-gpios");
+		ut_assert(ofnode_equal(node, ofnode_get_by_phandle(phandle)));
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_cache, UT_TESTF_SCAN_FDT);
+
+/* test that a node deleted from the 'other' tree is dropped from the cache */
+static int dm_test_ofnode_phandle_cache_ot(struct unit_test_state *uts)
+{
+	oftree otree = get_other_oftree(uts);
+	ofnode node;
+
+	node = oftree_get_by_phandle(otree, 1);
+	ut_asserteq_str("target", ofnode_get_name(node));
+
+	/* The flat 'other' tree is not restored after each test */
+	if (of_live_active()) {
+		ut_assertok(ofnode_delete(&node));
+		ut_assert(!ofnode_valid(oftree_get_by_phandle(otree, 1)));
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_cache_ot,
+	UT_TESTF_SCAN_FDT | UT_TESTF_OTHER_FDT);
+
 static int check_prop_values(struct unit_test_state *uts, ofnode start,
 			     const char *propname, const char *propval,
 			     int expect_count)
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the probe scheduler
+ *
+ * Each test device takes a number of polls to finish probing. Devices note
+ * when their probe starts (upper case) and finishes (lower case) in a log, so
+ * that the order can be checked.
+ */
+
+#include <dm.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <linux/string.h>
+#include <test/ut.h>
+
+/**
+ * struct probe_sched_plat - how a test device probes
+ *
+ * @polls: Number of polls before the probe is done
+ * @ret: Value to return when done
+ * @id: Letter to log
+ */
+struct probe_sched_plat {
+	int polls;
+	int ret;
+	char id;
+};
+
+static char probe_sched_log[16];
+
+static void probe_sched_note(char ch)
+{
+	int len = strlen(probe_sched_log);
+
+	if (len < sizeof(probe_sched_log) - 1)
+		probe_sched_log[len] = ch;
+}
+
+static int probe_sched_pos(char ch)
+{
+	char *p = strchr(probe_sched_log, ch);
+
+	return p ? p - probe_sched_log : -1;
+}
+
+static int probe_sched_poll(struct udevice *dev)
+{
+	struct probe_sched_plat *plat = dev_get_plat(dev);
+
+	if (--plat->polls > 0)
+		return -EINPROGRESS;
+	probe_sched_note(plat->id + 'a' - 'A');
+
+	return plat->ret;
+}
+
+static int probe_sched_test_probe(struct udevice *dev)
+{
+	struct probe_sched_plat *plat = dev_get_plat(dev);
+
+	probe_sched_note(plat->id);
+	if (!plat->polls)
+		return 0;
+
+	return device_probe_async(dev, probe_sched_poll);
+}
+
+U_BOOT_DRIVER(probe_sched_test) = {
+	.name	= "probe_sched_test",
+	.id	= UCLASS_TEST_DUMMY,
+	.probe	= probe_sched_test_probe,
+};
+
+static int probe_sched_bind(struct unit_test_state *uts,
+			    struct udevice *parent, struct probe_sched_plat *plat,
+			    struct udevice **devp)
+{
+	ut_assertok(device_bind(parent, DM_DRIVER_GET(probe_sched_test),
+				"probe_sched", plat, ofnode_null(), devp));
+	dev_or_flags(*devp, DM_FLAG_PROBE_AFTER_BIND);
+
+	return 0;
+}
+
+/* Slow devices probe together, and a child waits for its parent */
+static int dm_test_probe_sched(struct unit_test_state *uts)
+{
+	struct probe_sched_plat plat_a = { .polls = 3, .id = 'A' };
+	struct probe_sched_plat plat_b = { .polls = 50, .id = 'B' };
+	struct probe_sched_plat plat_c = { .id = 'C' };
+	struct udevice *a, *b, *c;
+
+	memset(probe_sched_log, '\0', sizeof(probe_sched_log));
+	ut_assertok(probe_sched_bind(uts, dm_root(), &plat_a, &a));
+	ut_assertok(probe_sched_bind(uts, a, &plat_c, &c));
+	ut_assertok(probe_sched_bind(uts, dm_root(), &plat_b, &b));
+
+	ut_assertok(dm_probe_run(dm_root()));
+
+	/* Both slow probes started before the first finished */
+	ut_assert(probe_sched_pos('B') >= 0);
+	ut_assert(probe_sched_pos('a') > probe_sched_pos('B'));
+	ut_assert(probe_sched_pos('C') > probe_sched_pos('a'));
+	ut_assert(device_active(c));
+	ut_asserteq(0, dev_get_flags(a) & DM_FLAG_PROBE_PENDING);
+
+	/* B is still pending, so it is not active yet */
+	ut_asserteq(-1, probe_sched_pos('b'));
+	ut_assert(plat_b.polls > 0);
+	ut_assert(dev_get_flags(b) & DM_FLAG_PROBE_PENDING);
+	ut_assert(!device_active(b));
+
+	/* Using a device waits for it */
+	ut_assertok(device_probe(b));
+	ut_assert(device_active(b));
+	ut_asserteq(0, dev_get_flags(b) & DM_FLAG_PROBE_PENDING);
+	ut_assert(probe_sched_pos('b') > probe_sched_pos('C'));
+	ut_asserteq(0, plat_b.polls);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_sched, UT_TESTF_SCAN_FDT);
+
+/* A probe which fails in the background leaves the device inactive */
+static int dm_test_probe_sched_fail(struct unit_test_state *uts)
+{
+	struct probe_sched_plat plat_a = { .polls = 50, .ret = -EIO,
+					   .id = 'A' };
+	struct udevice *a;
+
+	memset(probe_sched_log, '\0', sizeof(probe_sched_log));
+	ut_assertok(probe_sched_bind(uts, dm_root(), &plat_a, &a));
+	ut_assertok(dm_probe_run(dm_root()));
+	ut_asserteq(-EIO, device_probe(a));
+	ut_assert(!device_active(a));
+	ut_asserteq(0, dev_get_flags(a) & DM_FLAG_PROBE_PENDING);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_sched_fail, UT_TESTF_SCAN_FDT);
+
+/* Outside the scheduler, device_probe_async() waits for the device */
+static int dm_test_probe_sched_sync(struct unit_test_state *uts)
+{
+	struct probe_sched_plat plat_a = { .polls = 3, .id = 'A' };
+	struct udevice *a;
+
+	memset(probe_sched_log, '\0', sizeof(probe_sched_log));
+	ut_assertok(probe_sched_bind(uts, dm_root(), &plat_a, &a));
+	ut_assertok(device_probe(a));
+	ut_asserteq_str("Aa", probe_sched_log);
+	ut_asserteq(0, dev_get_flags(a) & DM_FLAG_PROBE_PENDING);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_sched_sync, UT_TESTF_SCAN_FDT);
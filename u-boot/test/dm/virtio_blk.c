@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the virtio-blk driver
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <virtio_types.h>
+#include <virtio.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Test the virtio-blk driver against the sandbox RAM disk */
+static int dm_test_virtio_blk(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct blk_desc *desc;
+	u8 *wbuf, *rbuf;
+	int i;
+
+	/* probing the transport binds the virtio-blk device */
+	ut_assertok(uclass_get_device_by_name(UCLASS_VIRTIO,
+					      "sandbox-virtio-blk", &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertok(device_probe(dev));
+	desc = dev_get_uclass_plat(dev);
+	ut_asserteq(512, desc->lba);
+
+	wbuf = malloc(desc->lba << 9);
+	rbuf = malloc(desc->lba << 9);
+	ut_assertnonnull(wbuf);
+	ut_assertnonnull(rbuf);
+	for (i = 0; i < desc->lba << 9; i++)
+		wbuf[i] = i * 7 + (i >> 9);
+
+	/* needs several requests over several queues, and several rounds */
+	ut_asserteq(desc->lba, blk_dwrite(desc, 0, desc->lba, wbuf));
+	memset(rbuf, '\0', desc->lba << 9);
+	ut_asserteq(desc->lba, blk_dread(desc, 0, desc->lba, rbuf));
+	ut_asserteq_mem(wbuf, rbuf, desc->lba << 9);
+
+	/* an unaligned transfer which ends in a partial segment */
+	ut_asserteq(37, blk_dread(desc, 3, 37, rbuf));
+	ut_asserteq_mem(wbuf + 3 * 512, rbuf, 37 * 512);
+
+	/* erase uses write-zeroes, split at the device's limit */
+	ut_asserteq(300, blk_derase(desc, 100, 300));
+	ut_asserteq(desc->lba, blk_dread(desc, 0, desc->lba, rbuf));
+	ut_asserteq_mem(wbuf, rbuf, 100 * 512);
+	for (i = 100 * 512; i < 400 * 512; i++)
+		ut_asserteq(0, rbuf[i]);
+	ut_asserteq_mem(wbuf + 400 * 512, rbuf + 400 * 512, 112 * 512);
+
+	/* out of range access fails */
+	ut_asserteq(-EIO, (long)blk_dread(desc, desc->lba - 1, 2, rbuf));
+
+	/* and leaves nothing behind in the queues */
+	ut_asserteq(desc->lba, blk_dread(desc, 0, desc->lba, rbuf));
+	ut_asserteq_mem(wbuf, rbuf, 100 * 512);
+
+	free(wbuf);
+	free(rbuf);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
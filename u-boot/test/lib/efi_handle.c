@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test the indexes of EFI handles and protocols
+ */
+
+#include <efi_loader.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+static const efi_guid_t test_guid =
+	EFI_GUID(0xf1d1f5a5, 0x8d3b, 0x4d50,
+		 0x9a, 0x1f, 0x27, 0x5b, 0x6c, 0x0e, 0x73, 0x21);
+
+/* Handles are found in the hash and protocols in the index, in order */
+static int lib_test_efi_handle_index(struct unit_test_state *uts)
+{
+	struct efi_lookup_stats before, after;
+	efi_handle_t h1, h2, h3, *buf;
+	struct efi_handler *handler;
+	efi_uintn_t count;
+	int val1, val3;
+
+	ut_assertok(efi_create_handle(&h1));
+	ut_assertok(efi_create_handle(&h2));
+	ut_assertok(efi_create_handle(&h3));
+	ut_asserteq_ptr(h2, efi_search_obj(h2));
+	ut_assertnull(efi_search_obj((efi_handle_t)((u8 *)h2 + 8)));
+
+	/* Install on the newer handle first; the older one still comes first */
+	ut_assertok(efi_add_protocol(h3, &test_guid, &val3));
+	ut_assertok(efi_add_protocol(h1, &test_guid, &val1));
+	ut_assertok(efi_add_protocol(h2, &efi_guid_device_path, NULL));
+	ut_assertok(efi_search_protocol(h3, &test_guid, &handler));
+	ut_asserteq_ptr(&val3, handler->protocol_interface);
+	ut_assert(efi_search_protocol(h2, &test_guid, NULL) == EFI_NOT_FOUND);
+
+	efi_get_lookup_stats(&before);
+	ut_assertok(efi_locate_handle_buffer_int(BY_PROTOCOL, &test_guid, NULL,
+						 &count, &buf));
+	efi_get_lookup_stats(&after);
+	ut_asserteq(2, count);
+	ut_asserteq_ptr(h1, buf[0]);
+	ut_asserteq_ptr(h3, buf[1]);
+	efi_free_pool(buf);
+	ut_asserteq(before.locates + 2, after.locates);
+	ut_asserteq(before.protocol_lookups, after.protocol_lookups);
+
+	/* A deleted handle is neither valid nor located */
+	ut_assertok(efi_delete_handle(h1));
+	ut_assertnull(efi_search_obj(h1));
+	ut_assertok(efi_locate_handle_buffer_int(BY_PROTOCOL, &test_guid, NULL,
+						 &count, &buf));
+	ut_asserteq(1, count);
+	ut_asserteq_ptr(h3, buf[0]);
+	efi_free_pool(buf);
+
+	ut_assertok(efi_delete_handle(h3));
+	ut_assert(efi_locate_handle_buffer_int(BY_PROTOCOL, &test_guid, NULL,
+					       &count, &buf) == EFI_NOT_FOUND);
+	ut_assertok(efi_delete_handle(h2));
+	efi_get_lookup_stats(&after);
+	ut_asserteq(before.handles - 3, after.handles);
+
+	return 0;
+}
+LIB_TEST(lib_test_efi_handle_index, 0);
@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images
+ *
+ * The storage is a buffer in memory, which records how it is written to, so
+ * that the gathering of chunks into large writes can be checked.
+ */
+
+#include <image-sparse.h>
+#include <malloc.h>
+#include <sparse_format.h>
+#include <test/lib.h>
+#include <test/ut.h>
+
+#define SPARSE_BLKSZ		512
+#define SPARSE_BLKS		1024
+#define SPARSE_IMG_BLKSZ	4096
+#define SPARSE_PER_IMG		(SPARSE_IMG_BLKSZ / SPARSE_BLKSZ)
+
+/**
+ * struct sparse_test - storage and image for a test
+ *
+ * @mem: Contents of the storage
+ * @writes: Number of calls to write()
+ * @erases: Number of calls to erase()
+ * @erase_blk: First block of the last erase
+ * @erase_cnt: Number of blocks in the last erase
+ * @img: Sparse image being built
+ * @pos: Size of @img so far
+ */
+struct sparse_test {
+	u8 mem[SPARSE_BLKS * SPARSE_BLKSZ];
+	int writes;
+	int erases;
+	lbaint_t erase_blk;
+	lbaint_t erase_cnt;
+	u8 img[64 * 1024];
+	int pos;
+};
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_test *st = info->priv;
+
+	memcpy(st->mem + blk * SPARSE_BLKSZ, buffer, blkcnt * SPARSE_BLKSZ);
+	st->writes++;
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info, lbaint_t blk,
+				    lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	struct sparse_test *st = info->priv;
+
+	memset(st->mem + blk * SPARSE_BLKSZ, '\0', blkcnt * SPARSE_BLKSZ);
+	st->erases++;
+	st->erase_blk = blk;
+	st->erase_cnt = blkcnt;
+
+	return blkcnt;
+}
+
+static void sparse_test_init(struct sparse_test *st,
+			     struct sparse_storage *info)
+{
+	memset(st->mem, 0x55, sizeof(st->mem));
+	st->writes = 0;
+	st->erases = 0;
+	st->pos = sizeof(sparse_header_t);
+
+	memset(info, '\0', sizeof(*info));
+	info->blksz = SPARSE_BLKSZ;
+	info->size = SPARSE_BLKS;
+	info->priv = st;
+	info->write = sparse_test_write;
+	info->reserve = sparse_test_reserve;
+}
+
+/* Add a chunk of @blks image blocks, returning where its data goes */
+static void *sparse_test_chunk(struct sparse_test *st, int type, int blks,
+			       int data_len)
+{
+	sparse_header_t *hdr = (sparse_header_t *)st->img;
+	chunk_header_t *chunk = (chunk_header_t *)(st->img + st->pos);
+
+	chunk->chunk_type = type;
+	chunk->chunk_sz = blks;
+	chunk->total_sz = sizeof(*chunk) + data_len;
+	st->pos += chunk->total_sz;
+
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->file_hdr_sz = sizeof(*hdr);
+	hdr->chunk_hdr_sz = sizeof(*chunk);
+	hdr->blk_sz = SPARSE_IMG_BLKSZ;
+	hdr->total_blks += blks;
+	hdr->total_chunks++;
+
+	return chunk + 1;
+}
+
+static void sparse_test_raw(struct sparse_test *st, int blks, u8 val)
+{
+	u8 *data = sparse_test_chunk(st, CHUNK_TYPE_RAW, blks,
+				     blks * SPARSE_IMG_BLKSZ);
+	int i;
+
+	for (i = 0; i < blks * SPARSE_IMG_BLKSZ; i++)
+		data[i] = val + i;
+}
+
+static void sparse_test_fill(struct sparse_test *st, int blks, u32 val)
+{
+	u32 *data = sparse_test_chunk(st, CHUNK_TYPE_FILL, blks, sizeof(val));
+
+	*data = val;
+}
+
+/* Check that blocks from @blk hold the data from sparse_test_raw() */
+static int sparse_check_raw(struct unit_test_state *uts,
+			    struct sparse_test *st, int blk, int blks, u8 val)
+{
+	u8 *mem = st->mem + blk * SPARSE_BLKSZ;
+	int i;
+
+	for (i = 0; i < blks * SPARSE_IMG_BLKSZ; i++)
+		ut_asserteq((u8)(val + i), mem[i]);
+
+	return 0;
+}
+
+static int sparse_check_fill(struct unit_test_state *uts,
+			     struct sparse_test *st, int blk, int blks,
+			     u32 val)
+{
+	u32 *mem = (u32 *)(st->mem + blk * SPARSE_BLKSZ);
+	int i;
+
+	for (i = 0; i < blks * SPARSE_IMG_BLKSZ / sizeof(u32); i++)
+		ut_asserteq(val, mem[i]);
+
+	return 0;
+}
+
+/* Adjacent RAW and FILL chunks are written together */
+static int lib_sparse_coalesce(struct unit_test_state *uts)
+{
+	struct sparse_storage info;
+	struct sparse_test *st;
+
+	st = calloc(1, sizeof(*st));
+	ut_assertnonnull(st);
+	sparse_test_init(st, &info);
+
+	sparse_test_raw(st, 2, 1);
+	sparse_test_fill(st, 3, 0xdeadbeef);
+	sparse_test_raw(st, 1, 7);
+	sparse_test_chunk(st, CHUNK_TYPE_DONT_CARE, 2, 0);
+	sparse_test_fill(st, 4, 0);
+	sparse_test_fill(st, 1, 0x12345678);
+	sparse_test_fill(st, 2, 0);
+
+	ut_assertok(write_sparse_image(&info, "test", st->img, NULL));
+	ut_asserteq(2, st->writes);
+	ut_assertok(sparse_check_raw(uts, st, 0, 2, 1));
+	ut_assertok(sparse_check_fill(uts, st, 2 * SPARSE_PER_IMG, 3,
+				      0xdeadbeef));
+	ut_assertok(sparse_check_raw(uts, st, 5 * SPARSE_PER_IMG, 1, 7));
+	ut_assertok(sparse_check_fill(uts, st, 6 * SPARSE_PER_IMG, 2,
+				      0x55555555));
+	ut_assertok(sparse_check_fill(uts, st, 8 * SPARSE_PER_IMG, 4, 0));
+	ut_assertok(sparse_check_fill(uts, st, 12 * SPARSE_PER_IMG, 1,
+				      0x12345678));
+	ut_assertok(sparse_check_fill(uts, st, 13 * SPARSE_PER_IMG, 2, 0));
+	free(st);
+
+	return 0;
+}
+LIB_TEST(lib_sparse_coalesce, 0);
+
+/* Zeroes are written by erasing whole erase groups, if available */
+static int lib_sparse_erase(struct unit_test_state *uts)
+{
+	struct sparse_storage info;
+	struct sparse_test *st;
+
+	st = calloc(1, sizeof(*st));
+	ut_assertnonnull(st);
+	sparse_test_init(st, &info);
+	info.erase = sparse_test_erase;
+	info.erase_grp = 2 * SPARSE_PER_IMG;
+
+	sparse_test_raw(st, 1, 3);
+	sparse_test_fill(st, 8, 0);
+	sparse_test_raw(st, 1, 5);
+
+	/* Erased blocks read back as ones, so zeroes must be written */
+	ut_assertok(write_sparse_image(&info, "test", st->img, NULL));
+	ut_asserteq(1, st->writes);
+	ut_asserteq(0, st->erases);
+
+	/* The erase group and a half after the first block are written */
+	sparse_test_init(st, &info);
+	info.erase = sparse_test_erase;
+	info.erase_grp = 2 * SPARSE_PER_IMG;
+	info.erase_zero = true;
+	ut_assertok(write_sparse_image(&info, "test", st->img, NULL));
+	ut_asserteq(2, st->writes);
+	ut_asserteq(1, st->erases);
+	ut_asserteq(2 * SPARSE_PER_IMG, st->erase_blk);
+	ut_asserteq(6 * SPARSE_PER_IMG, st->erase_cnt);
+	ut_assertok(sparse_check_raw(uts, st, 0, 1, 3));
+	ut_assertok(sparse_check_fill(uts, st, SPARSE_PER_IMG, 8, 0));
+	ut_assertok(sparse_check_raw(uts, st, 9 * SPARSE_PER_IMG, 1, 5));
+	free(st);
+
+	return 0;
+}
+LIB_TEST(lib_sparse_erase, 0);
+
+/* Erase groups need not be a power of two in size */
+static int lib_sparse_erase_odd(struct unit_test_state *uts)
+{
+	struct sparse_storage info;
+	struct sparse_test *st;
+
+	st = calloc(1, sizeof(*st));
+	ut_assertnonnull(st);
+	sparse_test_init(st, &info);
+	info.erase = sparse_test_erase;
+	info.erase_grp = 3 * SPARSE_PER_IMG;
+	info.erase_zero = true;
+
+	sparse_test_raw(st, 1, 3);
+	sparse_test_fill(st, 8, 0);
+	sparse_test_raw(st, 1, 5);
+
+	/* Zeroes up to the first group boundary are written, the rest erased */
+	ut_assertok(write_sparse_image(&info, "test", st->img, NULL));
+	ut_asserteq(1, st->erases);
+	ut_asserteq(3 * SPARSE_PER_IMG, st->erase_blk);
+	ut_asserteq(6 * SPARSE_PER_IMG, st->erase_cnt);
+	ut_assertok(sparse_check_raw(uts, st, 0, 1, 3));
+	ut_assertok(sparse_check_fill(uts, st, SPARSE_PER_IMG, 8, 0));
+	ut_assertok(sparse_check_raw(uts, st, 9 * SPARSE_PER_IMG, 1, 5));
+	free(st);
+
+	return 0;
+}
+LIB_TEST(lib_sparse_erase_odd, 0);
+
+/* Nothing is written beyond the partition */
+static int lib_sparse_too_large(struct unit_test_state *uts)
+{
+	struct sparse_storage info;
+	struct sparse_test *st;
+
+	st = calloc(1, sizeof(*st));
+	ut_assertnonnull(st);
+	sparse_test_init(st, &info);
+	info.size = 4 * SPARSE_PER_IMG;
+
+	sparse_test_raw(st, 2, 1);
+	sparse_test_fill(st, 3, 0xdeadbeef);
+
+	ut_asserteq(-1, write_sparse_image(&info, "test", st->img, NULL));
+	ut_asserteq(0, st->writes);
+	ut_assertok(sparse_check_fill(uts, st, 0, 5, 0x55555555));
+	free(st);
+
+	return 0;
+}
+LIB_TEST(lib_sparse_too_large, 0);
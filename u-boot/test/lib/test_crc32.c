@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests and benchmark for the CRC32 implementations
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <time.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+#include <u-boot/crc.h>
+
+#define CRC32_TEST_LEN		4096
+#define CRC32_PERF_LEN		SZ_4M
+#define CRC32_PERF_LOOPS	4
+
+/* Bit-at-a-time CRC32, to check the others against */
+static u32 crc32_ref(u32 crc, const u8 *buf, uint len)
+{
+	int i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (i = 0; i < 8; i++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+
+	return ~crc;
+}
+
+static int lib_crc32(struct unit_test_state *uts)
+{
+	const uint lens[] = { 0, 1, 3, 7, 8, 15, 16, 63, 64, 65, 127, 200,
+			      1000, 4000 };
+	const u8 check[] = "123456789";
+	enum crc32_impl impl;
+	int i, ofs, found = 0;
+	u32 crc, part;
+	u8 *buf;
+
+	ut_asserteq(0xcbf43926, crc32(0, check, sizeof(check) - 1));
+	ut_asserteq(0xcbf43926, crc32_ref(0, check, sizeof(check) - 1));
+
+	buf = malloc(CRC32_TEST_LEN + 8);
+	ut_assertnonnull(buf);
+	ut_fill_random(buf, CRC32_TEST_LEN + 8, 0x12345678);
+
+	for (impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+		crc = 0;
+		if (crc32_impl(impl, &crc, check, sizeof(check) - 1) == -ENOSYS)
+			continue;
+		found++;
+		ut_asserteq(0xcbf43926, crc);
+
+		/* Try every alignment, and chaining from a previous CRC */
+		for (ofs = 0; ofs < 8; ofs++) {
+			for (i = 0; i < ARRAY_SIZE(lens); i++) {
+				crc = 0;
+				ut_assertok(crc32_impl(impl, &crc, buf + ofs,
+						       lens[i]));
+				ut_asserteq(crc32_ref(0, buf + ofs, lens[i]),
+					    crc);
+
+				part = lens[i] / 3;
+				crc = 0;
+				ut_assertok(crc32_impl(impl, &crc, buf + ofs,
+						       part));
+				ut_assertok(crc32_impl(impl, &crc,
+						       buf + ofs + part,
+						       lens[i] - part));
+				ut_asserteq(crc32_ref(0, buf + ofs, lens[i]),
+					    crc);
+			}
+		}
+	}
+	ut_assert(found > 0);
+
+	/* Whatever crc32() uses must agree too */
+	ut_asserteq(crc32_ref(0, buf + 1, CRC32_TEST_LEN),
+		    crc32(0, buf + 1, CRC32_TEST_LEN));
+	ut_asserteq(crc32_ref(0x1234, buf, CRC32_TEST_LEN),
+		    crc32(0x1234, buf, CRC32_TEST_LEN));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_crc32, 0);
+
+/*
+ * Show the throughput of each implementation. This depends on the host, so
+ * it is only run by hand: ut lib -f lib_crc32_perf_norun
+ */
+static int lib_crc32_perf_norun(struct unit_test_state *uts)
+{
+	enum crc32_impl impl;
+	u32 crc, expect = 0;
+	ulong start;
+	int i;
+	u8 *buf;
+
+	buf = malloc(CRC32_PERF_LEN);
+	ut_assertnonnull(buf);
+	ut_fill_random(buf, CRC32_PERF_LEN, 0x12345678);
+
+	for (impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+		crc = 0;
+		if (crc32_impl(impl, &crc, buf, CRC32_PERF_LEN) == -ENOSYS) {
+			printf("%-12s not available\n", crc32_impl_name(impl));
+			continue;
+		}
+		if (!expect)
+			expect = crc;
+		ut_asserteq(expect, crc);
+
+		start = timer_get_us();
+		for (i = 0; i < CRC32_PERF_LOOPS; i++) {
+			crc = 0;
+			crc32_impl(impl, &crc, buf, CRC32_PERF_LEN);
+		}
+		ut_show_rate(crc32_impl_name(impl),
+			     (u64)CRC32_PERF_LEN * CRC32_PERF_LOOPS, start);
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_crc32_perf_norun, UT_TESTF_MANUAL);
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests and benchmark for SHA-1 and SHA-256 block processing
+ *
+ * sha1_process() and sha256_process() may be replaced by an accelerated
+ * version, so check them against the portable code and show the throughput
+ * of both.
+ */
+
+#include <malloc.h>
+#include <time.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+#define SHA_TEST_BLOCKS		67
+#define SHA_PERF_LEN		SZ_4M
+
+static int lib_sha1_process(struct unit_test_state *uts)
+{
+	const u8 abc_sum[] = {
+		0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+		0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d,
+	};
+	sha1_context ctx, ref;
+	u8 sum[20];
+	int i;
+	u8 *buf;
+
+	sha1_csum((const u8 *)"abc", 3, sum);
+	ut_asserteq_mem(abc_sum, sum, sizeof(sum));
+
+	buf = malloc(SHA_TEST_BLOCKS * 64 + 1);
+	ut_assertnonnull(buf);
+	ut_fill_random(buf, SHA_TEST_BLOCKS * 64 + 1, 0x87654321);
+
+	/* One block at a time, several at once and unaligned */
+	sha1_starts(&ctx);
+	sha1_starts(&ref);
+	for (i = 0; i < SHA_TEST_BLOCKS; i++)
+		sha1_process_sw(&ref, buf + i * 64, 1);
+	sha1_process(&ctx, buf, SHA_TEST_BLOCKS);
+	ut_asserteq_mem(ref.state, ctx.state, sizeof(ctx.state));
+
+	sha1_starts(&ctx);
+	sha1_starts(&ref);
+	sha1_process_sw(&ref, buf + 1, SHA_TEST_BLOCKS);
+	for (i = 0; i < SHA_TEST_BLOCKS; i++)
+		sha1_process(&ctx, buf + 1 + i * 64, 1);
+	ut_asserteq_mem(ref.state, ctx.state, sizeof(ctx.state));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_sha1_process, 0);
+
+static int lib_sha256_process(struct unit_test_state *uts)
+{
+	const u8 abc_sum[] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+		0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	};
+	sha256_context ctx, ref;
+	u8 sum[SHA256_SUM_LEN];
+	int i;
+	u8 *buf;
+
+	sha256_csum_wd((const u8 *)"abc", 3, sum, CHUNKSZ_SHA256);
+	ut_asserteq_mem(abc_sum, sum, sizeof(sum));
+
+	buf = malloc(SHA_TEST_BLOCKS * 64 + 1);
+	ut_assertnonnull(buf);
+	ut_fill_random(buf, SHA_TEST_BLOCKS * 64 + 1, 0x87654321);
+
+	sha256_starts(&ctx);
+	sha256_starts(&ref);
+	for (i = 0; i < SHA_TEST_BLOCKS; i++)
+		sha256_process_sw(&ref, buf + i * 64, 1);
+	sha256_process(&ctx, buf, SHA_TEST_BLOCKS);
+	ut_asserteq_mem(ref.state, ctx.state, sizeof(ctx.state));
+
+	sha256_starts(&ctx);
+	sha256_starts(&ref);
+	sha256_process_sw(&ref, buf + 1, SHA_TEST_BLOCKS);
+	for (i = 0; i < SHA_TEST_BLOCKS; i++)
+		sha256_process(&ctx, buf + 1 + i * 64, 1);
+	ut_asserteq_mem(ref.state, ctx.state, sizeof(ctx.state));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_sha256_process, 0);
+
+/*
+ * Show the throughput of the portable and the active implementations. This
+ * depends on the host, so it is only run by hand: ut lib -f lib_sha_perf_norun
+ */
+static int lib_sha_perf_norun(struct unit_test_state *uts)
+{
+	sha256_context ctx256;
+	sha1_context ctx1;
+	ulong start;
+	u8 *buf;
+
+	buf = malloc(SHA_PERF_LEN);
+	ut_assertnonnull(buf);
+	ut_fill_random(buf, SHA_PERF_LEN, 0x87654321);
+
+	sha1_starts(&ctx1);
+	start = timer_get_us();
+	sha1_process_sw(&ctx1, buf, SHA_PERF_LEN / 64);
+	ut_show_rate("sha1 portable", SHA_PERF_LEN, start);
+	start = timer_get_us();
+	sha1_process(&ctx1, buf, SHA_PERF_LEN / 64);
+	ut_show_rate("sha1 active", SHA_PERF_LEN, start);
+
+	sha256_starts(&ctx256);
+	start = timer_get_us();
+	sha256_process_sw(&ctx256, buf, SHA_PERF_LEN / 64);
+	ut_show_rate("sha256 portable", SHA_PERF_LEN, start);
+	start = timer_get_us();
+	sha256_process(&ctx256, buf, SHA_PERF_LEN / 64);
+	ut_show_rate("sha256 active", SHA_PERF_LEN, start);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_sha_perf_norun, UT_TESTF_MANUAL);
@@ -2,6 +2,7 @@
 # Copyright (C) 2020 Bootlin
 # Author: Joao Marcos Costa <joaomarcos.costa@bootlin.com>
 
+import hashlib
 import os
 import subprocess
 import pytest
@@ -92,6 +93,31 @@ def sqfs_load_files_at_subdir(u_boot_console):
     address = '$kernel_addr_r'
     sqfs_load_files(u_boot_console, files, sizes, address)
 
+def sqfs_load_files_at_offset(u_boot_console):
+    """ Loads parts of files, starting at an offset, and asserts their checksums.
+
+    The ranges start inside a data block and end inside the following data
+    block or the file's fragment.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+    """
+    build_dir = u_boot_console.config.build_dir
+    address = '$kernel_addr_r'
+    ranges = [('f5096', 0x800, 0xbe8), ('f4096', 0x100, 0xf00),
+              ('f1000', 0x10, 0x3d8)]
+    for (file, offset, size) in ranges:
+        out = u_boot_console.run_command('sqfsload host 0 {} {} {:x} {:x}'.format(
+            address, file, size, offset))
+        assert str(size) in out
+
+        original_file_path = os.path.join(build_dir, SQFS_SRC_DIR + '/' + file)
+        with open(original_file_path, 'rb') as f:
+            f.seek(offset)
+            original_checksum = hashlib.md5(f.read(size)).hexdigest()
+        u_boot_checksum = uboot_md5sum(u_boot_console, address, hex(size))
+        assert u_boot_checksum == original_checksum
+
 def sqfs_load_non_existent_file(u_boot_console):
     """ Calls sqfs_load_files passing an non-existent file to raise an error.
 
@@ -114,6 +140,7 @@ def sqfs_run_all_load_tests(u_boot_console):
     """
     sqfs_load_files_at_root(u_boot_console)
     sqfs_load_files_at_subdir(u_boot_console)
+    sqfs_load_files_at_offset(u_boot_console)
     sqfs_load_non_existent_file(u_boot_console)
 
 @pytest.mark.boardspec('sandbox')
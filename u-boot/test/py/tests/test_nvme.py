@@ -0,0 +1,112 @@
+# SPDX-License-Identifier: GPL-2.0
+
+# Test NVMe block I/O. Transfers are large enough to need several commands,
+# each with a PRP list, and to keep all the I/O queue's slots busy. Another
+# test forces I/O timeouts and checks that the device works afterwards.
+
+import re
+import pytest
+import u_boot_utils
+
+"""
+This test relies on boardenv_* containing configuration values to define
+which NVMe device to test, and which blocks of it may be overwritten. For
+example, on QEMU started with
+'-drive file=nvme.img,if=none,id=drv0 -device nvme,drive=drv0,serial=N0':
+
+env__nvme_device_test = {
+    'dev_num': 0,
+    'sector': 0x1000,
+    'count': 0x8003,
+}
+"""
+
+def nvme_setup(u_boot_console):
+    """Select the NVMe device to test
+
+    Returns:
+        tuple: (first block, number of blocks, block size)
+    """
+    f = u_boot_console.config.env.get('env__nvme_device_test', None)
+    if not f:
+        pytest.skip('No NVMe device to test')
+
+    dev_num = f.get('dev_num', 0)
+    sector = f.get('sector', 0x1000)
+    count = f.get('count', 0x8003)
+
+    u_boot_console.run_command('nvme scan')
+    output = u_boot_console.run_command('nvme device %d' % dev_num)
+    assert 'is now current device' in output
+    blksz = re.search(r'x (\d+)\)', output)
+    assert blksz
+    return sector, count, int(blksz.group(1))
+
+def nvme_write_read(u_boot_console, sector, count, blksz):
+    """Write random data, read it back and compare
+
+    The buffers are not page-aligned, so the first PRP entry has an offset.
+
+    Returns:
+        str: output of the read command
+    """
+    count_bytes = count * blksz
+    ram_base = u_boot_utils.find_ram_base(u_boot_console)
+    src_addr = ram_base + 0x200
+    dst_addr = src_addr + count_bytes + 0x1000
+
+    output = u_boot_console.run_command('random %x %x' % (src_addr, count_bytes))
+    assert '%d bytes filled with random data' % count_bytes in output
+    output = u_boot_console.run_command('nvme write %x %x %x' %
+                                        (src_addr, sector, count))
+    assert '%d blocks written: OK' % count in output
+
+    u_boot_console.run_command('mw.b %x 0 %x' % (dst_addr, count_bytes))
+    read = u_boot_console.run_command('nvme read %x %x %x' %
+                                      (dst_addr, sector, count))
+    output = u_boot_console.run_command('cmp.b %x %x %x' %
+                                        (src_addr, dst_addr, count_bytes))
+    assert 'Total of %d byte(s) were the same' % count_bytes in output
+    return read
+
+@pytest.mark.buildconfigspec('cmd_nvme')
+@pytest.mark.buildconfigspec('cmd_memory')
+@pytest.mark.buildconfigspec('cmd_random')
+def test_nvme_rw(u_boot_console):
+    """Test large NVMe writes and reads"""
+    sector, count, blksz = nvme_setup(u_boot_console)
+    output = nvme_write_read(u_boot_console, sector, count, blksz)
+    assert '%d blocks read: OK' % count in output
+
+    # A short transfer, which needs no PRP list
+    output = nvme_write_read(u_boot_console, sector + 1, 1, blksz)
+    assert '1 blocks read: OK' in output
+
+@pytest.mark.buildconfigspec('cmd_nvme')
+@pytest.mark.buildconfigspec('cmd_memory')
+@pytest.mark.buildconfigspec('cmd_random')
+def test_nvme_timeout(u_boot_console):
+    """Test that I/O works again after commands time out
+
+    With no timeout at all, a large read gives up on the commands it sent.
+    Their completions then arrive during the next transfer, which must not
+    take them for its own.
+    """
+    sector, count, blksz = nvme_setup(u_boot_console)
+    count_bytes = count * blksz
+    ram_base = u_boot_utils.find_ram_base(u_boot_console)
+    # Beyond the buffers of nvme_write_read(), as the read carries on
+    addr = ram_base + 2 * (count_bytes + 0x1000)
+
+    try:
+        u_boot_console.run_command('nvme timeout 0')
+        output = u_boot_console.run_command('nvme read %x %x %x' %
+                                            (addr, sector, count))
+        if 'I/O timeout' not in output:
+            pytest.skip('The controller completed the commands at once')
+        assert '%d blocks read: OK' % count not in output
+    finally:
+        u_boot_console.run_command('nvme timeout 3000')
+
+    output = nvme_write_read(u_boot_console, sector, count, blksz)
+    assert '%d blocks read: OK' % count in output
@@ -541,6 +541,27 @@ def test_ut_dm_init(u_boot_console):
     fs_helper.mk_fs(u_boot_console.config, 'ext2', 0x200000, '2MB')
     fs_helper.mk_fs(u_boot_console.config, 'fat32', 0x100000, '1MB')
 
+    # An ext4 image with a file whose extent is unwritten, placed over the
+    # blocks of a deleted file so that they are not zero on the disk
+    fn = fs_helper.mk_fs(u_boot_console.config, 'ext4', 0x400000, '4MB')
+    src = os.path.join(u_boot_console.config.persistent_data_dir, 'ext4.src')
+    with open(src, 'wb') as fh:
+        fh.write(b'hello world\n')
+    junk = src + '.junk'
+    with open(junk, 'wb') as fh:
+        fh.write(b'\xa5' * 0x10000)
+    u_boot_utils.run_and_log(
+        u_boot_console, f'debugfs -w -f - {fn}',
+        stdin=f'''write {src} hello.txt
+write {junk} junk
+rm junk
+write /dev/null prealloc
+fallocate prealloc 0 15
+sif prealloc size 16384
+'''.encode())
+    os.remove(src)
+    os.remove(junk)
+
     mmc_dev = 6
     fn = os.path.join(u_boot_console.config.source_dir, f'mmc{mmc_dev}.img')
     data = b'\x00' * (12 * 1024 * 1024)
@@ -361,7 +361,8 @@ static int test_post_run(struct unit_test_state *uts, struct unit_test *test)
 	ut_assertok(cyclic_unregister_all());
 	ut_assertok(event_uninit());
 
-	free(uts->of_other);
+	if (IS_ENABLED(CONFIG_OF_LIVE))
+		of_live_free(uts->of_other);
 	uts->of_other = NULL;
 
 	blkcache_free();
@@ -7,12 +7,15 @@
 
 #include <console.h>
 #include <malloc.h>
+#include <time.h>
 #ifdef CONFIG_SANDBOX
 #include <asm/state.h>
 #endif
 #include <asm/global_data.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -231,3 +234,19 @@ void ut_set_skip_delays(struct unit_test_state *uts, bool skip_delays)
 	state_set_skip_delays(skip_delays);
 #endif
 }
+
+void ut_fill_random(void *buf, ulong len, u32 seed)
+{
+	u8 *ptr = buf;
+
+	while (len--)
+		*ptr++ = ut_rand(&seed) >> 16;
+}
+
+void ut_show_rate(const char *name, u64 bytes, ulong start)
+{
+	ulong us = max(timer_get_us() - start, 1UL);
+
+	printf("%-16s %lu MiB/s\n", name,
+	       (ulong)div_u64(div_u64(bytes * 1000000, us), SZ_1M));
+}